@@ -0,0 +1,45 @@
+-- Schema for the LAN collector (src/collector/): the sensor_data table from supabase_schema.sql
+-- with the tower each row came from, for many towers in one table
+-- Apply with: psql "dbname=hydroponics" -f collector_schema.sql
+
+CREATE TABLE IF NOT EXISTS sensor_data (
+    id BIGSERIAL PRIMARY KEY,
+    created_at TIMESTAMP WITH TIME ZONE DEFAULT NOW(),
+    timestamp BIGINT NOT NULL,
+
+    -- Sensor readings
+    co2_level REAL,
+    ph_level REAL,
+    water_temp REAL,
+    water_temp_top REAL,
+    water_temp_root REAL,
+    env_temp REAL,
+    humidity REAL,
+    light_level REAL,
+    ec_level REAL,
+    water_level BOOLEAN
+);
+
+-- Collected rows: device ID (id@host given to the collector, host:port otherwise), the time the
+-- tower answered (timestamp holds the same in Unix seconds) and the tower's snapshot sequence.
+-- Rows the towers upload themselves leave these NULL, so both can share an existing table.
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS water_temp_top REAL;
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS water_temp_root REAL;
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS device_id TEXT;
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS sampled_at TIMESTAMP WITH TIME ZONE;
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS seq BIGINT;
+
+CREATE INDEX IF NOT EXISTS idx_sensor_data_timestamp ON sensor_data(timestamp);
+CREATE INDEX IF NOT EXISTS idx_sensor_data_created_at ON sensor_data(created_at);
+CREATE INDEX IF NOT EXISTS idx_sensor_data_device_sampled ON sensor_data(device_id, sampled_at);
+
+-- Ingest lag per tower over the last hour
+-- SELECT
+--     device_id,
+--     count(*) AS rows,
+--     avg(created_at - sampled_at) AS lag_avg,
+--     max(created_at - sampled_at) AS lag_max
+-- FROM sensor_data
+-- WHERE sampled_at > NOW() - INTERVAL '1 hour'
+-- GROUP BY device_id
+-- ORDER BY device_id;
@@ -0,0 +1,45 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+
+#define waterPHPin 36    // GPIO pin for pH meter Analog output (ADC1 channel 0)
+#define waterECPin 34    // GPIO pin for EC meter Analog output (ADC1 channel 6)
+
+// Continuous sampling configuration
+#define ADC_SAMPLE_PERIOD_MS 2     // Both channels sampled every 2ms (500Hz per channel)
+#define ADC_WINDOW_MAX 1024        // Samples per channel a window can hold (~2s at 500Hz)
+#define ADC_TRIM_PERCENT 10        // Dropped from each end of the sorted window before averaging
+#define ADC_SAMPLER_CORE 1         // Same core as the loop, WiFi stays undisturbed on core 0
+#define ADC_SAMPLER_PRIORITY 3     // Above the loop and the acquisition task
+
+#define ADC_CHANNEL_PH 0
+#define ADC_CHANNEL_EC 1
+#define ADC_CHANNEL_COUNT 2
+
+// One reduced window of raw ADC codes
+struct AdcWindow {
+  float trimmedMean;  // Mean after dropping ADC_TRIM_PERCENT at each end
+  float median;
+  float variance;     // Variance of all samples in the window (codes^2)
+  uint16_t minCode;
+  uint16_t maxCode;
+  uint16_t samples;   // Samples that made it into the window
+};
+
+// Sampler state reported over HTTP
+struct AdcSamplerStats {
+  bool running;                        // false = fallback to one analogRead() per tick
+  float sampleRateHz;                  // Measured samples per second per channel
+  unsigned long windows;               // Windows reduced since boot
+  unsigned long droppedSamples;        // Samples lost because a window was full
+  unsigned long reduceUs;              // Loop time spent reducing the last window
+  AdcWindow last[ADC_CHANNEL_COUNT];   // Most recent window per channel
+};
+
+// Function declarations
+bool initAdcSampler();
+bool updateAdcSampler(float values[ADC_CHANNEL_COUNT]); // Reduces the window collected since the last call
+AdcSamplerStats getAdcSamplerStats();
+
+#endif
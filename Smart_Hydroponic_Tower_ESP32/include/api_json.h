@@ -0,0 +1,37 @@
+#ifndef API_JSON_H
+#define API_JSON_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// JSON bodies of the read-only endpoints (no server dependency, also built for the native env)
+String getSensorDataJSON();
+String getWaterTempTimingJSON();
+String getCO2StatsJSON();
+String getDHTStatsJSON();
+String getAdcSamplerJSON();
+String getSensorHealthJSON();
+String getSchedulerJSON();
+String getWaterLevelJSON();
+String getCalibrationJSON();
+String getSelfBenchJSON();
+String getLoopProfileJSON();
+String getHeapDiagnosticsJSON();
+
+// Combined dashboard state, pushed on /ws and served by /state
+#define STATE_JSON_CAPACITY 1536
+#define STATE_FIELD_COUNT 29          // Fields of the sensors, pump, ph and logger sections
+#define STATE_FIELDS_ALL (((StateFieldMask)1 << STATE_FIELD_COUNT) - 1)
+
+struct StateField {
+  const char* section;
+  const char* key;
+};
+typedef uint32_t StateFieldMask;      // Bit per stateFields entry
+
+extern const StateField stateFields[STATE_FIELD_COUNT];
+void buildLiveState(JsonDocument &doc);
+String getLiveStateJSON();       // With "type":"state" for /ws
+bool parseStateFields(const String &fields, StateFieldMask &mask); // "pump,ph.target", false on an unknown field
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+
+// Lookup tables: one entry every CALIBRATION_TABLE_STEP raw codes, linear interpolation in between
+#define CALIBRATION_TABLE_STEP 32
+#define CALIBRATION_TABLE_SIZE (4096 / CALIBRATION_TABLE_STEP + 1)
+#define CALIBRATION_DEFAULT_VREF 1100   // mV, used when the chip has no eFuse calibration
+
+// pH calibration
+#define PH_CAL_MAX_POINTS 3          // Two-point (4/7 or 7/10) or three-point (4/7/10) buffers
+#define PH_CAL_MIN_SPAN_MV 20        // Buffers closer than this can't define a slope
+#define PH_LEGACY_SLOPE 3.5          // Uncalibrated: pH = 3.5 * (code * 5 / 4096) + 0.6
+#define PH_LEGACY_OFFSET 0.6
+
+// EC calibration (DFRobot EC board constants)
+#define EC_RES2 820.0
+#define EC_REF 200.0
+#define EC_TEMP_COEFFICIENT 0.0185   // Per degree C, compensated to 25C
+#define EC_RANGE_SPLIT 2.5           // mS/cm, the high range k-value applies above this
+
+struct PHCalPoint {
+  float millivolts;  // eFuse-corrected ADC pin voltage
+  float ph;          // Buffer value
+};
+
+// Stored in NVS as one blob
+struct CalibrationData {
+  uint8_t version;
+  uint8_t phPoints;                      // 0-1 = uncalibrated (legacy formula)
+  PHCalPoint ph[PH_CAL_MAX_POINTS];      // Sorted by buffer pH
+  float ecKLow;                          // k-value below EC_RANGE_SPLIT (1.413 mS/cm standard)
+  float ecKHigh;                         // k-value above EC_RANGE_SPLIT (12.88 mS/cm standard)
+};
+
+// Function declarations
+void initCalibration();                             // Loads NVS and builds the lookup tables
+float adcCodeToMillivolts(float code);
+float convertPH(float code);                        // Raw code (may be fractional) to pH
+float convertEC(float code, float temperature);     // Raw code to temperature compensated mS/cm
+float readCalibrationCode(uint8_t channel);         // Averaged raw code for a calibration capture
+bool calibratePH(float bufferPH, float code);       // Adds or replaces a buffer point
+bool calibrateEC(float standard, float code, float temperature); // Sets the k-value of the standard's range
+void resetPHCalibration();
+void resetECCalibration();
+CalibrationData getCalibration();
+const char* getAdcCalibrationSource();              // eFuse two-point, eFuse Vref or default Vref
+uint32_t getAdcCalibrationVref();
+
+#endif
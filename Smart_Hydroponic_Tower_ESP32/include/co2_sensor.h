@@ -0,0 +1,39 @@
+#ifndef CO2_SENSOR_H
+#define CO2_SENSOR_H
+
+#include <Arduino.h>
+
+//CO2 sensor definitions
+#define RX_PIN 16 // Rx pin which the MHZ19 Tx pin is attached to
+#define TX_PIN 17 // Tx pin which the MHZ19 Rx pin is attached to
+#define BAUDRATE 9600 // Device to MH-Z19 Serial baudrate (should not be changed)
+
+#define CO2_FRAME_SIZE 9             // MH-Z19 command and reply length
+#define CO2_RX_BUFFER_SIZE 64        // Ring buffer between the UART event callback and the loop (power of 2)
+#define CO2_READ_INTERVAL_MS 1000    // Minimum time between read commands (the scheduler sets the rate)
+#define CO2_RESPONSE_TIMEOUT_MS 500  // Reply must arrive within this time (~10ms at 9600 baud)
+#define CO2_STALE_MS 10000           // Value is flagged stale without a valid frame for this long
+
+// Counters for the asynchronous MH-Z19 driver
+struct CO2Stats {
+  unsigned long commandsSent;     // Read commands issued
+  unsigned long framesReceived;   // Valid reply frames
+  unsigned long checksumErrors;   // Frames dropped because of a bad checksum
+  unsigned long framingErrors;    // Bytes skipped while looking for a frame header
+  unsigned long timeouts;         // Commands without a reply in time
+  unsigned long overflows;        // Bytes lost because the ring buffer was full
+  unsigned long discardedBytes;   // Received with no command outstanding (late replies)
+  unsigned long lastLatencyUs;    // Command sent until the full reply was parsed
+  unsigned long maxLatencyUs;
+  unsigned long lastFrameMs;      // millis() of the last valid frame
+  bool stale;                     // No valid frame within CO2_STALE_MS
+};
+
+// Function declarations
+void initCO2Sensor();
+bool updateCO2Sensor(float &co2);  // Never waits; returns true when a new value was published
+bool isCO2Stale();
+bool isCO2ReplyPending();          // Read command sent, reply not collected yet
+CO2Stats getCO2Stats();
+
+#endif
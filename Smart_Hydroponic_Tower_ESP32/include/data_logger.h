@@ -2,10 +2,9 @@
 #define DATA_LOGGER_H
 
 #include <Arduino.h>
-#include <WiFi.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include "sensors.h"
+#include "http_client.h"
 
 // Supabase Configuration
 #define SUPABASE_URL "https://jnvbsbphxvypcuorolen.supabase.co"
@@ -20,6 +19,7 @@ void initDataLogger();
 void logSensorDataToCloud();
 void triggerManualLog();
 bool uploadSensorData(const SensorData& data);
+void beginSensorDataRequest(HttpRequest &http); // POST to the sensor_data table with the Supabase headers
 String createJsonFromSensorData(const SensorData& data);
 
 // Status functions
@@ -0,0 +1,36 @@
+#ifndef DHT_SENSOR_H
+#define DHT_SENSOR_H
+
+#include <Arduino.h>
+
+#define DHTPIN 4         // GPIO pin for DHT22 sensor
+
+// DHT22 backends (selectable at runtime to compare their impact on interrupt latency)
+#define DHT_BACKEND_ADAFRUIT 0  // Bit-banged Adafruit driver, masks interrupts for ~5ms per read
+#define DHT_BACKEND_RMT 1       // Pulse train captured by the RMT peripheral, decoded on a later tick
+#define DHT_BACKEND_DEFAULT DHT_BACKEND_RMT
+
+#define DHT_MIN_INTERVAL_MS 2000   // DHT22 can't be read more often than every 2 seconds
+#define DHT_START_PULSE_US 1100    // Host start signal (datasheet: at least 1ms low)
+#define DHT_CAPTURE_TIMEOUT_MS 250 // Capture must complete within this time
+
+// Counters for the DHT22 driver
+struct DHTStats {
+  uint8_t backend;               // DHT_BACKEND_ADAFRUIT or DHT_BACKEND_RMT
+  unsigned long reads;           // Valid transactions
+  unsigned long checksumErrors;  // Transactions with a bad checksum
+  unsigned long timeouts;        // Transactions without a complete reply
+  unsigned long lastLoopUs;      // Loop time spent by the last update call that did work
+  unsigned long maxLoopUs;       // Worst loop time since the backend was selected
+  unsigned long lastReadMs;      // millis() of the last valid reading
+};
+
+// Function declarations
+void initDHTSensor();
+bool updateDHTSensor(float &temperature, float &humidity); // Returns true when a new valid reading is cached
+bool setDHTBackend(uint8_t backend);  // Applied by updateDHTSensor() between transactions
+uint8_t getDHTBackend();
+bool isDHTCapturePending(); // Start signal sent, result not collected yet
+DHTStats getDHTStats();
+
+#endif
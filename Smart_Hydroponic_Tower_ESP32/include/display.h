@@ -2,7 +2,6 @@
 #define DISPLAY_H
 
 #include <Arduino.h>
-#include <Arduino_GFX_Library.h>
 
 // Display pin definitions
 #define TFT_CS     33  // CS pin
@@ -14,14 +13,10 @@
 // Color definitions
 #define BROWN     0x8400  // Brown color (RGB565)
 
-// External display object
-extern Arduino_GFX *gfx;
-
 // Function declarations
 void initDisplay();
 void drawSensorStatus();
-uint16_t getStatusColor(float value, float minGood, float maxGood, float minYellow, float maxYellow, float minOrange = -999, float maxOrange = -999);
-uint16_t getStatusColor(bool status);
+uint16_t getStatusColor(uint8_t level); // STATUS_* from sensor_status.h
 void printSystemStatus(uint16_t color, const char* text);
 
 #endif
@@ -0,0 +1,295 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <type_traits>
+
+// Header-only signal filters for the sensor channels.
+// Window sizes and parameters are template arguments, so every filter is a
+// fixed-size object with no heap use. NaN samples pass through untouched and
+// are not stored. Filters can be chained per channel with FilterChain<...>.
+
+// Moving average over N samples, O(1) per sample.
+// Integer samples use an exact 64-bit sum; float samples use a Kahan
+// compensated sum so adding and removing samples doesn't drift over time.
+template <uint16_t N, typename T = float>
+class MovingAverage {
+ public:
+  typedef typename std::conditional<std::is_integral<T>::value, int64_t, float>::type Accumulator;
+
+  MovingAverage() { reset(); }
+
+  float update(T sample) {
+    if (isNaN(sample)) {
+      return sample;
+    }
+    if (count == N) {
+      accumulate(sum, compensation, -(Accumulator)buffer[index]); // Remove the oldest sample
+    } else {
+      count++;
+    }
+    buffer[index] = sample;
+    accumulate(sum, compensation, (Accumulator)sample);
+    index = (index + 1) % N;
+    return value();
+  }
+
+  float value() const { return count > 0 ? (float)sum / count : NAN; }
+  uint16_t size() const { return count; }
+  bool full() const { return count == N; }
+
+  void reset() {
+    memset(buffer, 0, sizeof(buffer));
+    index = 0;
+    count = 0;
+    sum = 0;
+    compensation = 0;
+  }
+
+ private:
+  template <typename V>
+  static bool isNaN(V sample) { return sample != sample; } // Always false for integer samples
+
+  static void accumulate(int64_t &total, float &, int64_t sample) { total += sample; }
+  static void accumulate(float &total, float &carry, float sample) {
+    float y = sample - carry;
+    float t = total + y;
+    carry = (t - total) - y;
+    total = t;
+  }
+
+  T buffer[N];
+  uint16_t index;
+  uint16_t count;
+  Accumulator sum;
+  float compensation;
+};
+
+// Running median over N samples.
+// Keeps the window in arrival order plus a sorted copy; each sample costs two
+// O(log N) binary searches and a memmove of at most N floats.
+template <uint16_t N>
+class MedianFilter {
+ public:
+  MedianFilter() { reset(); }
+
+  float update(float sample) {
+    if (isnan(sample)) {
+      return sample;
+    }
+    if (count == N) {
+      // Drop the oldest sample from the sorted copy
+      uint16_t pos = lowerBound(window[head]);
+      memmove(&sorted[pos], &sorted[pos + 1], (count - pos - 1) * sizeof(float));
+      count--;
+    }
+    uint16_t pos = lowerBound(sample);
+    memmove(&sorted[pos + 1], &sorted[pos], (count - pos) * sizeof(float));
+    sorted[pos] = sample;
+    count++;
+
+    window[head] = sample;
+    head = (head + 1) % N;
+    return median();
+  }
+
+  float median() const {
+    if (count == 0) {
+      return NAN;
+    }
+    return (count % 2) ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) * 0.5f;
+  }
+
+  // Median absolute deviation from the median, O(N) by walking out from the median
+  float mad() const {
+    if (count == 0) {
+      return NAN;
+    }
+    float med = median();
+    int left = (int)lowerBound(med) - 1;
+    int right = left + 1;
+    float previous = 0, current = 0;
+    for (uint16_t k = 0; k <= count / 2; k++) {
+      previous = current;
+      float leftDistance = left >= 0 ? med - sorted[left] : INFINITY;
+      float rightDistance = right < count ? sorted[right] - med : INFINITY;
+      if (leftDistance <= rightDistance) {
+        current = leftDistance;
+        left--;
+      } else {
+        current = rightDistance;
+        right++;
+      }
+    }
+    return (count % 2) ? current : (previous + current) * 0.5f;
+  }
+
+  uint16_t size() const { return count; }
+
+  void reset() {
+    head = 0;
+    count = 0;
+  }
+
+ private:
+  // First index in sorted[0..count) whose value is not less than the given one
+  uint16_t lowerBound(float value) const {
+    uint16_t low = 0, high = count;
+    while (low < high) {
+      uint16_t mid = (low + high) / 2;
+      if (sorted[mid] < value) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  float window[N];
+  float sorted[N];
+  uint16_t head;
+  uint16_t count;
+};
+
+// Exponential moving average with alpha = Numerator / Denominator, O(1).
+template <uint16_t Numerator, uint16_t Denominator>
+class ExponentialFilter {
+ public:
+  ExponentialFilter() { reset(); }
+
+  float update(float sample) {
+    if (isnan(sample)) {
+      return sample;
+    }
+    if (!initialized) {
+      state = sample;
+      initialized = true;
+    } else {
+      state += (sample - state) * ((float)Numerator / Denominator);
+    }
+    return state;
+  }
+
+  float value() const { return initialized ? state : NAN; }
+
+  void reset() {
+    state = 0;
+    initialized = false;
+  }
+
+ private:
+  float state;
+  bool initialized;
+};
+
+// Hampel outlier rejection over N samples: a sample further than
+// ThresholdTenths/10 robust standard deviations (1.4826 * MAD) from the
+// window median is replaced by the median. O(N) per sample.
+template <uint16_t N, uint16_t ThresholdTenths = 30>
+class HampelFilter {
+ public:
+  HampelFilter() { reset(); }
+
+  float update(float sample) {
+    if (isnan(sample)) {
+      return sample;
+    }
+    window.update(sample);
+    if (window.size() < 3) {
+      return sample;
+    }
+    float med = window.median();
+    float sigma = 1.4826f * window.mad();
+    if (fabsf(sample - med) > (ThresholdTenths / 10.0f) * sigma) {
+      outliers++;
+      return med;
+    }
+    return sample;
+  }
+
+  unsigned long outlierCount() const { return outliers; }
+
+  void reset() {
+    window.reset();
+    outliers = 0;
+  }
+
+ private:
+  MedianFilter<N> window;
+  unsigned long outliers;
+};
+
+// Scalar Kalman filter for a slowly varying value (random walk model), O(1).
+// Noise variances are given in thousandths: KalmanFilter1D<10, 500> means
+// process noise q = 0.010 and measurement noise r = 0.500.
+template <uint32_t ProcessNoiseMilli, uint32_t MeasurementNoiseMilli>
+class KalmanFilter1D {
+ public:
+  KalmanFilter1D() { reset(); }
+
+  float update(float measurement) {
+    if (isnan(measurement)) {
+      return measurement;
+    }
+    const float q = ProcessNoiseMilli / 1000.0f;
+    const float r = MeasurementNoiseMilli / 1000.0f;
+    if (!initialized) {
+      estimate = measurement;
+      errorCovariance = r;
+      initialized = true;
+      return estimate;
+    }
+    errorCovariance += q;
+    float gain = errorCovariance / (errorCovariance + r);
+    estimate += gain * (measurement - estimate);
+    errorCovariance *= (1 - gain);
+    return estimate;
+  }
+
+  float value() const { return initialized ? estimate : NAN; }
+
+  void reset() {
+    estimate = 0;
+    errorCovariance = 0;
+    initialized = false;
+  }
+
+ private:
+  float estimate;
+  float errorCovariance;
+  bool initialized;
+};
+
+// Runs a sample through several filters in order, e.g.
+// FilterChain<HampelFilter<7>, KalmanFilter1D<10, 500>> phFilter;
+template <typename First, typename... Rest>
+class FilterChain {
+ public:
+  float update(float sample) { return rest.update(first.update(sample)); }
+  void reset() {
+    first.reset();
+    rest.reset();
+  }
+  First &head() { return first; }
+  FilterChain<Rest...> &tail() { return rest; }
+
+ private:
+  First first;
+  FilterChain<Rest...> rest;
+};
+
+template <typename Last>
+class FilterChain<Last> {
+ public:
+  float update(float sample) { return last.update(sample); }
+  void reset() { last.reset(); }
+  Last &head() { return last; }
+
+ private:
+  Last last;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+// Hardware abstraction for the portable modules (sensors, pump control, calibration,
+// data logger, JSON builders). hal_esp32.cpp maps it onto the Arduino core and ESP-IDF,
+// src/native/ provides host fakes so the same modules build and run on Linux.
+
+// ADC characterization sources
+#define HAL_ADC_CAL_EFUSE_TWO_POINT 0
+#define HAL_ADC_CAL_EFUSE_VREF 1
+#define HAL_ADC_CAL_DEFAULT_VREF 2
+
+// Clock
+unsigned long halMillis();
+unsigned long halMicros();
+void halDelay(unsigned long ms);
+
+// GPIO and PWM
+void halPinMode(uint8_t pin, uint8_t mode);
+int halDigitalRead(uint8_t pin);
+void halDigitalWrite(uint8_t pin, uint8_t level);
+void halPwmSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits);
+void halPwmAttach(uint8_t pin, uint8_t channel);
+void halPwmWrite(uint8_t channel, uint32_t duty);
+
+// ADC1, 12 bit, 11dB attenuation
+uint16_t halAnalogRead(uint8_t pin);
+uint8_t halAdcCharacterize(uint32_t defaultVref);  // Returns HAL_ADC_CAL_*
+uint32_t halAdcToMillivolts(uint16_t code);        // Valid after halAdcCharacterize()
+uint32_t halAdcVref();
+
+// Non-volatile storage (one blob per key)
+size_t halNvsGetBytes(const char* space, const char* key, void* data, size_t length);
+size_t halNvsPutBytes(const char* space, const char* key, const void* data, size_t length);
+
+// Short critical section (no preemption on the calling core) and task watchdog
+void halEnterCritical();
+void halExitCritical();
+void halWatchdogReset();
+
+// Heap (8-bit capable memory)
+uint32_t halFreeHeap();
+uint32_t halMinFreeHeap();       // Low-water mark since boot
+uint32_t halLargestFreeBlock();  // Biggest single allocation that would still succeed
+bool halTaskStackFree(const char* taskName, uint32_t &minFreeBytes); // Stack high-water mark, false if no such task
+const char* halResetReason();    // Cause of the last reset ("poweron", "panic", "task_wdt", ...)
+
+// Calling task and core (task IDs stay valid while the task exists)
+uint32_t halTaskId();
+const char* halTaskName(uint32_t taskId);
+uint8_t halCoreId();
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+// Heap and stack diagnostics (GET /diagnostics): free heap, low-water mark, largest block,
+// fragmentation, stack high-water mark per task, and a history of heap samples next to the
+// web request count, to line fragmentation growth up with request load.
+//
+// HEAP_TRACKING=1 also counts allocations per subsystem. It needs the allocator wrapped at link
+// time, add to build_flags: -DHEAP_TRACKING=1 -Wl,--wrap=malloc -Wl,--wrap=calloc
+// -Wl,--wrap=realloc -Wl,--wrap=free
+
+#ifndef HEAP_TRACKING
+#define HEAP_TRACKING 0
+#endif
+#define HEAP_SAMPLE_INTERVAL_MS 300000  // One history sample every 5 minutes
+#define HEAP_SAMPLES 144                // 12 hours of history
+#define HEAP_MAX_TAGGED_TASKS 8         // Tasks that can enter a HEAP_SCOPE
+#define HEAP_CSV_LINE_MAX 80
+
+// Subsystems allocations are counted against
+#define HEAP_OTHER 0      // Outside any HEAP_SCOPE: WiFi, lwIP, sending responses, Arduino core
+#define HEAP_SENSORS 1
+#define HEAP_CONTROL 2
+#define HEAP_DISPLAY 3
+#define HEAP_LOGGER 4
+#define HEAP_WEB 5
+#define HEAP_SUBSYSTEMS 6
+
+struct HeapSample {
+  uint32_t uptimeS;
+  uint32_t freeHeap;
+  uint32_t largestBlock;
+  uint32_t requests;      // Web requests since boot
+  uint32_t allocations;   // Since boot, 0 without HEAP_TRACKING
+};
+
+struct AllocationStats {
+  uint32_t count;
+  uint64_t bytes;         // Requested, not live
+};
+
+// Copy of the sample history, serialized as CSV lines (for chunked responses)
+struct HeapSamplesExport {
+  HeapSample samples[HEAP_SAMPLES];
+  uint16_t count;
+  uint16_t position;      // Next line: header, then samples oldest first
+  bool done;              // Last sample written
+};
+
+// Function declarations
+void sampleHeap();                      // From loop(), keeps one sample every HEAP_SAMPLE_INTERVAL_MS
+float getHeapFragmentation();           // 1 - largest block / free heap
+uint8_t getWatchedTaskCount();
+const char* getWatchedTaskName(uint8_t index);
+const char* getHeapSubsystemName(uint8_t subsystem);
+AllocationStats getAllocationStats(uint8_t subsystem);
+uint32_t getFreeCount();
+uint16_t getHeapSampleCount();
+void beginHeapSamplesExport(HeapSamplesExport &exp);
+size_t readHeapSamplesExport(HeapSamplesExport &exp, char* buffer, size_t maxLen); // 0 when done or nothing fit, see exp.done
+uint8_t setHeapSubsystem(uint8_t subsystem);  // For the calling task, returns the previous one
+
+#if HEAP_TRACKING
+// Counts the enclosing scope's allocations against a subsystem (nests, restores on exit)
+class HeapScope {
+ public:
+  explicit HeapScope(uint8_t subsystem) : previous(setHeapSubsystem(subsystem)) {}
+  ~HeapScope() { setHeapSubsystem(previous); }
+ private:
+  uint8_t previous;
+};
+
+#define HEAP_CONCAT_(a, b) a##b
+#define HEAP_CONCAT(a, b) HEAP_CONCAT_(a, b)
+#define HEAP_SCOPE(subsystem) HeapScope HEAP_CONCAT(heapScope, __LINE__)(subsystem)
+#else
+#define HEAP_SCOPE(subsystem) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <Arduino.h>
+
+#define HTTP_MAX_HEADERS 6
+
+// One outgoing request, headers are sent in the order they were added
+struct HttpRequest {
+  String url;
+  String headerNames[HTTP_MAX_HEADERS];
+  String headerValues[HTTP_MAX_HEADERS];
+  uint8_t headerCount;
+};
+
+// Function declarations
+void httpBegin(HttpRequest &request, const String &url);
+bool httpAddHeader(HttpRequest &request, const String &name, const String &value);
+int httpPost(const HttpRequest &request, const String &body); // HTTP status code, negative on connection errors
+bool isNetworkConnected();
+void initNetworkMonitor();             // Before connecting, counts (re)connections from then on
+int getNetworkRssi();                  // dBm, 0 while disconnected
+unsigned long getNetworkReconnects();  // Connections after the first one
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef LIGHT_SENSOR_H
+#define LIGHT_SENSOR_H
+
+#include <Arduino.h>
+
+// Function declarations
+bool initLightSensor();   // Starts the I2C bus and the BH1750 in continuous high-res mode
+float readLightLevel();   // Lux, negative on I2C errors
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+// Control loop profiler: how late each one-second control tick starts compared to the timer
+// interrupt that scheduled it, how long each stage of handleSystemUpdate() takes, and which
+// section of loop() held up the ticks that stalled.
+
+#define PROFILE_BUCKETS 12          // Finite bounds, 100us..5s (see loop_profiler.cpp), plus overflow
+#define PROFILE_STALL_US 100000     // A control tick starting this late is logged as a stall
+#define PROFILE_STALL_LOG 16        // Most recent stalls kept
+
+// Stages of handleSystemUpdate()
+#define STAGE_SENSORS 0             // Sensor snapshot
+#define STAGE_PUMP 1
+#define STAGE_PH 2
+#define STAGE_DISPLAY 3
+#define STAGE_PREVIOUS 4            // updatePreviousValues()
+#define STAGE_COUNT 5
+
+// Sections of loop()
+#define SECTION_CONTROL 0
+#define SECTION_LOGGER 1
+#define SECTION_SELF_BENCH 2
+#define SECTION_WEB 3
+#define SECTION_COUNT 4
+
+struct ProfileHistogram {
+  uint32_t buckets[PROFILE_BUCKETS + 1];  // Per bucket, the last one counts everything above 5s
+  uint32_t count;
+  uint64_t sumUs;
+  unsigned long maxUs;
+};
+
+// Loop sections run on every pass (thousands per second), so only their worst case and total
+struct LoopSectionStats {
+  unsigned long maxUs;
+  uint64_t totalUs;
+};
+
+struct StallEvent {
+  unsigned long atMs;           // millis() when the late tick started
+  unsigned long lateUs;         // Actual start minus the interrupt that made it due
+  uint16_t missedTicks;         // Control ticks that fell due while this one was pending
+  uint8_t section;              // Slowest loop section since the previous tick
+  unsigned long sectionUs;
+};
+
+struct LoopProfile {
+  unsigned long ticks;
+  unsigned long missedTicks;
+  unsigned long stalls;
+  ProfileHistogram lateness;
+  unsigned long minIntervalUs;  // Between consecutive tick starts, nominally one second
+  unsigned long maxIntervalUs;
+  ProfileHistogram stages[STAGE_COUNT];
+  LoopSectionStats sections[SECTION_COUNT];
+  StallEvent stallLog[PROFILE_STALL_LOG];  // Ring, the newest is (stalls - 1) % PROFILE_STALL_LOG
+};
+
+// Function declarations (loop task only, except the getters and the reset)
+void beginControlProfile(unsigned long dueUs, uint16_t missedTicks); // Before handleSystemUpdate()
+void profileStage(uint8_t stage);       // After each stage, times it from the previous mark
+void beginLoopProfile();                // Top of loop()
+void profileSection(uint8_t section);   // After each section of loop()
+void resetLoopProfile();
+LoopProfile getLoopProfile();
+unsigned long getProfileBucketUs(uint8_t bucket);
+const char* getStageName(uint8_t stage);
+const char* getSectionName(uint8_t section);
+
+#endif
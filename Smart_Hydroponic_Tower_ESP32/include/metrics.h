@@ -0,0 +1,82 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "hal.h"
+#include "sensor_scheduler.h"
+#include "sensor_health.h"
+
+// Firmware metrics in Prometheus text format (GET /metrics). Latencies go into fixed-bucket
+// histograms, the rest is read from the owning modules when a scrape starts. The export is
+// streamed line by line from that snapshot, so a scrape never builds the whole body in RAM.
+
+#define METRICS_BUCKETS 12         // Finite bounds, 100us..5s (see metrics.cpp), plus +Inf
+#define METRICS_MAX_ROUTES 48      // Distinct web routes timed
+#define METRICS_LINE_MAX 192
+
+// Actuators tracked for activations and on-time
+#define ACTUATOR_WATER_PUMP 0
+#define ACTUATOR_PH_UP 1
+#define ACTUATOR_PH_DOWN 2
+#define ACTUATOR_COUNT 3
+
+struct LatencyHistogram {
+  uint32_t buckets[METRICS_BUCKETS + 1];  // Per bucket (not cumulative), last one is +Inf
+  uint64_t sumUs;
+};
+
+struct RouteMetrics {
+  const char* route;                      // "GET /sensors", static string
+  LatencyHistogram latency;
+};
+
+struct ActuatorMetrics {
+  uint32_t activations;
+  uint64_t onMs;
+  bool on;
+};
+
+// Everything one scrape reports, plus the export position
+struct MetricsExport {
+  unsigned long uptimeMs;
+  uint32_t freeHeap, minFreeHeap, largestFreeBlock;
+  bool networkConnected;
+  int rssi;
+  unsigned long reconnects;
+  LatencyHistogram acquisitionTick, systemUpdate, upload;
+  SchedulerStats scheduler;
+  uint8_t taskCount;
+  const char* taskNames[SCHEDULER_MAX_TASKS];
+  unsigned long taskSamples[SCHEDULER_MAX_TASKS];
+  LatencyHistogram sensorReads[SCHEDULER_MAX_TASKS];
+  SensorHealth health[SENSOR_COUNT];
+  uint8_t routeCount;
+  RouteMetrics routes[METRICS_MAX_ROUTES];
+  uint32_t uploadsOk, uploadsFailed, uploadRetries;
+  ActuatorMetrics actuators[ACTUATOR_COUNT];
+  uint16_t linesSent;
+  bool done;            // Last line written
+};
+
+// Function declarations
+void observeAcquisitionTick(unsigned long us);
+void observeSystemUpdate(unsigned long us);
+void observeSensorRead(uint8_t task, unsigned long us);      // Scheduler task index
+void observeRoute(const char* route, unsigned long us);      // Web handler task only
+void observeUpload(unsigned long us, bool success, uint8_t attempts);
+uint32_t getHttpRequestCount();                              // All timed routes since boot
+void updateActuatorMetrics();                                // Every scheduler tick
+void beginMetricsExport(MetricsExport &exp);
+size_t readMetricsExport(MetricsExport &exp, char* buffer, size_t maxLen); // 0 when done or nothing fit, see exp.done
+
+// Request count and handler latency of one web route
+class RouteTimer {
+ public:
+  explicit RouteTimer(const char* route) : route(route), startUs(halMicros()) {}
+  ~RouteTimer() { observeRoute(route, halMicros() - startUs); }
+ private:
+  const char* route;
+  unsigned long startUs;
+};
+
+#endif
@@ -33,6 +33,7 @@ void enableAutoMode(bool enable);
 PumpConfig getPumpConfig();
 unsigned long getPumpCycleTimeRemaining();
 String getPumpStatusString();
+void reconnectPumpOutputs();     // Restore the pump outputs after a water level interlock
 
 // pH Control Functions
 void updatePHControl();
@@ -0,0 +1,51 @@
+#ifndef SELF_BENCH_H
+#define SELF_BENCH_H
+
+#include <Arduino.h>
+#include "sensor_scheduler.h"
+
+// On-device benchmark: sensor reads are timed as the scheduler runs them, everything the
+// loop owns (display, JSON, HTTP, NVS) is timed one sample per loop pass, so control keeps
+// running while a benchmark is in progress.
+
+#define SELF_BENCH_SAMPLES 32              // Per item (the p99 of fewer samples is their maximum)
+#define SELF_BENCH_SENSOR_WINDOW_MS 15000  // Sensor reads are collected this long (three CO2 periods)
+#define SELF_BENCH_NVS_SAMPLES 10          // Flash writes, kept low for wear
+#define SELF_BENCH_UPLOAD_SAMPLES 3        // Supabase round trips, only on request
+#define SELF_BENCH_AT_BOOT 0               // 1 = run once after setup(), results on Serial and /bench
+
+// Benchmark state
+#define SELF_BENCH_IDLE 0
+#define SELF_BENCH_RUNNING 1
+#define SELF_BENCH_DONE 2
+
+// Loop-owned items, after the scheduler's sensor tasks
+#define SELF_BENCH_DRAW 0
+#define SELF_BENCH_SENSOR_JSON 1
+#define SELF_BENCH_LOGGER_JSON 2
+#define SELF_BENCH_NVS_WRITE 3
+#define SELF_BENCH_UPLOAD 4
+#define SELF_BENCH_LOOP_ITEMS 5
+#define SELF_BENCH_MAX_ITEMS (SCHEDULER_MAX_TASKS + SELF_BENCH_LOOP_ITEMS)
+
+struct SelfBenchItem {
+  const char* name;
+  const char* group;       // "sensor", "display", "json", "nvs", "http"
+  uint16_t count;
+  uint16_t errors;         // Failed uploads or NVS writes (not timed)
+  unsigned long minUs;
+  unsigned long meanUs;
+  unsigned long p99Us;
+  unsigned long maxUs;
+};
+
+// Function declarations
+bool startSelfBench(bool upload);  // upload = include the Supabase round trip; false while one is running
+void serviceSelfBench();           // Call from loop(), takes at most one sample per call
+uint8_t getSelfBenchState();
+unsigned long getSelfBenchDurationMs();
+bool isSelfBenchUploadIncluded();
+uint8_t getSelfBenchItemCount();
+SelfBenchItem getSelfBenchItem(uint8_t index);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <Arduino.h>
+
+// Tracked sensor devices
+#define SENSOR_WATER_TEMP 0  // DS18B20 bus
+#define SENSOR_CO2 1         // MH-Z19
+#define SENSOR_DHT 2         // DHT22 (air temperature and humidity)
+#define SENSOR_LIGHT 3       // BH1750
+#define SENSOR_PH 4          // Analog pH probe
+#define SENSOR_EC 5          // Analog EC probe
+#define SENSOR_COUNT 6
+
+// Error classes
+#define SENSOR_ERROR_NONE 0
+#define SENSOR_ERROR_TIMEOUT 1       // No (complete) reply from the device
+#define SENSOR_ERROR_DISCONNECTED 2  // Device reports itself missing (-127, -1 lux, ADC at the rail)
+#define SENSOR_ERROR_OUT_OF_RANGE 3  // Reply decoded but physically implausible (NaN, 85C power-on value...)
+#define SENSOR_ERROR_CHECKSUM 4      // Corrupted reply
+
+// Back-off policy
+#define SENSOR_FAIL_THRESHOLD 3        // Consecutive failures before a sensor is marked invalid and backed off
+#define SENSOR_BACKOFF_MIN_MS 2000     // First re-probe delay
+#define SENSOR_BACKOFF_MAX_MS 300000   // Re-probe at least every 5 minutes
+
+struct SensorHealth {
+  bool valid;                        // Last reading can be trusted
+  uint8_t errorClass;                // Last error (SENSOR_ERROR_*)
+  unsigned long lastGoodMs;          // millis() of the last good reading (0 = never)
+  unsigned long consecutiveFailures;
+  unsigned long totalFailures;
+  unsigned long backoffMs;           // Current re-probe delay (0 = not backing off)
+  unsigned long lastFailureMs;       // millis() of the last failure
+  bool probing;                      // Re-probe in progress while backing off
+};
+
+// Function declarations
+bool sensorDue(uint8_t sensor);        // false while the sensor is backing off
+void reportSensorSuccess(uint8_t sensor);
+void reportSensorFailure(uint8_t sensor, uint8_t errorClass);
+bool isSensorHealthy(uint8_t sensor);
+SensorHealth getSensorHealth(uint8_t sensor);
+const char* getSensorName(uint8_t sensor);
+const char* getSensorErrorName(uint8_t errorClass);
+
+#endif
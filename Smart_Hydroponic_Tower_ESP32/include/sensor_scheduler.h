@@ -0,0 +1,56 @@
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Scheduler configuration
+#define SCHEDULER_TICK_MS 50              // Hardware timer tick, every period and phase is a multiple of this
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_TICK_BUDGET_US 5000     // Due tasks that would push a tick past this wait one tick
+
+// A sensor read. Returns true when it produced a new sample. Split-phase drivers
+// (start now, collect later) set followUpMs to be called again before their next period.
+typedef bool (*SensorTaskFn)(unsigned long &followUpMs);
+
+// Called after every task run with its duration (e.g. to collect timing samples)
+typedef void (*SchedulerRunHook)(uint8_t task, unsigned long durationUs);
+
+struct SensorTask {
+  const char* name;
+  SensorTaskFn run;
+  unsigned long periodMs;       // Regular read period (changeable at runtime)
+  unsigned long minPeriodMs;    // Fastest the device can be read
+  unsigned long phaseMs;        // Offset of the first read, staggers slow devices across ticks
+  unsigned long costUs;         // Declared cost, used for the tick budget until a run was measured
+  unsigned long anchorMs;       // millis() of the first regular slot
+  unsigned long nextDueMs;
+  bool deferred;                // Pushed back one tick by the budget (runs on the next tick regardless)
+  unsigned long runs;
+  unsigned long samples;
+  unsigned long deferrals;
+  unsigned long lastUs;
+  unsigned long maxUs;
+};
+
+struct SchedulerStats {
+  unsigned long ticks;
+  unsigned long lastTickUs;     // Time spent in the last tick
+  unsigned long maxTickUs;      // Worst tick since boot (or the last reset)
+  unsigned long busyTicks;      // Ticks that ran at least one task
+  unsigned long deferrals;      // Tasks pushed back by the tick budget
+  float samplesPerSecond;       // New samples from all sensors over the last second
+};
+
+// Function declarations
+int addSensorTask(const char* name, SensorTaskFn run, unsigned long periodMs, unsigned long phaseMs,
+                  unsigned long costUs, unsigned long minPeriodMs);
+void runSensorScheduler();                                   // Call once per SCHEDULER_TICK_MS
+bool setSensorTaskPeriod(const char* name, unsigned long periodMs); // Clamped to the task's minimum, applied at the next tick
+void resetSchedulerStats();
+void setSchedulerRunHook(SchedulerRunHook hook);             // NULL removes it
+SchedulerStats getSchedulerStats();
+uint8_t getSensorTaskCount();
+SensorTask getSensorTask(uint8_t index);
+unsigned long getRequestedTaskPeriod(uint8_t index);         // Pending period, or the current one
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SENSOR_STATUS_H
+#define SENSOR_STATUS_H
+
+#include <Arduino.h>
+#include "sensors.h"
+
+// Status levels (shown as green, yellow, orange, red and grey on the display)
+#define STATUS_OK 0
+#define STATUS_CAUTION 1
+#define STATUS_WARNING 2
+#define STATUS_CRITICAL 3
+#define STATUS_INVALID 4   // Sensor failing, left out of the overall status
+
+// Evaluated channels
+#define STATUS_WATER_TEMP 0
+#define STATUS_PH 1
+#define STATUS_EC 2
+#define STATUS_WATER_LEVEL 3
+#define STATUS_PUMP 4        // Not part of the overall status
+#define STATUS_ENV_TEMP 5
+#define STATUS_HUMIDITY 6
+#define STATUS_LIGHT 7
+#define STATUS_CO2 8
+#define STATUS_CHANNEL_COUNT 9
+
+struct SensorStatus {
+  uint8_t channels[STATUS_CHANNEL_COUNT];  // STATUS_* level per channel
+  uint8_t overall;                         // Worst valid sensor channel, raised by faults
+  const char* text;                        // "System OK", "Caution", ... "Pump Fault"
+};
+
+// Function declarations
+void evaluateSensorStatus(const SensorData &data, bool waterLevelFault, SensorStatus &status);
+uint8_t getStatusLevel(float value, float minGood, float maxGood, float minYellow, float maxYellow, float minOrange = -999, float maxOrange = -999);
+uint8_t getStatusLevel(bool status);
+
+#endif
@@ -3,17 +3,34 @@
 
 #include <Arduino.h>
 
+// Validity bits in SensorData.validMask (cleared while a channel's sensor is failing)
+#define SENSOR_VALID_WATER_LEVEL (1 << 0)
+#define SENSOR_VALID_CO2 (1 << 1)
+#define SENSOR_VALID_PH (1 << 2)
+#define SENSOR_VALID_EC (1 << 3)
+#define SENSOR_VALID_WATER_TEMP (1 << 4)
+#define SENSOR_VALID_WATER_TEMP_TOP (1 << 5)
+#define SENSOR_VALID_WATER_TEMP_ROOT (1 << 6)
+#define SENSOR_VALID_ENV_TEMP (1 << 7)
+#define SENSOR_VALID_ENV_HUMIDITY (1 << 8)
+#define SENSOR_VALID_LIGHT (1 << 9)
+#define SENSOR_VALID_ALL (SENSOR_VALID_WATER_LEVEL | SENSOR_VALID_CO2 | SENSOR_VALID_PH | SENSOR_VALID_EC | \
+                          SENSOR_VALID_WATER_TEMP | SENSOR_VALID_ENV_TEMP | SENSOR_VALID_ENV_HUMIDITY | SENSOR_VALID_LIGHT)
+
 // Sensor data structure
 struct SensorData {
   bool waterLevel;
   float co2Level;
   float waterPH;
   float waterEC;
-  float waterTemp;
+  float waterTemp;      // Reservoir probe
+  float waterTempTop;   // Tower top probe
+  float waterTempRoot;  // Root zone probe
   float envTemp;
   float envHumidity;
   float lightLevel;
   bool pumpStatus;
+  uint16_t validMask;   // SENSOR_VALID_* bits, consumers skip channels that aren't set
 };
 
 // Previous values for clearing old text
@@ -27,15 +44,25 @@ struct PreviousValues {
   float envHumidity;
   float lightLevel;
   bool pumpStatus;
+  uint16_t validMask;
 };
 
 // External variables
-extern SensorData currentSensors;
+extern SensorData currentSensors;   // Loop task's copy of the latest snapshot
 extern PreviousValues previousSensors;
 
 // Function declarations
 void initSensors();
-void updateSensorValues();
+void updateSensorValues();         // Acquisition task only, publishes a new snapshot when anything changed
+uint32_t getSensorSnapshot(SensorData &data); // Consistent copy from any task, returns its sequence number
+uint32_t getSensorSnapshotSeq();   // Cheap check whether a newer snapshot was published
 void updatePreviousValues();
+float calculatePHMovingAverage(float newReading);
+inline bool isSensorValid(uint16_t validMask, uint16_t channel) {
+  return (validMask & channel) != 0;
+}
+inline bool isSensorValid(const SensorData& data, uint16_t channel) {
+  return isSensorValid(data.validMask, channel);
+}
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef SPAN_TRACE_H
+#define SPAN_TRACE_H
+
+#include <Arduino.h>
+
+// Span tracer: begin/end events with microsecond timestamps, task and core in a fixed-size
+// ring buffer, exported as Chrome trace_event JSON (open in ui.perfetto.dev).
+// Build with -DTRACE_ENABLED=0 to compile every TRACE_* macro away.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+#define TRACE_BUFFER_EVENTS 512   // Power of two, 20 bytes each on the ESP32 (~20s of loop and web activity)
+#define TRACE_MAX_TASKS 12        // Distinct tasks named in one export
+
+struct TraceEvent {
+  const char* name;     // Static string, only the pointer is stored
+  uint32_t timeUs;
+  uint32_t taskId;
+  uint32_t seq;         // Slot number + 1 once the event is complete
+  char phase;           // 'B' or 'E'
+  uint8_t core;
+};
+
+// Consistent copy of the ring, serialized in pieces (for chunked responses)
+struct TraceExport {
+  TraceEvent events[TRACE_BUFFER_EVENTS];
+  uint16_t eventCount;
+  uint32_t taskIds[TRACE_MAX_TASKS];
+  uint8_t taskCount;
+  uint16_t position;    // Next piece: header, task names, events, footer
+  bool done;            // Footer written
+};
+
+extern volatile bool traceActive;
+
+// Function declarations
+void traceRecord(const char* name, char phase);
+void setTraceActive(bool active);
+void clearTrace();
+uint32_t getTraceEventCount();                                        // Recorded since boot/clear
+void beginTraceExport(TraceExport &exp);
+size_t readTraceExport(TraceExport &exp, char* buffer, size_t maxLen); // 0 when done or nothing fit, see exp.done
+
+#if TRACE_ENABLED
+// Begin/end event for the enclosing scope
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name) : name(name) {
+    if (traceActive) traceRecord(name, 'B');
+  }
+  ~TraceScope() {
+    if (traceActive) traceRecord(name, 'E');
+  }
+ private:
+  const char* name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(name) do { if (traceActive) traceRecord(name, 'B'); } while (0)
+#define TRACE_END(name) do { if (traceActive) traceRecord(name, 'E'); } while (0)
+#else
+#define TRACE_SPAN(name) do {} while (0)
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef WATER_LEVEL_H
+#define WATER_LEVEL_H
+
+#include <Arduino.h>
+
+#define waterLevelPin 14              // GPIO pin for water level sensor (with voltage divider), HIGH = no water
+#define WATER_LEVEL_DEBOUNCE_MS 50    // Level must stay low this long before the fault is latched
+#define WATER_LEVEL_LOCK_PH_DEFAULT true // Also cut the pH pumps when the reservoir runs dry
+
+// Interlock state and edge-to-actuation timing
+struct WaterLevelStats {
+  bool interlocked;               // Pump outputs are forced low
+  bool faultLatched;              // Low level confirmed, stays set until cleared
+  bool lockPHPumps;               // pH pumps are cut together with the water pump
+  unsigned long trips;            // Low-level edges that cut the pumps
+  unsigned long glitches;         // Trips released again because the level recovered within the debounce time
+  unsigned long lastActuationNs;  // Interrupt entry until the pump pins were low
+  unsigned long maxActuationNs;
+  unsigned long lastTripMs;       // millis() of the last trip
+};
+
+// Function declarations
+void initWaterLevel();
+bool isPumpInterlocked();           // Pumps must not be switched on
+bool isWaterLevelFault();           // Latched low-level fault
+bool arePHPumpsLocked();            // Interlocked and configured to cut the pH pumps
+bool clearWaterLevelFault();        // Only succeeds while the level is OK again
+void setWaterLevelPHLock(bool lock);
+WaterLevelStats getWaterLevelStats();
+
+#endif
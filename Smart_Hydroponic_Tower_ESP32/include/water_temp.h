@@ -0,0 +1,47 @@
+#ifndef WATER_TEMP_H
+#define WATER_TEMP_H
+
+#include <Arduino.h>
+
+// DS18B20 water temperature configuration
+#define waterTempPin 13                   // GPIO where the DS18B20 water temp probes are connected to
+#define WATER_TEMP_RESOLUTION_DEFAULT 12  // 12 bit = 0.0625C steps, 750ms conversion
+#define WATER_TEMP_DISCONNECTED -127      // Reported for a probe that didn't answer (DEVICE_DISCONNECTED_C)
+
+// Probe slots on the OneWire bus (slot identity is persisted in NVS by ROM code)
+#define WATER_PROBE_RESERVOIR 0  // Main reservoir probe (reported as waterTemp)
+#define WATER_PROBE_TOWER_TOP 1  // Top of the tower, where the water leaves the pipe
+#define WATER_PROBE_ROOT_ZONE 2  // Root zone inside the growing cups
+#define MAX_WATER_PROBES 3
+
+// Timing of the split-phase DS18B20 acquisition (request on one tick, collect on a later one)
+struct WaterTempTiming {
+  uint8_t resolution;              // Current resolution (9-12 bit)
+  unsigned long conversionTimeMs;  // Datasheet conversion time for the current resolution
+  unsigned long requestUs;         // Time spent starting the last conversion
+  unsigned long readUs;            // Time spent collecting the last result (all probes)
+  unsigned long maxRequestUs;      // Worst request time since boot
+  unsigned long maxReadUs;         // Worst collect time since boot
+  unsigned long conversionMs;      // Time from last request until its result was collected
+  unsigned long readCount;         // Number of results collected since boot
+};
+
+// One registered probe
+struct WaterProbe {
+  uint8_t address[8];  // DS18B20 ROM code
+  bool assigned;       // Slot has a ROM code (stored or discovered)
+  bool present;        // ROM code was found on the bus at the last scan
+};
+
+// Function declarations
+void initWaterTemp();
+bool updateWaterTemp(float temperatures[MAX_WATER_PROBES]); // Returns true when new temperatures were collected
+bool setWaterTempResolution(int bits);     // 9-12, applied before the next conversion starts
+uint8_t getWaterTempResolution();
+void rescanWaterProbes();                  // Forget stored ROM codes and enumerate the bus again
+WaterTempTiming getWaterTempTiming();
+WaterProbe getWaterProbe(uint8_t slot);
+const char* getWaterProbeName(uint8_t slot);
+uint8_t getWaterProbeCount();              // Probes present on the bus
+
+#endif
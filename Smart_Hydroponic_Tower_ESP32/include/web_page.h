@@ -595,39 +595,106 @@ const char index_html[] PROGMEM = R"rawliteral(
             }
         }
         
+        // Live state: pushed over /ws while the socket is open, polled over HTTP while it is not
+        var liveSocket = null;
+        var pollTimers = [];
+        var reconnectDelay = 1000;
+
+        function startPolling() {
+            if (pollTimers.length) return;
+            pollTimers.push(setInterval(updateSensors, 1000));
+            pollTimers.push(setInterval(updatePumpStatus, 1000));
+            pollTimers.push(setInterval(updatePHStatus, 1000));  // Update pH status every 1 seconds
+            pollTimers.push(setInterval(updateLogStatus, 5000));  // Update log status every 5 seconds
+        }
+
+        function stopPolling() {
+            pollTimers.forEach(clearInterval);
+            pollTimers = [];
+        }
+
+        // Returns false when the socket is down, the caller falls back to fetch
+        function sendCommand(command) {
+            if (!liveSocket || liveSocket.readyState !== WebSocket.OPEN) return false;
+            liveSocket.send(JSON.stringify(command));
+            return true;
+        }
+
+        function showCommandResult(msg) {
+            if (msg.cmd.indexOf('pump') === 0) {
+                showApiResult(msg.message, !msg.ok);
+            } else if (msg.cmd.indexOf('ph') === 0) {
+                showPHApiResult(msg.message, !msg.ok);
+            } else {
+                showLogApiResult(msg.message, !msg.ok);
+            }
+        }
+
+        function connectLive() {
+            if (!window.WebSocket) {
+                startPolling();
+                return;
+            }
+            liveSocket = new WebSocket('ws://' + location.host + '/ws');
+            liveSocket.onopen = function() {
+                reconnectDelay = 1000;
+                stopPolling();
+            };
+            liveSocket.onmessage = function(event) {
+                var msg = JSON.parse(event.data);
+                if (msg.type === 'state') {
+                    renderSensors(msg.sensors);
+                    renderPump(msg.pump);
+                    renderPH(msg.ph);
+                    renderLog(msg.logger);
+                } else if (msg.type === 'result') {
+                    showCommandResult(msg);
+                }
+            };
+            liveSocket.onclose = function() {
+                liveSocket = null;
+                startPolling();
+                setTimeout(connectLive, reconnectDelay);
+                reconnectDelay = Math.min(reconnectDelay * 2, 30000);
+            };
+        }
+
+        function renderSensors(data) {
+            document.getElementById('light').textContent = Math.round(data.lightLevel) + ' lux';
+            document.getElementById('envTemp').textContent = data.envTemp + ' °C';
+            document.getElementById('envHum').textContent = Math.round(data.envHum) + ' %';
+            document.getElementById('co2').textContent = data.CO2 + ' ppm';
+            document.getElementById('waterTemp').textContent = data.waterTemp + ' °C';
+            document.getElementById('pH').textContent = data.phLevel;
+            document.getElementById('ec').textContent = data.ecLevel + ' mS/cm';
+            document.getElementById('waterLevel').textContent = data.waterLevel ? 'OK' : 'LOW';
+        }
+
         function updateSensors() {
             fetch('/sensors')
                 .then(response => response.json())
-                .then(data => {
-                    document.getElementById('light').textContent = Math.round(data.lightLevel) + ' lux';
-                    document.getElementById('envTemp').textContent = data.envTemp + ' °C';
-                    document.getElementById('envHum').textContent = Math.round(data.envHum) + ' %';
-                    document.getElementById('co2').textContent = data.CO2 + ' ppm';
-                    document.getElementById('waterTemp').textContent = data.waterTemp + ' °C';
-                    document.getElementById('pH').textContent = data.phLevel;
-                    document.getElementById('ec').textContent = data.ecLevel + ' mS/cm';
-                    document.getElementById('waterLevel').textContent = data.waterLevel ? 'OK' : 'LOW';
-                });
+                .then(renderSensors);
+        }
+
+        function renderPump(data) {
+            // Show status text in the main status field
+            document.getElementById('pumpStatusText').innerHTML = data.statusText;
+
+            // Show On Time and Off Time in minutes, reflecting input
+            document.getElementById('pumpOnTime').textContent  =
+                data.onTime  ? data.onTime  + ' min' : 'N/A';
+            document.getElementById('pumpOffTime').textContent =
+                data.offTime ? data.offTime + ' min' : 'N/A';
+
+            // Update toggle switches
+            updateToggle('pumpToggle', null, data.pumpStatus);
+            updateToggle('autoModeToggle', null, data.autoMode);
         }
 
         function updatePumpStatus() {
             fetch('/pump/status')
                 .then(response => response.json())
-                .then(data => {
-                    // Show status text in the main status field
-                    let statusText = data.statusText;
-                    document.getElementById('pumpStatusText').innerHTML = statusText;
-                    
-                    // Show On Time and Off Time in minutes, reflecting input
-                    document.getElementById('pumpOnTime').textContent  =
-                        data.onTime  ? data.onTime  + ' min' : 'N/A';
-                    document.getElementById('pumpOffTime').textContent =
-                        data.offTime ? data.offTime + ' min' : 'N/A';
-                    
-                    // Update toggle switches
-                    updateToggle('pumpToggle', null, data.pumpStatus);
-                    updateToggle('autoModeToggle', null, data.autoMode);
-             });
+                .then(renderPump);
         }
 
         function showApiResult(msg, isError) {
@@ -642,6 +709,7 @@ const char index_html[] PROGMEM = R"rawliteral(
 
         function togglePump() {
             // Set autoMode to false (manual) when toggling
+            if (sendCommand({cmd: 'pumpConfig', autoMode: false}) && sendCommand({cmd: 'pumpToggle'})) return;
             fetch('/pump/config?autoMode=false', {method: 'PUT'})
                 .then(() => {
                     fetch('/pump/toggle', {method: 'POST'})
@@ -658,6 +726,7 @@ const char index_html[] PROGMEM = R"rawliteral(
             var onTimeMin = document.getElementById('onTime').value;
             var offTimeMin = document.getElementById('offTime').value;
             // Set autoMode to true when updating schedule
+            if (sendCommand({cmd: 'pumpConfig', onTime: parseInt(onTimeMin), offTime: parseInt(offTimeMin), autoMode: true})) return;
            fetch('/pump/config?onTime=' + onTimeMin + '&offTime=' + offTimeMin + '&autoMode=true', { method: 'PUT' })
                 .then(response => response.json())
                 .then(data => {
@@ -673,6 +742,7 @@ const char index_html[] PROGMEM = R"rawliteral(
             const isActive = toggle.classList.contains('active');
             const newMode = !isActive;
             
+            if (sendCommand({cmd: 'pumpConfig', autoMode: newMode})) return;
             fetch('/pump/config?autoMode=' + newMode, {method: 'PUT'})
                 .then(response => response.json())
                 .then(data => {
@@ -683,19 +753,21 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
 
         // pH Control Functions
+        function renderPH(data) {
+            document.getElementById('phStatusText').innerHTML = data.statusText;
+            document.getElementById('phTarget').textContent = data.target;
+            document.getElementById('phTolerance').textContent = '±' + data.tolerance;
+
+            // Update toggle switches
+            updateToggle('phUpToggle', null, data.phStatus);
+            updateToggle('phDownToggle', null, data.phDownStatus);
+            updateToggle('phAutoModeToggle', null, data.autoMode);
+        }
+
         function updatePHStatus() {
             fetch('/ph/status')
                 .then(response => response.json())
-                .then(data => {
-                    document.getElementById('phStatusText').innerHTML = data.statusText;
-                    document.getElementById('phTarget').textContent = data.target;
-                    document.getElementById('phTolerance').textContent = '±' + data.tolerance;
-                    
-                    // Update toggle switches
-                    updateToggle('phUpToggle', null, data.phStatus);
-                    updateToggle('phDownToggle', null, data.phDownStatus);
-                    updateToggle('phAutoModeToggle', null, data.autoMode);
-                })
+                .then(renderPH)
                 .catch(() => {
                     document.getElementById('phStatusText').innerHTML = 'Loading...';
                 });
@@ -712,6 +784,7 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
 
         function togglePHUp() {
+            if (sendCommand({cmd: 'phUp'})) return;
             fetch('/ph/up', {method: 'POST'})
                 .then(response => response.json())
                 .then(data => {
@@ -722,6 +795,7 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
 
         function togglePHDown() {
+            if (sendCommand({cmd: 'phDown'})) return;
             fetch('/ph/down', {method: 'POST'})
                 .then(response => response.json())
                 .then(data => {
@@ -734,6 +808,7 @@ const char index_html[] PROGMEM = R"rawliteral(
         function updatePHControl() {
             var target = document.getElementById('phTargetInput').value;
             var tolerance = document.getElementById('phToleranceInput').value;
+            if (sendCommand({cmd: 'phConfig', target: parseFloat(target), tolerance: parseFloat(tolerance)})) return;
             fetch('/ph/config?target=' + target + '&tolerance=' + tolerance, {method: 'PUT'})
                 .then(response => response.json())
                 .then(data => {
@@ -749,6 +824,7 @@ const char index_html[] PROGMEM = R"rawliteral(
             const isActive = toggle.classList.contains('active');
             const newMode = !isActive;
             
+            if (sendCommand({cmd: 'phConfig', autoMode: newMode})) return;
             fetch('/ph/config?autoMode=' + newMode, {method: 'PUT'})
                 .then(response => response.json())
                 .then(data => {
@@ -759,17 +835,19 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
 
         // Data Logging Functions
+        function renderLog(data) {
+            document.getElementById('logStatus').textContent = data.enabled ? 'Enabled (Every 5 mins)' : 'Disabled';
+            document.getElementById('successfulUploads').textContent = data.successfulUploads || '0';
+            document.getElementById('failedUploads').textContent = data.failedUploads || '0';
+
+            // Update toggle switch
+            updateToggle('dataLogToggle', null, data.enabled);
+        }
+
         function updateLogStatus() {
             fetch('/api/log/status')
                 .then(response => response.json())
-                .then(data => {
-                    document.getElementById('logStatus').textContent = data.enabled ? 'Enabled (Every 5 mins)' : 'Disabled';
-                    document.getElementById('successfulUploads').textContent = data.successfulUploads || '0';
-                    document.getElementById('failedUploads').textContent = data.failedUploads || '0';
-                    
-                    // Update toggle switch
-                    updateToggle('dataLogToggle', null, data.enabled);
-                })
+                .then(renderLog)
                 .catch(() => {
                     document.getElementById('logStatus').textContent = 'Error';
                 });
@@ -786,6 +864,8 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
 
         function toggleDataLogging() {
+            const enabled = document.getElementById('dataLogToggle').classList.contains('active');
+            if (sendCommand({cmd: 'logEnable', enabled: !enabled})) return;
             // First get current status, then toggle
             fetch('/api/log/status')
                 .then(response => response.json())
@@ -803,6 +883,7 @@ const char index_html[] PROGMEM = R"rawliteral(
 
         function triggerManualLog() {
             showLogApiResult('Uploading sensor data...', false);
+            if (sendCommand({cmd: 'logTrigger'})) return;
             fetch('/api/log/trigger', {method: 'POST'})
                 .then(response => response.json())
                 .then(data => {
@@ -822,10 +903,8 @@ const char index_html[] PROGMEM = R"rawliteral(
                 .catch(() => showLogApiResult('Connection test failed', true));
         }
 
-        setInterval(updateSensors, 1000);
-        setInterval(updatePumpStatus, 1000);
-        setInterval(updatePHStatus, 1000);  // Update pH status every 1 seconds
-        setInterval(updateLogStatus, 5000);  // Update log status every 5 seconds
+        startPolling();  // Until the socket is open
+        connectLive();
         updateSensors();
         updatePumpStatus();
         updatePHStatus();
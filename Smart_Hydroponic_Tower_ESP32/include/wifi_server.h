@@ -4,6 +4,10 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
+#include "api_json.h"
+
+#define WS_MAX_CLIENTS 8          // Dashboards on /ws, the oldest are closed beyond this
+#define WS_COMMAND_MAX 256        // Longer control messages are ignored
 
 // WiFi credentials
 extern const char* ssid;
@@ -12,7 +16,7 @@ extern const char* password;
 // Function declarations
 void initWiFi();
 void handleWebServer();
-String getSensorDataJSON();
 void handleCORSOptions(AsyncWebServerRequest *request);
+void updateLiveState();           // After each control tick: /state version, /ws push if anything changed
 
 #endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "adc_sampler.h"
+#include <algorithm>
+#include "driver/adc.h"
+
+static const adc1_channel_t adcChannels[ADC_CHANNEL_COUNT] = {
+  ADC1_CHANNEL_0, // waterPHPin (GPIO 36)
+  ADC1_CHANNEL_6  // waterECPin (GPIO 34)
+};
+
+// Double-buffered windows: the sampler task fills one while the loop reduces the other
+static uint16_t windows[2][ADC_CHANNEL_COUNT][ADC_WINDOW_MAX];
+static volatile uint16_t windowCount[2] = {0, 0};
+static volatile uint8_t activeWindow = 0;
+static volatile unsigned long droppedSamples = 0;
+static portMUX_TYPE windowMux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t samplerTask = NULL;
+static unsigned long lastSwapUs = 0;
+
+static AdcSamplerStats stats = {};
+
+// Sampler task: two raw conversions every ADC_SAMPLE_PERIOD_MS, nothing else
+static void adcSamplerTask(void *parameter) {
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(ADC_SAMPLE_PERIOD_MS));
+
+    uint16_t codes[ADC_CHANNEL_COUNT];
+    for (int ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+      codes[ch] = adc1_get_raw(adcChannels[ch]);
+    }
+
+    portENTER_CRITICAL(&windowMux);
+    uint8_t w = activeWindow;
+    uint16_t n = windowCount[w];
+    if (n < ADC_WINDOW_MAX) {
+      for (int ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+        windows[w][ch][n] = codes[ch];
+      }
+      windowCount[w] = n + 1;
+    } else {
+      droppedSamples++;
+    }
+    portEXIT_CRITICAL(&windowMux);
+  }
+}
+
+static void reduceWindow(uint16_t *samples, uint16_t count, AdcWindow &result) {
+  result.samples = count;
+  if (count == 0) {
+    return;
+  }
+
+  // Variance over the whole window (Welford, no large sums)
+  float mean = 0, m2 = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    float delta = samples[i] - mean;
+    mean += delta / (i + 1);
+    m2 += delta * (samples[i] - mean);
+  }
+  result.variance = count > 1 ? m2 / (count - 1) : 0;
+
+  std::sort(samples, samples + count);
+  result.minCode = samples[0];
+  result.maxCode = samples[count - 1];
+  result.median = (count % 2) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0f;
+
+  uint16_t trim = count * ADC_TRIM_PERCENT / 100;
+  uint32_t sum = 0;
+  for (uint16_t i = trim; i < count - trim; i++) {
+    sum += samples[i];
+  }
+  result.trimmedMean = (float)sum / (count - 2 * trim);
+}
+
+bool initAdcSampler() {
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  for (int ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+    adc1_config_channel_atten(adcChannels[ch], ADC_ATTEN_DB_11); // Same range as analogRead()
+  }
+
+  lastSwapUs = micros();
+  BaseType_t created = xTaskCreatePinnedToCore(adcSamplerTask, "adc_sampler", 2048, NULL,
+                                               ADC_SAMPLER_PRIORITY, &samplerTask, ADC_SAMPLER_CORE);
+  stats.running = (created == pdPASS);
+  if (!stats.running) {
+    Serial.println("ADC sampler task failed to start, using analogRead()");
+  }
+  return stats.running;
+}
+
+bool updateAdcSampler(float values[ADC_CHANNEL_COUNT]) {
+  if (!stats.running) {
+    return false;
+  }
+
+  // Swap buffers; the sampler continues in the other one immediately
+  portENTER_CRITICAL(&windowMux);
+  uint8_t full = activeWindow;
+  activeWindow = full ^ 1;
+  windowCount[activeWindow] = 0;
+  uint16_t count = windowCount[full];
+  portEXIT_CRITICAL(&windowMux);
+
+  unsigned long nowUs = micros();
+  unsigned long windowUs = nowUs - lastSwapUs;
+  lastSwapUs = nowUs;
+  if (count == 0) {
+    return false;
+  }
+
+  for (int ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+    reduceWindow(windows[full][ch], count, stats.last[ch]);
+    values[ch] = stats.last[ch].trimmedMean;
+  }
+
+  stats.sampleRateHz = windowUs > 0 ? count * 1000000.0f / windowUs : 0;
+  stats.windows++;
+  stats.droppedSamples = droppedSamples;
+  stats.reduceUs = micros() - nowUs;
+  return true;
+}
+
+AdcSamplerStats getAdcSamplerStats() {
+  return stats;
+}
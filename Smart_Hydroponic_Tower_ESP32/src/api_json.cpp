@@ -0,0 +1,480 @@
+#include "api_json.h"
+#include "hal.h"
+#include "sensors.h"
+#include "pump_control.h"
+#include "data_logger.h"
+#include "water_temp.h"
+#include "co2_sensor.h"
+#include "dht_sensor.h"
+#include "adc_sampler.h"
+#include "sensor_health.h"
+#include "sensor_scheduler.h"
+#include "water_level.h"
+#include "calibration.h"
+#include "self_bench.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
+#include "metrics.h"
+
+// /sensors fields, also the "sensors" object of the pushed state
+static void addSensorFields(JsonObject obj, const SensorData &sensors) {
+  // Add sensor data to JSON with rounded values
+  obj["lightLevel"] = round(sensors.lightLevel * 1);            // 0 decimal places
+  obj["envTemp"] = round(sensors.envTemp * 100) / 100.0;        // 2 decimal place
+  obj["envHum"] = round(sensors.envHumidity * 1);               // 0 decimal place
+  obj["CO2"] = sensors.co2Level;                                // Keep as integer
+  obj["waterTemp"] = round(sensors.waterTemp * 10) / 10.0;      // 1 decimal place
+  obj["waterTempTop"] = round(sensors.waterTempTop * 10) / 10.0; // 1 decimal place
+  obj["waterTempRoot"] = round(sensors.waterTempRoot * 10) / 10.0; // 1 decimal place
+  obj["phLevel"] = round(sensors.waterPH * 100) / 100.0;        // 2 decimal places
+  obj["ecLevel"] = round(sensors.waterEC * 100) / 100.0;        // 2 decimal places
+  obj["waterLevel"] = sensors.waterLevel;                       // Keep as boolean
+  obj["pumpStatus"] = sensors.pumpStatus;                       // Add pump status
+
+  // Per-channel validity, false while a sensor is failing and the value above is stale
+  JsonObject valid = obj.createNestedObject("valid");
+  valid["lightLevel"] = isSensorValid(sensors, SENSOR_VALID_LIGHT);
+  valid["envTemp"] = isSensorValid(sensors, SENSOR_VALID_ENV_TEMP);
+  valid["envHum"] = isSensorValid(sensors, SENSOR_VALID_ENV_HUMIDITY);
+  valid["CO2"] = isSensorValid(sensors, SENSOR_VALID_CO2);
+  valid["waterTemp"] = isSensorValid(sensors, SENSOR_VALID_WATER_TEMP);
+  valid["waterTempTop"] = isSensorValid(sensors, SENSOR_VALID_WATER_TEMP_TOP);
+  valid["waterTempRoot"] = isSensorValid(sensors, SENSOR_VALID_WATER_TEMP_ROOT);
+  valid["phLevel"] = isSensorValid(sensors, SENSOR_VALID_PH);
+  valid["ecLevel"] = isSensorValid(sensors, SENSOR_VALID_EC);
+}
+
+String getSensorDataJSON() {
+  StaticJsonDocument<640> doc;
+  SensorData sensors;
+  uint32_t seq = getSensorSnapshot(sensors); // All fields from the same acquisition tick
+
+  addSensorFields(doc.to<JsonObject>(), sensors);
+  doc["seq"] = seq;                          // Snapshot sequence, unchanged = same data
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+// Every field of the combined state as buildLiveState() writes it, in the same order
+const StateField stateFields[STATE_FIELD_COUNT] = {
+  {"sensors", "lightLevel"}, {"sensors", "envTemp"}, {"sensors", "envHum"}, {"sensors", "CO2"},
+  {"sensors", "waterTemp"}, {"sensors", "waterTempTop"}, {"sensors", "waterTempRoot"},
+  {"sensors", "phLevel"}, {"sensors", "ecLevel"}, {"sensors", "waterLevel"}, {"sensors", "pumpStatus"},
+  {"sensors", "valid"},
+  {"pump", "pumpStatus"}, {"pump", "statusText"}, {"pump", "autoMode"}, {"pump", "onTime"},
+  {"pump", "offTime"}, {"pump", "waterLevelFault"}, {"pump", "interlocked"},
+  {"ph", "phStatus"}, {"ph", "phDownStatus"}, {"ph", "statusText"}, {"ph", "autoMode"},
+  {"ph", "target"}, {"ph", "tolerance"},
+  {"logger", "enabled"}, {"logger", "lastStatus"}, {"logger", "successfulUploads"}, {"logger", "failedUploads"},
+};
+
+// Everything the dashboard shows, same fields as /sensors (without seq), /pump/status,
+// /ph/status and /api/log/status. No sequence number, so an unchanged field serializes
+// to the same string.
+void buildLiveState(JsonDocument &doc) {
+  SensorData sensors;
+  getSensorSnapshot(sensors);
+
+  addSensorFields(doc.createNestedObject("sensors"), sensors);
+
+  PumpConfig pumpConfig = getPumpConfig();
+  JsonObject pump = doc.createNestedObject("pump");
+  pump["pumpStatus"] = getPumpState();
+  pump["statusText"] = getPumpStatusString();
+  pump["autoMode"] = pumpConfig.autoMode;
+  pump["onTime"] = pumpConfig.onTime / 60000;
+  pump["offTime"] = pumpConfig.offTime / 60000;
+  pump["waterLevelFault"] = isWaterLevelFault();
+  pump["interlocked"] = isPumpInterlocked();
+
+  PHConfig phConfig = getPHConfig();
+  JsonObject ph = doc.createNestedObject("ph");
+  ph["phStatus"] = getPHUpState();
+  ph["phDownStatus"] = getPHDownState();
+  ph["statusText"] = getPHControlStatus();
+  ph["autoMode"] = phConfig.autoMode;
+  ph["target"] = round(phConfig.target * 10) / 10.0;
+  ph["tolerance"] = round(phConfig.tolerance * 10) / 10.0;
+
+  JsonObject logger = doc.createNestedObject("logger");
+  logger["enabled"] = isDataLoggerEnabled();
+  logger["lastStatus"] = getLoggerStatus();
+  logger["successfulUploads"] = getSuccessfulUploadCount();
+  logger["failedUploads"] = getFailedUploadCount();
+}
+
+String getLiveStateJSON() {
+  DynamicJsonDocument doc(STATE_JSON_CAPACITY);
+  doc["type"] = "state";
+  buildLiveState(doc);
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+bool parseStateFields(const String &fields, StateFieldMask &mask) {
+  mask = 0;
+  unsigned int start = 0;
+  while (start <= fields.length()) {
+    int end = fields.indexOf(',', start);
+    if (end < 0) {
+      end = fields.length();
+    }
+    String field = fields.substring(start, end);
+    StateFieldMask matched = 0;
+    for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+      if (field == stateFields[i].section || field == String(stateFields[i].section) + "." + stateFields[i].key) {
+        matched |= (StateFieldMask)1 << i;
+      }
+    }
+    if (matched == 0) {
+      return false;
+    }
+    mask |= matched;
+    start = end + 1;
+  }
+  return true;
+}
+
+String getWaterTempTimingJSON() {
+  WaterTempTiming timing = getWaterTempTiming();
+  StaticJsonDocument<768> doc;
+
+  doc["resolution"] = timing.resolution;                // Active resolution in bits
+  doc["requestedResolution"] = getWaterTempResolution(); // Applied before the next conversion
+  doc["conversionTimeMs"] = timing.conversionTimeMs;
+  doc["lastConversionMs"] = timing.conversionMs;        // Request to collect, spans one tick
+  doc["requestUs"] = timing.requestUs;                  // Loop time spent per tick
+  doc["readUs"] = timing.readUs;
+  doc["maxRequestUs"] = timing.maxRequestUs;
+  doc["maxReadUs"] = timing.maxReadUs;
+  doc["readCount"] = timing.readCount;
+  doc["probeCount"] = getWaterProbeCount();
+
+  // Registered probes with their persisted ROM codes
+  JsonArray probes = doc.createNestedArray("probes");
+  for (uint8_t i = 0; i < MAX_WATER_PROBES; i++) {
+    WaterProbe probe = getWaterProbe(i);
+    char rom[17] = "";
+    if (probe.assigned) {
+      for (int b = 0; b < 8; b++) {
+        sprintf(rom + b * 2, "%02X", probe.address[b]);
+      }
+    }
+    JsonObject entry = probes.createNestedObject();
+    entry["name"] = getWaterProbeName(i);
+    entry["rom"] = rom; // Copied into the document since it is a char array
+    entry["present"] = probe.present;
+  }
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getCO2StatsJSON() {
+  CO2Stats stats = getCO2Stats();
+  StaticJsonDocument<320> doc;
+
+  SensorData sensors;
+  getSensorSnapshot(sensors);
+  doc["co2"] = sensors.co2Level;                  // Last published value (ppm)
+  doc["stale"] = stats.stale;                     // No valid frame for a while
+  doc["commandsSent"] = stats.commandsSent;
+  doc["framesReceived"] = stats.framesReceived;
+  doc["checksumErrors"] = stats.checksumErrors;
+  doc["framingErrors"] = stats.framingErrors;
+  doc["timeouts"] = stats.timeouts;
+  doc["overflows"] = stats.overflows;
+  doc["discardedBytes"] = stats.discardedBytes;   // Arrived after the timeout or during back-off
+  doc["lastLatencyUs"] = stats.lastLatencyUs;     // Command sent until reply received
+  doc["maxLatencyUs"] = stats.maxLatencyUs;
+  doc["lastFrameAgeMs"] = stats.framesReceived ? halMillis() - stats.lastFrameMs : 0;
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getDHTStatsJSON() {
+  DHTStats stats = getDHTStats();
+  StaticJsonDocument<256> doc;
+
+  doc["backend"] = stats.backend == DHT_BACKEND_RMT ? "rmt" : "adafruit";
+  doc["requestedBackend"] = getDHTBackend() == DHT_BACKEND_RMT ? "rmt" : "adafruit"; // Differs until the switch is applied
+  doc["reads"] = stats.reads;
+  doc["checksumErrors"] = stats.checksumErrors;
+  doc["timeouts"] = stats.timeouts;
+  doc["lastLoopUs"] = stats.lastLoopUs;           // Loop time per read (Adafruit: interrupts masked)
+  doc["maxLoopUs"] = stats.maxLoopUs;
+  doc["lastReadAgeMs"] = stats.reads ? halMillis() - stats.lastReadMs : 0;
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getAdcSamplerJSON() {
+  AdcSamplerStats stats = getAdcSamplerStats();
+  StaticJsonDocument<512> doc;
+  static const char* channelNames[ADC_CHANNEL_COUNT] = {"ph", "ec"};
+
+  doc["running"] = stats.running;                 // false = one analogRead() per tick
+  doc["sampleRateHz"] = round(stats.sampleRateHz * 10) / 10.0; // Per channel
+  doc["windows"] = stats.windows;
+  doc["droppedSamples"] = stats.droppedSamples;
+  doc["reduceUs"] = stats.reduceUs;               // Loop time spent per window
+
+  for (int ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+    JsonObject window = doc.createNestedObject(channelNames[ch]);
+    window["samples"] = stats.last[ch].samples;
+    window["trimmedMean"] = round(stats.last[ch].trimmedMean * 10) / 10.0; // Raw ADC codes
+    window["median"] = stats.last[ch].median;
+    window["variance"] = round(stats.last[ch].variance * 10) / 10.0;
+    window["min"] = stats.last[ch].minCode;
+    window["max"] = stats.last[ch].maxCode;
+  }
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getSensorHealthJSON() {
+  DynamicJsonDocument doc(1536);
+  unsigned long now = halMillis();
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    SensorHealth health = getSensorHealth(i);
+    JsonObject sensor = doc.createNestedObject(getSensorName(i));
+    sensor["valid"] = health.valid;
+    sensor["error"] = getSensorErrorName(health.errorClass);
+    sensor["lastGoodAgeMs"] = health.lastGoodMs ? now - health.lastGoodMs : 0;
+    sensor["consecutiveFailures"] = health.consecutiveFailures;
+    sensor["totalFailures"] = health.totalFailures;
+    sensor["backoffMs"] = health.backoffMs;       // 0 = read every tick
+    unsigned long sinceFailure = now - health.lastFailureMs;
+    sensor["nextRetryInMs"] = (health.backoffMs && sinceFailure < health.backoffMs) ? health.backoffMs - sinceFailure : 0;
+  }
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getSchedulerJSON() {
+  SchedulerStats stats = getSchedulerStats();
+  DynamicJsonDocument doc(2048);
+
+  doc["tickMs"] = SCHEDULER_TICK_MS;
+  doc["ticks"] = stats.ticks;
+  doc["busyTicks"] = stats.busyTicks;             // Ticks that read at least one sensor
+  doc["lastTickUs"] = stats.lastTickUs;
+  doc["maxTickUs"] = stats.maxTickUs;             // Worst-case tick duration
+  doc["deferrals"] = stats.deferrals;
+  doc["samplesPerSecond"] = round(stats.samplesPerSecond * 10) / 10.0;
+
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (uint8_t i = 0; i < getSensorTaskCount(); i++) {
+    SensorTask task = getSensorTask(i);
+    JsonObject entry = tasks.createNestedObject();
+    entry["name"] = task.name;
+    entry["periodMs"] = task.periodMs;
+    entry["requestedPeriodMs"] = getRequestedTaskPeriod(i); // Applied at the next tick
+    entry["minPeriodMs"] = task.minPeriodMs;
+    entry["phaseMs"] = task.phaseMs;
+    entry["costUs"] = task.costUs;                // Declared
+    entry["lastUs"] = task.lastUs;                // Measured
+    entry["maxUs"] = task.maxUs;
+    entry["runs"] = task.runs;
+    entry["samples"] = task.samples;
+    entry["deferrals"] = task.deferrals;
+  }
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getWaterLevelJSON() {
+  WaterLevelStats stats = getWaterLevelStats();
+  StaticJsonDocument<320> doc;
+
+  doc["faultLatched"] = stats.faultLatched;
+  doc["interlocked"] = stats.interlocked;          // Pump outputs forced low
+  doc["lockPH"] = stats.lockPHPumps;
+  doc["trips"] = stats.trips;
+  doc["glitches"] = stats.glitches;                // Released again within the debounce time
+  doc["lastActuationNs"] = stats.lastActuationNs;  // Interrupt entry until the pump pins were low
+  doc["maxActuationNs"] = stats.maxActuationNs;
+  doc["lastTripAgeMs"] = stats.trips ? halMillis() - stats.lastTripMs : 0;
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getCalibrationJSON() {
+  CalibrationData calibration = getCalibration();
+  StaticJsonDocument<768> doc;
+
+  JsonObject adc = doc.createNestedObject("adc");
+  adc["source"] = getAdcCalibrationSource();       // Per-chip eFuse data used for the ADC curve
+  adc["vref"] = getAdcCalibrationVref();
+  adc["tableStep"] = CALIBRATION_TABLE_STEP;       // Raw codes between lookup table entries
+
+  JsonObject ph = doc.createNestedObject("ph");
+  ph["points"] = calibration.phPoints;             // Below 2 = uncalibrated formula
+  JsonArray buffers = ph.createNestedArray("buffers");
+  for (int i = 0; i < calibration.phPoints; i++) {
+    JsonObject buffer = buffers.createNestedObject();
+    buffer["ph"] = calibration.ph[i].ph;
+    buffer["mV"] = round(calibration.ph[i].millivolts * 10) / 10.0;
+  }
+  JsonArray slopes = ph.createNestedArray("slopeMvPerPH"); // One per segment between buffers
+  for (int i = 1; i < calibration.phPoints; i++) {
+    float slope = (calibration.ph[i].millivolts - calibration.ph[i - 1].millivolts) / (calibration.ph[i].ph - calibration.ph[i - 1].ph);
+    slopes.add(round(slope * 100) / 100.0);
+  }
+
+  JsonObject ec = doc.createNestedObject("ec");
+  ec["kLow"] = calibration.ecKLow;
+  ec["kHigh"] = calibration.ecKHigh;
+  ec["rangeSplit"] = EC_RANGE_SPLIT;
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getSelfBenchJSON() {
+  static const char* states[] = {"idle", "running", "done"};
+  DynamicJsonDocument doc(3072);
+
+  doc["state"] = states[getSelfBenchState()];
+  doc["durationMs"] = getSelfBenchDurationMs();
+  doc["upload"] = isSelfBenchUploadIncluded();
+  doc["build"] = __DATE__ " " __TIME__;            // Tells firmware builds apart
+
+  JsonArray items = doc.createNestedArray("items");
+  for (uint8_t i = 0; i < getSelfBenchItemCount(); i++) {
+    SelfBenchItem item = getSelfBenchItem(i);
+    JsonObject entry = items.createNestedObject();
+    entry["name"] = item.name;
+    entry["group"] = item.group;
+    entry["count"] = item.count;
+    entry["errors"] = item.errors;
+    entry["minUs"] = item.minUs;
+    entry["meanUs"] = item.meanUs;
+    entry["p99Us"] = item.p99Us;
+    entry["maxUs"] = item.maxUs;
+  }
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+static void addProfileHistogram(JsonObject entry, const ProfileHistogram &histogram) {
+  entry["count"] = histogram.count;
+  entry["meanUs"] = histogram.count ? (unsigned long)(histogram.sumUs / histogram.count) : 0;
+  entry["maxUs"] = histogram.maxUs;
+  JsonArray buckets = entry.createNestedArray("buckets");  // Per bucket, see bucketsUs
+  for (uint8_t i = 0; i <= PROFILE_BUCKETS; i++) {
+    buckets.add(histogram.buckets[i]);
+  }
+}
+
+String getLoopProfileJSON() {
+  LoopProfile profile = getLoopProfile();
+  DynamicJsonDocument doc(6144);
+
+  doc["ticks"] = profile.ticks;
+  doc["missedTicks"] = profile.missedTicks;        // Control ticks lost while one was pending
+  doc["stalls"] = profile.stalls;
+  doc["stallThresholdUs"] = PROFILE_STALL_US;
+  doc["minIntervalUs"] = profile.minIntervalUs;
+  doc["maxIntervalUs"] = profile.maxIntervalUs;
+
+  JsonArray bounds = doc.createNestedArray("bucketsUs");  // Upper bounds, one more bucket above
+  for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) {
+    bounds.add(getProfileBucketUs(i));
+  }
+  addProfileHistogram(doc.createNestedObject("lateness"), profile.lateness);
+
+  JsonObject stages = doc.createNestedObject("stages");
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    addProfileHistogram(stages.createNestedObject(getStageName(i)), profile.stages[i]);
+  }
+
+  JsonObject sections = doc.createNestedObject("loop");
+  for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+    JsonObject entry = sections.createNestedObject(getSectionName(i));
+    entry["maxUs"] = profile.sections[i].maxUs;
+    entry["totalMs"] = (unsigned long)(profile.sections[i].totalUs / 1000);
+  }
+
+  // Newest first
+  JsonArray stalls = doc.createNestedArray("stallLog");
+  uint8_t logged = min(profile.stalls, (unsigned long)PROFILE_STALL_LOG);
+  for (uint8_t i = 0; i < logged; i++) {
+    const StallEvent &event = profile.stallLog[(profile.stalls - 1 - i) % PROFILE_STALL_LOG];
+    JsonObject entry = stalls.createNestedObject();
+    entry["ageMs"] = halMillis() - event.atMs;
+    entry["lateUs"] = event.lateUs;
+    entry["missedTicks"] = event.missedTicks;
+    entry["section"] = getSectionName(event.section);
+    entry["sectionUs"] = event.sectionUs;
+  }
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+String getHeapDiagnosticsJSON() {
+  DynamicJsonDocument doc(2048);
+
+  doc["resetReason"] = halResetReason();
+  doc["uptimeMs"] = halMillis();
+
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["freeBytes"] = halFreeHeap();
+  heap["minFreeBytes"] = halMinFreeHeap();           // Lowest since boot
+  heap["largestBlockBytes"] = halLargestFreeBlock();
+  heap["fragmentation"] = round(getHeapFragmentation() * 1000) / 1000.0; // 1 - largest block / free
+
+  // Least free stack each task has had, tasks that don't exist are left out
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (uint8_t i = 0; i < getWatchedTaskCount(); i++) {
+    uint32_t minFreeBytes;
+    if (halTaskStackFree(getWatchedTaskName(i), minFreeBytes)) {
+      JsonObject entry = tasks.createNestedObject();
+      entry["name"] = getWatchedTaskName(i);
+      entry["stackFreeMinBytes"] = minFreeBytes;
+    }
+  }
+
+  JsonObject allocations = doc.createNestedObject("allocations");
+  allocations["tracking"] = HEAP_TRACKING != 0;
+  allocations["frees"] = getFreeCount();
+  JsonArray subsystems = allocations.createNestedArray("subsystems");
+  for (uint8_t i = 0; i < HEAP_SUBSYSTEMS; i++) {
+    AllocationStats stats = getAllocationStats(i);
+    JsonObject entry = subsystems.createNestedObject();
+    entry["name"] = getHeapSubsystemName(i);
+    entry["count"] = stats.count;
+    entry["bytes"] = stats.bytes;
+  }
+
+  doc["requests"] = getHttpRequestCount();
+  doc["samples"] = getHeapSampleCount();              // History on /diagnostics/samples
+  doc["sampleIntervalMs"] = HEAP_SAMPLE_INTERVAL_MS;
+
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
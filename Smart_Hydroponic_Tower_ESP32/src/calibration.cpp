@@ -0,0 +1,214 @@
+#include "calibration.h"
+#include "adc_sampler.h"
+#include "hal.h"
+
+#define CALIBRATION_VERSION 1
+
+static uint8_t adcCalSource;
+static CalibrationData calibration;
+
+// Raw code to pin voltage, built once from the eFuse characterization
+static float millivoltTable[CALIBRATION_TABLE_SIZE];
+
+// Double-buffered so a rebuild from a web request never tears a conversion in progress
+static float phTables[2][CALIBRATION_TABLE_SIZE];
+static float ecTables[2][CALIBRATION_TABLE_SIZE];   // Uncompensated EC at 25C
+static volatile uint8_t activeTable = 0;
+
+static void setDefaultPH() {
+  calibration.phPoints = 0;
+  memset(calibration.ph, 0, sizeof(calibration.ph));
+}
+
+static void setDefaultEC() {
+  calibration.ecKLow = 1.0;
+  calibration.ecKHigh = 1.0;
+}
+
+static void loadCalibration() {
+  size_t length = halNvsGetBytes("calibration", "cal", &calibration, sizeof(calibration));
+  if (length != sizeof(calibration) || calibration.version != CALIBRATION_VERSION) {
+    calibration.version = CALIBRATION_VERSION;
+    setDefaultPH();
+    setDefaultEC();
+  }
+}
+
+static void saveCalibration() {
+  halNvsPutBytes("calibration", "cal", &calibration, sizeof(calibration));
+}
+
+// Piecewise linear through the buffer points (acid and base segment for three points)
+static float phFromMillivolts(float millivolts, float code) {
+  if (calibration.phPoints < 2) {
+    return PH_LEGACY_SLOPE * (code * 5 / 4096.0) + PH_LEGACY_OFFSET;
+  }
+  const PHCalPoint *p = calibration.ph;
+  uint8_t segment = 0;
+  if (calibration.phPoints == 3 && (millivolts - p[1].millivolts) * (p[0].millivolts - p[1].millivolts) <= 0) {
+    segment = 1; // Not on the acid side of the middle buffer
+  }
+  const PHCalPoint &a = p[segment];
+  const PHCalPoint &b = p[segment + 1];
+  return a.ph + (millivolts - a.millivolts) * (b.ph - a.ph) / (b.millivolts - a.millivolts);
+}
+
+static float ecFromMillivolts(float millivolts) {
+  float rawEC = 1000 * millivolts / EC_RES2 / EC_REF;
+  float ec = rawEC * calibration.ecKLow;
+  if (ec > EC_RANGE_SPLIT) {
+    ec = rawEC * calibration.ecKHigh;
+  }
+  return ec;
+}
+
+static void buildTables() {
+  uint8_t next = activeTable ^ 1;
+  for (int i = 0; i < CALIBRATION_TABLE_SIZE; i++) {
+    float code = i * CALIBRATION_TABLE_STEP;
+    phTables[next][i] = phFromMillivolts(millivoltTable[i], code);
+    ecTables[next][i] = ecFromMillivolts(millivoltTable[i]);
+  }
+  activeTable = next;
+}
+
+// Table lookup plus linear interpolation
+static float interpolate(const float *table, float code) {
+  if (code <= 0) {
+    return table[0];
+  }
+  if (code >= 4095) {
+    code = 4095;
+  }
+  int index = (int)code / CALIBRATION_TABLE_STEP;
+  float fraction = (code - index * CALIBRATION_TABLE_STEP) / CALIBRATION_TABLE_STEP;
+  return table[index] + (table[index + 1] - table[index]) * fraction;
+}
+
+void initCalibration() {
+  adcCalSource = halAdcCharacterize(CALIBRATION_DEFAULT_VREF);
+  for (int i = 0; i < CALIBRATION_TABLE_SIZE; i++) {
+    uint32_t code = min(i * CALIBRATION_TABLE_STEP, 4095);
+    millivoltTable[i] = halAdcToMillivolts(code);
+  }
+
+  loadCalibration();
+  buildTables();
+  Serial.printf("Calibration: ADC %s, pH %d-point, EC k=%.3f/%.3f\n", getAdcCalibrationSource(),
+                calibration.phPoints, calibration.ecKLow, calibration.ecKHigh);
+}
+
+float adcCodeToMillivolts(float code) {
+  return interpolate(millivoltTable, code);
+}
+
+float convertPH(float code) {
+  return interpolate(phTables[activeTable], code);
+}
+
+float convertEC(float code, float temperature) {
+  return interpolate(ecTables[activeTable], code) / (1 + EC_TEMP_COEFFICIENT * (temperature - 25));
+}
+
+float readCalibrationCode(uint8_t channel) {
+  AdcSamplerStats stats = getAdcSamplerStats();
+  if (stats.running && stats.last[channel].samples > 0) {
+    return stats.last[channel].trimmedMean; // Hundreds of samples already averaged
+  }
+  uint32_t sum = 0;
+  for (int i = 0; i < 64; i++) {
+    sum += halAnalogRead(channel == ADC_CHANNEL_PH ? waterPHPin : waterECPin);
+  }
+  return sum / 64.0;
+}
+
+bool calibratePH(float bufferPH, float code) {
+  if (bufferPH <= 0 || bufferPH >= 14 || code <= 0 || code >= 4095) {
+    return false;
+  }
+  CalibrationData previous = calibration;
+  PHCalPoint point = {adcCodeToMillivolts(code), bufferPH};
+
+  // Re-measuring a buffer replaces its point, a new buffer is added (or replaces the nearest one)
+  int nearest = -1;
+  for (int i = 0; i < calibration.phPoints; i++) {
+    if (nearest < 0 || fabs(calibration.ph[i].ph - bufferPH) < fabs(calibration.ph[nearest].ph - bufferPH)) {
+      nearest = i;
+    }
+  }
+  if (nearest >= 0 && (fabs(calibration.ph[nearest].ph - bufferPH) < 1.0 || calibration.phPoints == PH_CAL_MAX_POINTS)) {
+    calibration.ph[nearest] = point;
+  } else {
+    calibration.ph[calibration.phPoints++] = point;
+  }
+
+  // Keep the points sorted by pH
+  for (int i = 1; i < calibration.phPoints; i++) {
+    for (int j = i; j > 0 && calibration.ph[j].ph < calibration.ph[j - 1].ph; j--) {
+      PHCalPoint swap = calibration.ph[j];
+      calibration.ph[j] = calibration.ph[j - 1];
+      calibration.ph[j - 1] = swap;
+    }
+  }
+  for (int i = 1; i < calibration.phPoints; i++) {
+    if (fabs(calibration.ph[i].millivolts - calibration.ph[i - 1].millivolts) < PH_CAL_MIN_SPAN_MV) {
+      calibration = previous; // Probe didn't respond to the new buffer
+      return false;
+    }
+  }
+
+  saveCalibration();
+  buildTables();
+  Serial.printf("pH calibration: buffer %.2f at %.1fmV (%d points)\n", bufferPH, point.millivolts, calibration.phPoints);
+  return true;
+}
+
+bool calibrateEC(float standard, float code, float temperature) {
+  float millivolts = adcCodeToMillivolts(code);
+  float rawEC = 1000 * millivolts / EC_RES2 / EC_REF;
+  if (standard <= 0 || rawEC <= 0 || code >= 4095) {
+    return false;
+  }
+  float k = standard * (1 + EC_TEMP_COEFFICIENT * (temperature - 25)) / rawEC;
+  if (k < 0.5 || k > 2.0) {
+    return false; // Wrong standard or probe not in solution
+  }
+  if (standard > EC_RANGE_SPLIT) {
+    calibration.ecKHigh = k;
+  } else {
+    calibration.ecKLow = k;
+  }
+
+  saveCalibration();
+  buildTables();
+  Serial.printf("EC calibration: %.3f mS/cm at %.1fmV, k=%.3f\n", standard, millivolts, k);
+  return true;
+}
+
+void resetPHCalibration() {
+  setDefaultPH();
+  saveCalibration();
+  buildTables();
+}
+
+void resetECCalibration() {
+  setDefaultEC();
+  saveCalibration();
+  buildTables();
+}
+
+CalibrationData getCalibration() {
+  return calibration;
+}
+
+const char* getAdcCalibrationSource() {
+  switch (adcCalSource) {
+    case HAL_ADC_CAL_EFUSE_TWO_POINT: return "eFuseTwoPoint";
+    case HAL_ADC_CAL_EFUSE_VREF: return "eFuseVref";
+    default: return "defaultVref";
+  }
+}
+
+uint32_t getAdcCalibrationVref() {
+  return halAdcVref();
+}
@@ -0,0 +1,160 @@
+#include "co2_sensor.h"
+#include "MHZ19.h"
+
+MHZ19 myMHZ19; // CO2 sensor object (only used for setup commands)
+HardwareSerial mySerial(2); // On ESP32 we have 2 USARTS available
+
+// "Read CO2" command: FF 01 86 00 00 00 00 00 79
+static const uint8_t readCommand[CO2_FRAME_SIZE] = {0xFF, 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x79};
+
+// Ring buffer filled by the UART event callback, drained by the loop (single producer, single consumer)
+static uint8_t rxBuffer[CO2_RX_BUFFER_SIZE];
+static volatile uint8_t rxHead = 0;            // Written by the callback only
+static volatile uint8_t rxTail = 0;            // Written by the loop only
+static volatile unsigned long rxLastUs = 0;    // micros() of the last received batch
+static volatile unsigned long rxOverflows = 0;
+
+// Frame assembly and request state (loop only)
+static uint8_t frame[CO2_FRAME_SIZE];
+static uint8_t frameLength = 0;
+static bool replyPending = false;
+static unsigned long commandMs = 0;
+static unsigned long commandUs = 0;
+
+static CO2Stats stats = {
+  .commandsSent = 0,
+  .framesReceived = 0,
+  .checksumErrors = 0,
+  .framingErrors = 0,
+  .timeouts = 0,
+  .overflows = 0,
+  .discardedBytes = 0,
+  .lastLatencyUs = 0,
+  .maxLatencyUs = 0,
+  .lastFrameMs = 0,
+  .stale = true
+};
+
+// Runs in the UART event task whenever bytes arrive, never in the control loop
+static void onCO2Receive() {
+  while (mySerial.available()) {
+    uint8_t next = (rxHead + 1) & (CO2_RX_BUFFER_SIZE - 1);
+    uint8_t value = mySerial.read();
+    if (next == rxTail) {
+      rxOverflows++; // Loop hasn't drained the buffer, drop the byte
+      continue;
+    }
+    rxBuffer[rxHead] = value;
+    rxHead = next;
+  }
+  rxLastUs = micros();
+}
+
+static uint8_t frameChecksum(const uint8_t *data) {
+  uint8_t sum = 0;
+  for (int i = 1; i < CO2_FRAME_SIZE - 1; i++) {
+    sum += data[i];
+  }
+  return 0xFF - sum + 1;
+}
+
+// Feed one byte into the frame assembler, returns true when a valid reply is complete
+static bool assembleFrame(uint8_t value) {
+  // Resynchronise on the "FF 86" reply header
+  if ((frameLength == 0 && value != 0xFF) || (frameLength == 1 && value != 0x86)) {
+    stats.framingErrors++;
+    frameLength = (value == 0xFF) ? 1 : 0;
+    if (frameLength == 1) {
+      frame[0] = value;
+    }
+    return false;
+  }
+
+  frame[frameLength++] = value;
+  if (frameLength < CO2_FRAME_SIZE) {
+    return false;
+  }
+
+  frameLength = 0;
+  if (frameChecksum(frame) != frame[CO2_FRAME_SIZE - 1]) {
+    stats.checksumErrors++;
+    return false;
+  }
+  return true;
+}
+
+void initCO2Sensor() {
+  // Initialize the MH-Z19 CO2 sensor
+  mySerial.begin(BAUDRATE); // (Uno example) device to MH-Z19 serial start
+  myMHZ19.begin(mySerial); // *Serial(Stream) reference must be passed to library begin().
+  myMHZ19.autoCalibration(); // Turn auto calibration ON (OFF autoCalibration(false))
+
+  // From here on every reply is collected by the UART event callback
+  while (mySerial.available()) {
+    mySerial.read();
+  }
+  mySerial.onReceive(onCO2Receive);
+}
+
+bool updateCO2Sensor(float &co2) {
+  unsigned long currentTime = millis();
+  bool published = false;
+
+  // Give up on a reply that never came, before draining: a frame that shows up later (or
+  // sat in the buffer while the sensor was backed off) is dropped below, not published
+  if (replyPending && currentTime - commandMs >= CO2_RESPONSE_TIMEOUT_MS) {
+    replyPending = false;
+    frameLength = 0;
+    stats.timeouts++;
+  }
+
+  // Drain whatever the callback collected since the last tick
+  while (rxTail != rxHead) {
+    uint8_t value = rxBuffer[rxTail];
+    rxTail = (rxTail + 1) & (CO2_RX_BUFFER_SIZE - 1);
+
+    // Only a reply to the outstanding command is a reading
+    if (!replyPending) {
+      frameLength = 0;
+      stats.discardedBytes++;
+      continue;
+    }
+
+    if (assembleFrame(value)) {
+      co2 = frame[2] * 256 + frame[3]; // ppm
+      published = true;
+      stats.framesReceived++;
+      stats.lastFrameMs = currentTime;
+      stats.lastLatencyUs = rxLastUs - commandUs;
+      if (stats.lastLatencyUs > stats.maxLatencyUs) {
+        stats.maxLatencyUs = stats.lastLatencyUs;
+      }
+      replyPending = false;
+    }
+  }
+  stats.overflows = rxOverflows;
+
+  // Issue the next read command; write() only queues the bytes in the TX FIFO
+  if (!replyPending && currentTime - commandMs >= CO2_READ_INTERVAL_MS) {
+    mySerial.write(readCommand, CO2_FRAME_SIZE);
+    commandMs = currentTime;
+    commandUs = micros();
+    replyPending = true;
+    stats.commandsSent++;
+  }
+
+  stats.stale = stats.framesReceived == 0 || currentTime - stats.lastFrameMs > CO2_STALE_MS;
+  return published;
+}
+
+bool isCO2Stale() {
+  return stats.stale;
+}
+
+bool isCO2ReplyPending() {
+  return replyPending;
+}
+
+CO2Stats getCO2Stats() {
+  return stats;
+}
@@ -0,0 +1,251 @@
+#include "collector.h"
+#include "tower_poller.h"
+#include "pg_sink.h"
+#include <algorithm>
+#include <deque>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define COLLECTOR_WAIT_MS 100       // Longest poll() wait, bounds how late a flush or report gets
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int signal) {
+  stopRequested = 1;
+}
+
+double collectorNow() {
+  timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1e6;
+}
+
+// "[id@]host[:port]", or "[id@]host:first-last" for a range of ports (simulated towers)
+static bool parseTower(std::vector<TowerEndpoint> &towers, const std::string &spec) {
+  std::string host = spec;
+  std::string deviceId;
+  size_t at = host.find('@');
+  if (at != std::string::npos) {
+    deviceId = host.substr(0, at);
+    host = host.substr(at + 1);
+  }
+  unsigned long firstPort = COLLECTOR_PORT_DEFAULT;
+  unsigned long lastPort = firstPort;
+  size_t colon = host.rfind(':');
+  if (colon != std::string::npos) {
+    char* end;
+    firstPort = lastPort = strtoul(host.c_str() + colon + 1, &end, 10);
+    if (*end == '-') {
+      lastPort = strtoul(end + 1, NULL, 10);
+    }
+    host = host.substr(0, colon);
+  }
+  if (host.empty() || firstPort == 0 || lastPort < firstPort || lastPort > 65535) {
+    fprintf(stderr, "Bad tower %s, expected [id@]host[:port]\n", spec.c_str());
+    return false;
+  }
+  for (unsigned long port = firstPort; port <= lastPort; port++) {
+    TowerEndpoint tower;
+    tower.host = host;
+    tower.port = port;
+    tower.deviceId = host + ":" + std::to_string(port);
+    if (!deviceId.empty()) {
+      tower.deviceId = firstPort == lastPort ? deviceId : deviceId + "-" + std::to_string(port);
+    }
+    towers.push_back(tower);
+  }
+  return true;
+}
+
+static bool parseTowerList(std::vector<TowerEndpoint> &towers, const char* list) {
+  std::string text(list);
+  size_t from = 0;
+  while (from < text.size()) {
+    size_t end = std::min(text.find(',', from), text.size());
+    if (end > from && !parseTower(towers, text.substr(from, end - from))) {
+      return false;
+    }
+    from = end + 1;
+  }
+  return true;
+}
+
+// One tower per line, blank lines and # comments skipped
+static bool loadTowerFile(std::vector<TowerEndpoint> &towers, const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  char line[256];
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    std::string spec(line, strcspn(line, "#\r\n"));
+    spec.erase(0, spec.find_first_not_of(" \t"));
+    spec.erase(spec.find_last_not_of(" \t") + 1);
+    ok = spec.empty() || parseTower(towers, spec);
+  }
+  fclose(file);
+  return ok;
+}
+
+static bool parseOption(CollectorOptions &options, const char* arg) {
+  if (strncmp(arg, "towers=", 7) == 0) {
+    return parseTowerList(options.towers, arg + 7);
+  }
+  if (strncmp(arg, "towers-file=", 12) == 0) {
+    return loadTowerFile(options.towers, arg + 12);
+  }
+  if (strncmp(arg, "db=", 3) == 0) {
+    options.conninfo = arg + 3;
+    return true;
+  }
+  if (strncmp(arg, "interval=", 9) == 0) {
+    options.intervalS = strtof(arg + 9, NULL);
+    return options.intervalS > 0;
+  }
+  if (strncmp(arg, "timeout=", 8) == 0) {
+    options.timeoutS = strtof(arg + 8, NULL);
+    return options.timeoutS > 0;
+  }
+  if (strncmp(arg, "batch=", 6) == 0) {
+    options.batchRows = strtoul(arg + 6, NULL, 10);
+    return options.batchRows > 0;
+  }
+  if (strncmp(arg, "flush=", 6) == 0) {
+    options.flushS = strtof(arg + 6, NULL);
+    return options.flushS >= 0;
+  }
+  if (strncmp(arg, "report=", 7) == 0) {
+    options.reportS = strtof(arg + 7, NULL);
+    return options.reportS >= 0;
+  }
+  fprintf(stderr, "Unknown option %s\n", arg);
+  return false;
+}
+
+static double percentile(std::vector<double> &values, double fraction) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t rank = (size_t)(fraction * values.size() + 0.999999);
+  return values[rank > 0 ? rank - 1 : 0];
+}
+
+// Counters at the previous report, the stats line shows what happened since
+struct ReportWindow {
+  double at;
+  PollerStats poller;
+  SinkStats sink;
+  std::vector<double> lagS;        // Tower answer to commit, per row
+};
+
+static void printReport(ReportWindow &window, const TowerPoller &poller, const PgSink &sink, size_t towers,
+                        size_t buffered, unsigned long dropped) {
+  double now = collectorNow();
+  double seconds = now - window.at;
+  PollerStats polls = poller.stats();
+  SinkStats written = sink.stats();
+  unsigned long rows = written.rows - window.sink.rows;
+  unsigned long batches = written.batches - window.sink.batches;
+  double copySeconds = written.copySeconds - window.sink.copySeconds;
+  double p50 = percentile(window.lagS, 0.5);
+  double p95 = percentile(window.lagS, 0.95);
+  double lagMax = window.lagS.empty() ? 0 : window.lagS.back();
+
+  printf("%zu towers: %lu polls (%lu failed, %lu unchanged), %lu rows in %lu batches, %.1f rows/s "
+         "(COPY %.0f rows/s), lag p50 %.2f s p95 %.2f s max %.2f s, %zu buffered, %lu dropped%s\n",
+         towers, polls.polls - window.poller.polls, polls.failed - window.poller.failed,
+         polls.unchanged - window.poller.unchanged, rows, batches, rows / seconds,
+         copySeconds > 0 ? rows / copySeconds : 0, p50, p95, lagMax, buffered, dropped,
+         sink.connected() ? "" : ", database down");
+  fflush(stdout);
+  window.at = now;
+  window.poller = polls;
+  window.sink = written;
+  window.lagS.clear();
+}
+
+// Usage: program towers=[id@]host[:port],... [towers-file=path] [db="libpq conninfo"]
+//                [interval=10] [timeout=3] [batch=1000] [flush=5] [report=10]
+int main(int argc, char **argv) {
+  CollectorOptions options = {};
+  options.intervalS = COLLECTOR_INTERVAL_DEFAULT_S;
+  options.timeoutS = COLLECTOR_TIMEOUT_DEFAULT_S;
+  options.batchRows = COLLECTOR_BATCH_ROWS_DEFAULT;
+  options.flushS = COLLECTOR_FLUSH_DEFAULT_S;
+  options.reportS = COLLECTOR_REPORT_DEFAULT_S;
+  for (int i = 1; i < argc; i++) {
+    if (!parseOption(options, argv[i])) {
+      return 1;
+    }
+  }
+  if (options.towers.empty()) {
+    fprintf(stderr, "No towers, give towers=host[:port],... or towers-file=path\n");
+    return 1;
+  }
+
+  TowerPoller poller(options);
+  PgSink sink(options.conninfo);
+  if (!poller.begin()) {
+    return 1;
+  }
+  signal(SIGINT, requestStop);
+  signal(SIGTERM, requestStop);
+  signal(SIGPIPE, SIG_IGN);
+  printf("Polling %zu towers every %.1f s, %s\n", options.towers.size(), options.intervalS,
+         options.conninfo.empty() ? "dry run (no db=), rows are not written" : "writing to sensor_data");
+  fflush(stdout);
+  sink.connect();
+
+  std::deque<SensorRow> pending;
+  std::vector<SensorRow> arrived;
+  unsigned long dropped = 0;
+  ReportWindow window = {};
+  window.at = collectorNow();
+
+  while (!stopRequested) {
+    arrived.clear();
+    poller.poll(arrived, COLLECTOR_WAIT_MS);
+    pending.insert(pending.end(), arrived.begin(), arrived.end());
+    while (pending.size() > COLLECTOR_BUFFER_MAX) {
+      pending.pop_front();
+      dropped++;
+    }
+
+    // Full batches go right away, a partial one once its oldest row has waited flushS
+    double now = collectorNow();
+    while (!pending.empty() && (pending.size() >= options.batchRows || now - pending.front().sampledAt >= options.flushS)) {
+      size_t count = std::min(pending.size(), (size_t)options.batchRows);
+      if (!sink.write(pending, count)) {
+        break;
+      }
+      double committed = collectorNow();
+      for (size_t i = 0; i < count; i++) {
+        window.lagS.push_back(committed - pending.front().sampledAt);
+        pending.pop_front();
+      }
+    }
+
+    if (options.reportS > 0 && now - window.at >= options.reportS) {
+      printReport(window, poller, sink, options.towers.size(), pending.size(), dropped);
+    }
+  }
+
+  // What's still buffered gets one more chance
+  while (!pending.empty()) {
+    size_t count = std::min(pending.size(), (size_t)options.batchRows);
+    if (!sink.write(pending, count)) {
+      fprintf(stderr, "%zu rows not written\n", pending.size());
+      break;
+    }
+    pending.erase(pending.begin(), pending.begin() + count);
+  }
+  SinkStats written = sink.stats();
+  printf("Stopped: %lu rows in %lu batches, %lu dropped\n", written.rows, written.batches, dropped);
+  return pending.empty() ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// LAN collector: polls many towers' GET /sensors, tags each reading with the tower's device ID,
+// buffers the rows and writes them to PostgreSQL in batches with COPY (schema in
+// collector_schema.sql). Replaces one TLS connection and one single-row insert per tower and
+// upload. Only built in the collector environment (Linux, libpq).
+
+#define COLLECTOR_PORT_DEFAULT 80
+#define COLLECTOR_INTERVAL_DEFAULT_S 10   // Poll period per tower
+#define COLLECTOR_TIMEOUT_DEFAULT_S 3     // Per poll, connect to last byte
+#define COLLECTOR_MAX_IN_FLIGHT 64        // Polls open at once, the rest wait for their turn
+#define COLLECTOR_BATCH_ROWS_DEFAULT 1000 // Rows per COPY
+#define COLLECTOR_FLUSH_DEFAULT_S 5       // Oldest buffered row waits at most this long
+#define COLLECTOR_BUFFER_MAX 200000       // Rows kept while the database is down, oldest dropped first
+#define COLLECTOR_RECONNECT_S 5           // Between database connection attempts
+#define COLLECTOR_REPORT_DEFAULT_S 10     // Stats line period, 0 = off
+
+// SensorRow::validMask bits, set from the "valid" object of /sensors. Collector-local:
+// not the firmware's SENSOR_VALID_* values, which never leave the tower
+#define ROW_VALID_LIGHT 0x0001
+#define ROW_VALID_ENV_TEMP 0x0002
+#define ROW_VALID_ENV_HUMIDITY 0x0004
+#define ROW_VALID_CO2 0x0008
+#define ROW_VALID_WATER_TEMP 0x0010
+#define ROW_VALID_PH 0x0020
+#define ROW_VALID_EC 0x0040
+#define ROW_VALID_WATER_TEMP_TOP 0x0080
+#define ROW_VALID_WATER_TEMP_ROOT 0x0100
+
+struct TowerEndpoint {
+  std::string deviceId;            // Given as id@host, host:port otherwise
+  std::string host;
+  uint16_t port;
+};
+
+// One /sensors reading, values the tower marks invalid are written as NULL
+struct SensorRow {
+  std::string deviceId;
+  double sampledAt;                // Unix time the tower answered
+  uint32_t seq;                    // Tower's snapshot sequence
+  float co2Level;
+  float phLevel;
+  float waterTemp;
+  float waterTempTop;
+  float waterTempRoot;
+  float envTemp;
+  float humidity;
+  float lightLevel;
+  float ecLevel;
+  bool waterLevel;
+  uint16_t validMask;
+};
+
+struct CollectorOptions {
+  std::vector<TowerEndpoint> towers;
+  std::string conninfo;            // libpq connection string, empty = dry run (rows are counted, not written)
+  float intervalS;
+  float timeoutS;
+  unsigned batchRows;
+  float flushS;
+  float reportS;
+};
+
+double collectorNow();             // Unix time in seconds
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PG_SINK_H
+#define PG_SINK_H
+
+#include "collector.h"
+#include <deque>
+
+// Writes batches of rows to sensor_data with one COPY ... FROM STDIN each (one round trip and
+// one transaction per batch). Reconnects on its own, a batch that failed stays with the caller.
+// Without a connection string every batch is formatted and dropped (dry run).
+
+struct SinkStats {
+  unsigned long batches;
+  unsigned long rows;
+  unsigned long failedBatches;
+  double copySeconds;              // Formatting and COPY of the written batches
+};
+
+struct pg_conn;
+
+class PgSink {
+ public:
+  explicit PgSink(const std::string &conninfo);
+  ~PgSink();
+  bool connected() const;
+  bool connect();                  // At most once per COLLECTOR_RECONNECT_S
+  bool write(const std::deque<SensorRow> &rows, size_t count); // The first count rows, all or nothing
+  SinkStats stats() const { return _stats; }
+
+ private:
+  std::string _conninfo;
+  pg_conn* _connection = nullptr;
+  double _lastAttempt = 0;
+  std::string _buffer;             // COPY text of the current batch, reused
+  SinkStats _stats = {};
+};
+
+void formatCopyRow(const SensorRow &row, std::string &out); // One line of COPY text format
+
+#endif
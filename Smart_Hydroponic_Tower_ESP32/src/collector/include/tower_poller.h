@@ -0,0 +1,41 @@
+#ifndef TOWER_POLLER_H
+#define TOWER_POLLER_H
+
+#include "collector.h"
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Polls GET /sensors on every tower once per interval over non-blocking sockets (the towers
+// close each connection after the response), start times spread evenly over the interval.
+// A reading whose snapshot sequence hasn't moved since the previous poll is skipped.
+
+struct PollerStats {
+  unsigned long polls;
+  unsigned long failed;            // Connect errors, resets, timeouts, non-200 answers, bad JSON
+  unsigned long unchanged;         // Same snapshot as the previous poll
+};
+
+struct TowerState;
+
+class TowerPoller {
+ public:
+  TowerPoller(const CollectorOptions &options);
+  ~TowerPoller();
+  bool begin();                    // Resolves every tower, false if one can't be
+  void poll(std::vector<SensorRow> &rows, int maxWaitMs); // Appends the readings that arrived
+  PollerStats stats() const { return _stats; }
+
+ private:
+  void start(TowerState &tower, double now);
+  void finish(TowerState &tower, bool ok, std::vector<SensorRow> &rows);
+  void handle(TowerState &tower, short events, std::vector<SensorRow> &rows);
+
+  const CollectorOptions &_options;
+  std::vector<TowerState> _towers;
+  unsigned _inFlight = 0;
+  PollerStats _stats = {};
+};
+
+bool parseSensorRow(const char* body, size_t length, SensorRow &row); // /sensors JSON
+
+#endif
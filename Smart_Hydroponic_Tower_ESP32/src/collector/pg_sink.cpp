@@ -0,0 +1,115 @@
+#include "pg_sink.h"
+#include <libpq-fe.h>
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+
+static const char copyStatement[] =
+  "COPY sensor_data (device_id, sampled_at, seq, timestamp, co2_level, ph_level, water_temp, water_temp_top, "
+  "water_temp_root, env_temp, humidity, light_level, ec_level, water_level) FROM STDIN";
+
+static void appendValue(std::string &out, float value, bool valid) {
+  char text[24];
+  if (valid) {
+    snprintf(text, sizeof(text), "\t%.6g", value);
+    out += text;
+  } else {
+    out += "\t\\N";
+  }
+}
+
+void formatCopyRow(const SensorRow &row, std::string &out) {
+  for (char c : row.deviceId) {
+    if (c == '\\' || c == '\t' || c == '\n' || c == '\r') {
+      out += '\\';
+      c = c == '\t' ? 't' : c == '\n' ? 'n' : c == '\r' ? 'r' : c;
+    }
+    out += c;
+  }
+
+  time_t seconds = (time_t)row.sampledAt;
+  struct tm utc;
+  gmtime_r(&seconds, &utc);
+  char text[64];
+  strftime(text, sizeof(text), "\t%Y-%m-%d %H:%M:%S", &utc);
+  out += text;
+  snprintf(text, sizeof(text), ".%03d+00\t%lu\t%lld", std::min((int)((row.sampledAt - seconds) * 1000 + 0.5), 999),
+           (unsigned long)row.seq, (long long)seconds);
+  out += text;
+
+  appendValue(out, row.co2Level, row.validMask & ROW_VALID_CO2);
+  appendValue(out, row.phLevel, row.validMask & ROW_VALID_PH);
+  appendValue(out, row.waterTemp, row.validMask & ROW_VALID_WATER_TEMP);
+  appendValue(out, row.waterTempTop, row.validMask & ROW_VALID_WATER_TEMP_TOP);
+  appendValue(out, row.waterTempRoot, row.validMask & ROW_VALID_WATER_TEMP_ROOT);
+  appendValue(out, row.envTemp, row.validMask & ROW_VALID_ENV_TEMP);
+  appendValue(out, row.humidity, row.validMask & ROW_VALID_ENV_HUMIDITY);
+  appendValue(out, row.lightLevel, row.validMask & ROW_VALID_LIGHT);
+  appendValue(out, row.ecLevel, row.validMask & ROW_VALID_EC);
+  out += row.waterLevel ? "\tt\n" : "\tf\n";
+}
+
+PgSink::PgSink(const std::string &conninfo) : _conninfo(conninfo) {}
+
+PgSink::~PgSink() {
+  if (_connection) {
+    PQfinish(_connection);
+  }
+}
+
+bool PgSink::connected() const {
+  return _conninfo.empty() || (_connection && PQstatus(_connection) == CONNECTION_OK);
+}
+
+bool PgSink::connect() {
+  if (connected()) {
+    return true;
+  }
+  double now = collectorNow();
+  if (now - _lastAttempt < COLLECTOR_RECONNECT_S) {
+    return false;
+  }
+  _lastAttempt = now;
+  if (_connection) {
+    PQfinish(_connection);
+  }
+  _connection = PQconnectdb(_conninfo.c_str());
+  if (PQstatus(_connection) != CONNECTION_OK) {
+    fprintf(stderr, "Database connection failed: %s", PQerrorMessage(_connection));
+    return false;
+  }
+  printf("Connected to %s on %s\n", PQdb(_connection), PQhost(_connection));
+  return true;
+}
+
+bool PgSink::write(const std::deque<SensorRow> &rows, size_t count) {
+  if (!_conninfo.empty() && !connect()) {
+    return false;
+  }
+  double start = collectorNow();
+  _buffer.clear();
+  for (size_t i = 0; i < count; i++) {
+    formatCopyRow(rows[i], _buffer);
+  }
+  if (!_conninfo.empty()) {
+    PGresult* result = PQexec(_connection, copyStatement);
+    bool ok = PQresultStatus(result) == PGRES_COPY_IN;
+    PQclear(result);
+    ok = ok && PQputCopyData(_connection, _buffer.data(), _buffer.size()) == 1;
+    // Ends the COPY either way, an error message aborts it and nothing of the batch is kept
+    ok = PQputCopyEnd(_connection, ok ? NULL : "collector: sending the batch failed") == 1 && ok;
+    while ((result = PQgetResult(_connection)) != NULL) {
+      ok = ok && PQresultStatus(result) == PGRES_COMMAND_OK;
+      PQclear(result);
+    }
+    if (!ok) {
+      fprintf(stderr, "COPY of %zu rows failed: %s", count, PQerrorMessage(_connection));
+      _stats.failedBatches++;
+      return false;
+    }
+  }
+  _stats.batches++;
+  _stats.rows += count;
+  _stats.copySeconds += collectorNow() - start;
+  return true;
+}
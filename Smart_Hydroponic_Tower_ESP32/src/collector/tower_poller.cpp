@@ -0,0 +1,239 @@
+#include "tower_poller.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POLL_RESPONSE_MAX 4096     // /sensors is about 450 bytes
+
+enum PollState { POLL_IDLE, POLL_CONNECTING, POLL_SENDING, POLL_READING };
+
+struct TowerState {
+  TowerEndpoint endpoint;
+  sockaddr_storage address;
+  socklen_t addressLength;
+  std::string request;
+  int fd;
+  PollState state;
+  double dueAt;
+  double startedAt;
+  size_t sent;
+  std::string response;
+  bool haveSeq;
+  uint32_t lastSeq;
+};
+
+// Column of each /sensors field and its key in the "valid" object
+struct SensorField {
+  const char* key;
+  float SensorRow::*value;
+  uint16_t validBit;
+};
+
+static const SensorField sensorFields[] = {
+  {"CO2", &SensorRow::co2Level, ROW_VALID_CO2},
+  {"phLevel", &SensorRow::phLevel, ROW_VALID_PH},
+  {"waterTemp", &SensorRow::waterTemp, ROW_VALID_WATER_TEMP},
+  {"waterTempTop", &SensorRow::waterTempTop, ROW_VALID_WATER_TEMP_TOP},
+  {"waterTempRoot", &SensorRow::waterTempRoot, ROW_VALID_WATER_TEMP_ROOT},
+  {"envTemp", &SensorRow::envTemp, ROW_VALID_ENV_TEMP},
+  {"envHum", &SensorRow::humidity, ROW_VALID_ENV_HUMIDITY},
+  {"lightLevel", &SensorRow::lightLevel, ROW_VALID_LIGHT},
+  {"ecLevel", &SensorRow::ecLevel, ROW_VALID_EC},
+};
+
+bool parseSensorRow(const char* body, size_t length, SensorRow &row) {
+  StaticJsonDocument<1024> doc;
+  if (deserializeJson(doc, body, length) || !doc["seq"].is<uint32_t>()) {
+    return false;
+  }
+  // Firmware from before per-channel validity sends no "valid" object, every value counts
+  JsonObject valid = doc["valid"].as<JsonObject>();
+  row.validMask = 0;
+  for (const SensorField &field : sensorFields) {
+    row.*field.value = doc[field.key].as<float>();
+    if (!doc[field.key].isNull() && (valid.isNull() || valid[field.key].as<bool>())) {
+      row.validMask |= field.validBit;
+    }
+  }
+  row.waterLevel = doc["waterLevel"].as<bool>();
+  row.seq = doc["seq"].as<uint32_t>();
+  return true;
+}
+
+TowerPoller::TowerPoller(const CollectorOptions &options) : _options(options) {}
+
+TowerPoller::~TowerPoller() {
+  for (TowerState &tower : _towers) {
+    if (tower.fd >= 0) {
+      close(tower.fd);
+    }
+  }
+}
+
+bool TowerPoller::begin() {
+  double now = collectorNow();
+  size_t count = _options.towers.size();
+  _towers.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    TowerState &tower = _towers[i];
+    tower.endpoint = _options.towers[i];
+    tower.fd = -1;
+    tower.state = POLL_IDLE;
+    tower.dueAt = now + _options.intervalS * i / count;
+    tower.haveSeq = false;
+    tower.request = "GET /sensors HTTP/1.1\r\nHost: " + tower.endpoint.host + "\r\nConnection: close\r\n\r\n";
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = NULL;
+    std::string port = std::to_string(tower.endpoint.port);
+    int error = getaddrinfo(tower.endpoint.host.c_str(), port.c_str(), &hints, &found);
+    if (error != 0 || found == NULL) {
+      fprintf(stderr, "Can't resolve %s: %s\n", tower.endpoint.host.c_str(), gai_strerror(error));
+      return false;
+    }
+    memcpy(&tower.address, found->ai_addr, found->ai_addrlen);
+    tower.addressLength = found->ai_addrlen;
+    freeaddrinfo(found);
+  }
+  return true;
+}
+
+void TowerPoller::start(TowerState &tower, double now) {
+  tower.startedAt = now;
+  tower.sent = 0;
+  tower.response.clear();
+  _inFlight++;
+  tower.state = POLL_CONNECTING;
+  tower.fd = socket(tower.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (tower.fd < 0) {
+    return;  // Counted as failed on the next poll()
+  }
+  if (connect(tower.fd, (sockaddr*)&tower.address, tower.addressLength) == 0) {
+    tower.state = POLL_SENDING;
+  } else if (errno != EINPROGRESS) {
+    close(tower.fd);
+    tower.fd = -1;
+  }
+}
+
+void TowerPoller::finish(TowerState &tower, bool ok, std::vector<SensorRow> &rows) {
+  if (tower.fd >= 0) {
+    close(tower.fd);
+    tower.fd = -1;
+  }
+  tower.state = POLL_IDLE;
+  _inFlight--;
+  _stats.polls++;
+  // Next poll one interval after this one was due, late polls don't shift the schedule
+  while (tower.dueAt <= tower.startedAt) {
+    tower.dueAt += _options.intervalS;
+  }
+
+  size_t bodyStart = tower.response.find("\r\n\r\n");
+  ok = ok && tower.response.compare(0, 12, "HTTP/1.1 200") == 0 && bodyStart != std::string::npos;
+  SensorRow row;
+  if (!ok || !parseSensorRow(tower.response.data() + bodyStart + 4, tower.response.size() - bodyStart - 4, row)) {
+    _stats.failed++;
+    return;
+  }
+  if (tower.haveSeq && row.seq == tower.lastSeq) {
+    _stats.unchanged++;
+    return;
+  }
+  tower.haveSeq = true;
+  tower.lastSeq = row.seq;
+  row.deviceId = tower.endpoint.deviceId;
+  row.sampledAt = collectorNow();
+  rows.push_back(row);
+}
+
+void TowerPoller::handle(TowerState &tower, short events, std::vector<SensorRow> &rows) {
+  if (tower.state == POLL_CONNECTING) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(tower.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+      finish(tower, false, rows);
+      return;
+    }
+    tower.state = POLL_SENDING;
+  }
+  if (tower.state == POLL_SENDING) {
+    ssize_t written = send(tower.fd, tower.request.data() + tower.sent, tower.request.size() - tower.sent, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        finish(tower, false, rows);
+      }
+      return;
+    }
+    tower.sent += written;
+    if (tower.sent == tower.request.size()) {
+      tower.state = POLL_READING;
+    }
+    return;
+  }
+
+  char buffer[2048];
+  ssize_t length = recv(tower.fd, buffer, sizeof(buffer), 0);
+  if (length < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      finish(tower, false, rows);
+    }
+    return;
+  }
+  if (length == 0) {
+    finish(tower, true, rows);
+    return;
+  }
+  if (tower.response.size() + length > POLL_RESPONSE_MAX) {
+    finish(tower, false, rows);
+    return;
+  }
+  tower.response.append(buffer, length);
+}
+
+void TowerPoller::poll(std::vector<SensorRow> &rows, int maxWaitMs) {
+  double now = collectorNow();
+  double waitS = maxWaitMs / 1000.0;
+  for (TowerState &tower : _towers) {
+    if (tower.state == POLL_IDLE) {
+      if (tower.dueAt <= now && _inFlight < COLLECTOR_MAX_IN_FLIGHT) {
+        start(tower, now);
+      } else if (tower.dueAt > now) {
+        waitS = std::min(waitS, tower.dueAt - now);
+      }
+    }
+    if (tower.state != POLL_IDLE && (tower.fd < 0 || now - tower.startedAt >= _options.timeoutS)) {
+      finish(tower, false, rows);
+    }
+  }
+
+  std::vector<pollfd> fds;
+  std::vector<TowerState*> owners;
+  for (TowerState &tower : _towers) {
+    if (tower.state != POLL_IDLE) {
+      fds.push_back({tower.fd, (short)(tower.state == POLL_READING ? POLLIN : POLLOUT), 0});
+      owners.push_back(&tower);
+    }
+  }
+  int timeoutMs = (int)(waitS * 1000) + 1;
+  if (fds.empty()) {
+    usleep(timeoutMs * 1000);
+    return;
+  }
+  if (::poll(fds.data(), fds.size(), timeoutMs) <= 0) {
+    return;
+  }
+  for (size_t i = 0; i < fds.size(); i++) {
+    if (fds[i].revents) {
+      handle(*owners[i], fds[i].revents, rows);
+    }
+  }
+}
@@ -1,5 +1,9 @@
 #include "data_logger.h"
-#include "esp_task_wdt.h"
+#include "http_client.h"
+#include "hal.h"
+#include "span_trace.h"
+#include "metrics.h"
+#include "heap_monitor.h"
 
 // Global variables
 static bool loggerEnabled = true;
@@ -11,7 +15,7 @@ static String lastStatus = "Ready";
 void initDataLogger() {
   Serial.println("=== Data Logger Initialization ===");
   
-  if (WiFi.status() == WL_CONNECTED) {
+  if (isNetworkConnected()) {
     Serial.println("✓ WiFi connected - Data logger ready");
     lastStatus = "Initialized";
   } else {
@@ -29,25 +33,28 @@ void logSensorDataToCloud() {
   }
   
   // Check if it's time to log (every 5 minutes)
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halMillis();
   if (currentTime - lastLogTime < LOG_INTERVAL_MS) {
     return;
   }
   
   lastLogTime = currentTime;
+  HEAP_SCOPE(HEAP_LOGGER);
   
   // Check WiFi connection
-  if (WiFi.status() != WL_CONNECTED) {
+  if (!isNetworkConnected()) {
     Serial.println("Cannot log: WiFi not connected");
     lastStatus = "WiFi Offline";
     return;
   }
   
-  // Use the current sensor data from the global sensors
+  // Upload a consistent snapshot of the latest sensor data
   Serial.println("Uploading sensor data to cloud...");
+  SensorData sensors;
+  getSensorSnapshot(sensors);
   
   // Attempt upload
-  if (uploadSensorData(currentSensors)) {
+  if (uploadSensorData(sensors)) {
     Serial.println("Data uploaded successfully!");
     lastStatus = "Upload Success";
     successfulUploads++;
@@ -59,16 +66,22 @@ void logSensorDataToCloud() {
   }
 }
 
+void beginSensorDataRequest(HttpRequest &http) {
+  String url = String(SUPABASE_URL) + "/rest/v1/sensor_data";
+  httpBegin(http, url);
+  httpAddHeader(http, "Content-Type", "application/json");
+  httpAddHeader(http, "apikey", SUPABASE_API_KEY);
+  httpAddHeader(http, "Authorization", "Bearer " + String(SUPABASE_API_KEY));
+  httpAddHeader(http, "Prefer", "return=minimal");
+}
+
 bool uploadSensorData(const SensorData& data) {
-  HTTPClient http;
+  TRACE_SPAN("upload");
+  unsigned long startUs = halMicros();
+  HttpRequest http;
   
-  // Configure HTTP client for Supabase
-  String url = String(SUPABASE_URL) + "/rest/v1/sensor_data";
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("apikey", SUPABASE_API_KEY);
-  http.addHeader("Authorization", "Bearer " + String(SUPABASE_API_KEY));
-  http.addHeader("Prefer", "return=minimal");
+  // Configure HTTP request for Supabase
+  beginSensorDataRequest(http);
   
   // Create JSON payload
   String jsonPayload = createJsonFromSensorData(data);
@@ -81,9 +94,11 @@ bool uploadSensorData(const SensorData& data) {
     attempts++;
     
     // Reset watchdog to prevent timeout during HTTP request
-    esp_task_wdt_reset();
+    halWatchdogReset();
     
-    httpResponseCode = http.POST(jsonPayload);
+    TRACE_BEGIN("httpPost");
+    httpResponseCode = httpPost(http, jsonPayload);
+    TRACE_END("httpPost");
     
     if (httpResponseCode >= 200 && httpResponseCode < 300) {
       break; // Success!
@@ -91,26 +106,40 @@ bool uploadSensorData(const SensorData& data) {
       if (attempts < MAX_RETRY_ATTEMPTS) {
         // Exponential backoff: 1s, 2s, 4s, 8s...
         unsigned long backoffDelay = 1000 * (1 << (attempts - 1));
-        delay(backoffDelay);
+        TRACE_BEGIN("uploadBackoff");
+        halDelay(backoffDelay);
+        TRACE_END("uploadBackoff");
       }
     }
   }
   
-  http.end();
-  return (httpResponseCode >= 200 && httpResponseCode < 300);
+  bool success = httpResponseCode >= 200 && httpResponseCode < 300;
+  observeUpload(halMicros() - startUs, success, attempts);
+  return success;
+}
+
+static void setLoggedValue(DynamicJsonDocument& doc, const char* key, float value, bool valid) {
+  if (valid) {
+    doc[key] = value;
+  } else {
+    doc[key] = nullptr;
+  }
 }
 
 String createJsonFromSensorData(const SensorData& data) {
   DynamicJsonDocument doc(512);
   
-  doc["timestamp"] = millis() / 1000; // Current timestamp in seconds
-  doc["co2_level"] = data.co2Level;
-  doc["ph_level"] = data.waterPH;
-  doc["water_temp"] = data.waterTemp;
-  doc["env_temp"] = data.envTemp;
-  doc["humidity"] = data.envHumidity;
-  doc["light_level"] = data.lightLevel;
-  doc["ec_level"] = data.waterEC;
+  doc["timestamp"] = halMillis() / 1000; // Current timestamp in seconds
+  // Failing sensors are logged as null instead of their last (stale) value
+  setLoggedValue(doc, "co2_level", data.co2Level, isSensorValid(data, SENSOR_VALID_CO2));
+  setLoggedValue(doc, "ph_level", data.waterPH, isSensorValid(data, SENSOR_VALID_PH));
+  setLoggedValue(doc, "water_temp", data.waterTemp, isSensorValid(data, SENSOR_VALID_WATER_TEMP));
+  setLoggedValue(doc, "water_temp_top", data.waterTempTop, isSensorValid(data, SENSOR_VALID_WATER_TEMP_TOP));
+  setLoggedValue(doc, "water_temp_root", data.waterTempRoot, isSensorValid(data, SENSOR_VALID_WATER_TEMP_ROOT));
+  setLoggedValue(doc, "env_temp", data.envTemp, isSensorValid(data, SENSOR_VALID_ENV_TEMP));
+  setLoggedValue(doc, "humidity", data.envHumidity, isSensorValid(data, SENSOR_VALID_ENV_HUMIDITY));
+  setLoggedValue(doc, "light_level", data.lightLevel, isSensorValid(data, SENSOR_VALID_LIGHT));
+  setLoggedValue(doc, "ec_level", data.waterEC, isSensorValid(data, SENSOR_VALID_EC));
   doc["water_level"] = data.waterLevel;
   
   String jsonString;
@@ -151,14 +180,16 @@ void triggerManualLog() {
   Serial.println("Manual log triggered");
   
   // Check WiFi connection
-  if (WiFi.status() != WL_CONNECTED) {
+  if (!isNetworkConnected()) {
     Serial.println("Cannot log: WiFi not connected");
     lastStatus = "WiFi Offline - Manual";
     return;
   }
 
   // Attempt upload (bypass the timer and enabled checks)
-  if (uploadSensorData(currentSensors)) {
+  SensorData sensors;
+  getSensorSnapshot(sensors);
+  if (uploadSensorData(sensors)) {
     Serial.println("Manual upload successful!");
     lastStatus = "Manual Upload Success";
     successfulUploads++;
@@ -0,0 +1,250 @@
+#include "dht_sensor.h"
+#include "DHT.h"
+#include "driver/rmt.h"
+#include "esp_timer.h"
+
+#define DHTTYPE DHT22
+DHT dht(DHTPIN, DHTTYPE); // Initialize DHT sensor.
+
+// RMT capture configuration
+#define DHT_RMT_CHANNEL RMT_CHANNEL_4
+#define DHT_RMT_CLK_DIV 80          // 80MHz APB / 80 = 1us per tick
+#define DHT_RMT_IDLE_US 200         // Line high this long ends the capture
+#define DHT_RMT_FILTER_TICKS 100    // Ignore glitches shorter than ~1.25us (APB ticks)
+#define DHT_BIT_THRESHOLD_US 48     // High pulse: ~27us = 0, ~70us = 1
+
+static uint8_t backend = DHT_BACKEND_DEFAULT;
+static volatile uint8_t requestedBackend = DHT_BACKEND_DEFAULT; // Set by the web server, applied by updateDHTSensor()
+static RingbufHandle_t rmtRingBuffer = NULL;
+static esp_timer_handle_t releaseTimer = NULL;
+static bool capturePending = false;
+static unsigned long lastStartMs = 0;
+
+// Last valid reading, humidity and temperature always come from the same transaction
+static float cachedTemperature = NAN;
+static float cachedHumidity = NAN;
+
+static DHTStats stats = {
+  .backend = DHT_BACKEND_DEFAULT,
+  .reads = 0,
+  .checksumErrors = 0,
+  .timeouts = 0,
+  .lastLoopUs = 0,
+  .maxLoopUs = 0,
+  .lastReadMs = 0
+};
+
+// End of the start pulse, runs in the esp_timer task
+static void releaseStartPulse(void *arg) {
+  pinMode(DHTPIN, INPUT_PULLUP);
+  rmt_set_gpio(DHT_RMT_CHANNEL, RMT_MODE_RX, (gpio_num_t)DHTPIN, false); // Route the pin back to the RMT input
+  rmt_rx_start(DHT_RMT_CHANNEL, true);
+}
+
+static bool initRMTCapture() {
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)DHTPIN, DHT_RMT_CHANNEL);
+  config.clk_div = DHT_RMT_CLK_DIV;
+  config.mem_block_num = 1; // 64 items, the 40-bit reply needs ~43
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = DHT_RMT_FILTER_TICKS;
+  config.rx_config.idle_threshold = DHT_RMT_IDLE_US;
+
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(DHT_RMT_CHANNEL, 512, 0) != ESP_OK) {
+    return false;
+  }
+  rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &rmtRingBuffer);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = &releaseStartPulse;
+  timerArgs.name = "dht_start";
+  return esp_timer_create(&timerArgs, &releaseTimer) == ESP_OK;
+}
+
+// Drop anything the RMT captured outside of our own transaction
+static void flushRMTCapture() {
+  size_t length = 0;
+  void *item;
+  while ((item = xRingbufferReceive(rmtRingBuffer, &length, 0)) != NULL) {
+    vRingbufferReturnItem(rmtRingBuffer, item);
+  }
+}
+
+// Pull the line low; the timer releases it and arms the RMT receiver without blocking the loop
+static void startRMTCapture() {
+  rmt_rx_stop(DHT_RMT_CHANNEL);
+  flushRMTCapture();
+  pinMode(DHTPIN, OUTPUT);
+  digitalWrite(DHTPIN, LOW);
+  esp_timer_start_once(releaseTimer, DHT_START_PULSE_US);
+}
+
+// Decode the 40 data bits from the captured high pulse widths
+static bool decodeRMTCapture(const rmt_item32_t *items, size_t count, float &temperature, float &humidity) {
+  uint16_t highPulses[48];
+  int highCount = 0;
+
+  // Keep the last 40 non-zero high pulses (earlier ones are the release and the 80us response)
+  for (size_t i = 0; i < count; i++) {
+    uint16_t durations[2] = {(uint16_t)items[i].duration0, (uint16_t)items[i].duration1};
+    uint8_t levels[2] = {(uint8_t)items[i].level0, (uint8_t)items[i].level1};
+    for (int j = 0; j < 2; j++) {
+      if (levels[j] == 1 && durations[j] > 0) {
+        if (highCount == 48) {
+          memmove(highPulses, highPulses + 1, sizeof(highPulses) - sizeof(highPulses[0]));
+          highCount--;
+        }
+        highPulses[highCount++] = durations[j];
+      }
+    }
+  }
+  if (highCount < 40) {
+    stats.timeouts++; // Reply ended early
+    return false;
+  }
+
+  uint8_t data[5] = {0};
+  const uint16_t *bits = highPulses + highCount - 40;
+  for (int i = 0; i < 40; i++) {
+    data[i / 8] = (data[i / 8] << 1) | (bits[i] > DHT_BIT_THRESHOLD_US ? 1 : 0);
+  }
+  if (((data[0] + data[1] + data[2] + data[3]) & 0xFF) != data[4]) {
+    stats.checksumErrors++;
+    return false;
+  }
+
+  humidity = ((data[0] << 8) | data[1]) * 0.1;
+  temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1;
+  if (data[2] & 0x80) {
+    temperature = -temperature;
+  }
+  return true;
+}
+
+static bool updateRMTBackend() {
+  unsigned long currentTime = millis();
+
+  if (!capturePending) {
+    if (currentTime - lastStartMs < DHT_MIN_INTERVAL_MS) {
+      return false;
+    }
+    startRMTCapture();
+    capturePending = true;
+    lastStartMs = currentTime;
+    return false;
+  }
+
+  size_t length = 0;
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(rmtRingBuffer, &length, 0);
+  if (items == NULL) {
+    if (currentTime - lastStartMs >= DHT_CAPTURE_TIMEOUT_MS) {
+      rmt_rx_stop(DHT_RMT_CHANNEL);
+      capturePending = false;
+      stats.timeouts++;
+    }
+    return false;
+  }
+
+  float temperature, humidity;
+  bool valid = decodeRMTCapture(items, length / sizeof(rmt_item32_t), temperature, humidity);
+  vRingbufferReturnItem(rmtRingBuffer, items);
+  rmt_rx_stop(DHT_RMT_CHANNEL);
+  capturePending = false;
+
+  if (valid) {
+    cachedTemperature = temperature;
+    cachedHumidity = humidity;
+  }
+  return valid;
+}
+
+static bool updateAdafruitBackend() {
+  unsigned long currentTime = millis();
+  if (currentTime - lastStartMs < DHT_MIN_INTERVAL_MS) {
+    return false;
+  }
+  lastStartMs = currentTime;
+
+  // One transaction; readTemperature()/readHumidity() then return the data it fetched
+  if (!dht.read(true)) {
+    stats.timeouts++;
+    return false;
+  }
+  cachedTemperature = dht.readTemperature(); // Read temperature from DHT22 sensor
+  cachedHumidity = dht.readHumidity();       // Read humidity from DHT22 sensor
+  return true;
+}
+
+void initDHTSensor() {
+  dht.begin(); // Initialize the DHT22 sensor
+  lastStartMs = millis(); // Sensor needs the minimum interval after power-up as well
+
+  if (!initRMTCapture()) {
+    Serial.println("DHT22: RMT capture unavailable, using Adafruit driver");
+    backend = DHT_BACKEND_ADAFRUIT;
+    requestedBackend = backend;
+    stats.backend = backend;
+  }
+}
+
+// Backend changes are only applied between transactions, on the acquisition task that owns the
+// pin: an RMT capture runs to completion or timeout first, the Adafruit driver reads synchronously
+static void applyRequestedBackend() {
+  if (requestedBackend == backend || capturePending) {
+    return;
+  }
+  if (releaseTimer != NULL) {
+    rmt_rx_stop(DHT_RMT_CHANNEL);
+  }
+  pinMode(DHTPIN, INPUT_PULLUP);
+
+  backend = requestedBackend;
+  stats.backend = backend;
+  stats.maxLoopUs = 0; // Compare backends from a clean slate
+  Serial.printf("DHT22 backend: %s\n", backend == DHT_BACKEND_RMT ? "RMT" : "Adafruit");
+}
+
+bool updateDHTSensor(float &temperature, float &humidity) {
+  applyRequestedBackend();
+
+  unsigned long startUs = micros();
+  bool updated = (backend == DHT_BACKEND_RMT) ? updateRMTBackend() : updateAdafruitBackend();
+
+  if (updated) {
+    stats.reads++;
+    stats.lastReadMs = millis();
+    temperature = cachedTemperature;
+    humidity = cachedHumidity;
+  }
+
+  unsigned long elapsedUs = micros() - startUs;
+  if (elapsedUs > 50) { // Only track calls that touched the sensor
+    stats.lastLoopUs = elapsedUs;
+    if (elapsedUs > stats.maxLoopUs) {
+      stats.maxLoopUs = elapsedUs;
+    }
+  }
+  return updated;
+}
+
+bool setDHTBackend(uint8_t newBackend) {
+  if (newBackend != DHT_BACKEND_ADAFRUIT && newBackend != DHT_BACKEND_RMT) {
+    return false;
+  }
+  if (newBackend == DHT_BACKEND_RMT && releaseTimer == NULL) {
+    return false; // RMT driver failed to install at boot
+  }
+  requestedBackend = newBackend; // Switched by updateDHTSensor() once no capture is in flight
+  return true;
+}
+
+uint8_t getDHTBackend() {
+  return requestedBackend;
+}
+
+bool isDHTCapturePending() {
+  return capturePending;
+}
+
+DHTStats getDHTStats() {
+  return stats;
+}
@@ -1,5 +1,8 @@
 #include "display.h"
+#include <Arduino_GFX_Library.h>
 #include "sensors.h"
+#include "water_level.h"
+#include "sensor_status.h"
 
 // Initialize display using Arduino_GFX_Library
 Arduino_DataBus *bus = new Arduino_ESP32SPI(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI, -1 /* MISO not used */);
@@ -51,78 +54,71 @@ void initDisplay() {
   gfx->drawRect(145, 295, 10, 10, WHITE);      // Pump outline
 }
 
+// Print a sensor value at the given position, or "--" while the channel is invalid
+static void printSensorValue(int16_t x, int16_t y, uint16_t color, bool valid, const char* format, float value) {
+  gfx->setCursor(x, y);
+  gfx->setTextColor(color);
+  if (valid) {
+    gfx->printf(format, value);
+  } else {
+    gfx->print("--");
+  }
+}
+
 void drawSensorStatus() {
-  // Get all status colors at the start (EDIT THESE FOR YOUR SENSOR RANGES)
-  uint16_t waterTempColor  = getStatusColor(currentSensors.waterTemp, 18, 22, 15, 25, 12, 28);
-  uint16_t phColor         = getStatusColor(currentSensors.waterPH, 5.5, 6.5, 5, 7, 4, 8);
-  uint16_t waterECColor    = getStatusColor(currentSensors.waterEC, 0.8, 1.2, 0.6, 1.8, 0.3, 2.5);
-  uint16_t waterLevelColor = getStatusColor(currentSensors.waterLevel);
-  uint16_t pumpStatusColor = getStatusColor(currentSensors.pumpStatus);
-  uint16_t envTempColor    = getStatusColor(currentSensors.envTemp, 15, 28, 13, 32, 10, 35);
-  uint16_t humidityColor   = getStatusColor(currentSensors.envHumidity, 50, 70, 35, 85, 25, 95);
-  uint16_t lightColor      = getStatusColor(currentSensors.lightLevel, 10, 40000, 5, 50000, 2, 90000);
-  uint16_t co2Color        = getStatusColor(currentSensors.co2Level, 200, 1800, 100, 2200, 50, 3000);
+  SensorStatus status;
+  evaluateSensorStatus(currentSensors, isWaterLevelFault(), status); // Ranges live in sensor_status.cpp
+  uint16_t waterTempColor  = getStatusColor(status.channels[STATUS_WATER_TEMP]);
+  uint16_t phColor         = getStatusColor(status.channels[STATUS_PH]);
+  uint16_t waterECColor    = getStatusColor(status.channels[STATUS_EC]);
+  uint16_t waterLevelColor = getStatusColor(status.channels[STATUS_WATER_LEVEL]);
+  uint16_t pumpStatusColor = getStatusColor(status.channels[STATUS_PUMP]);
+  uint16_t envTempColor    = getStatusColor(status.channels[STATUS_ENV_TEMP]);
+  uint16_t humidityColor   = getStatusColor(status.channels[STATUS_HUMIDITY]);
+  uint16_t lightColor      = getStatusColor(status.channels[STATUS_LIGHT]);
+  uint16_t co2Color        = getStatusColor(status.channels[STATUS_CO2]);
+
+  bool waterTempValid = isSensorValid(currentSensors, SENSOR_VALID_WATER_TEMP);
+  bool phValid        = isSensorValid(currentSensors, SENSOR_VALID_PH);
+  bool waterECValid   = isSensorValid(currentSensors, SENSOR_VALID_EC);
+  bool envTempValid   = isSensorValid(currentSensors, SENSOR_VALID_ENV_TEMP);
+  bool humidityValid  = isSensorValid(currentSensors, SENSOR_VALID_ENV_HUMIDITY);
+  bool lightValid     = isSensorValid(currentSensors, SENSOR_VALID_LIGHT);
+  bool co2Valid       = isSensorValid(currentSensors, SENSOR_VALID_CO2);
 
   // Clear previous values (draw in BLACK)
   gfx->setTextSize(1);
-  gfx->setTextColor(BLACK);
-  gfx->setCursor(45, 290);  gfx->printf("%.1fC", previousSensors.waterTemp);
-  gfx->setCursor(39, 300);  gfx->printf("%.1f", previousSensors.waterPH);
-  gfx->setCursor(39, 310);  gfx->printf("%.2f", previousSensors.waterEC);
+  printSensorValue(45, 290,  BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_WATER_TEMP), "%.1fC", previousSensors.waterTemp);
+  printSensorValue(39, 300,  BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_PH), "%.1f", previousSensors.waterPH);
+  printSensorValue(39, 310,  BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_EC), "%.2f", previousSensors.waterEC);
   gfx->setCursor(206, 295); gfx->printf("%s", previousSensors.pumpStatus ? "ON" : "OFF");
   gfx->setCursor(212, 305); gfx->printf("%s", previousSensors.waterLevel ? "OK" : "LOW");
-  gfx->setCursor(198, 105); gfx->printf("%.1fC", previousSensors.envTemp);
-  gfx->setCursor(192, 120); gfx->printf("%.0f%%", previousSensors.envHumidity);
-  gfx->setCursor(134, 72);  gfx->printf("%.0f lx", previousSensors.lightLevel);
-  gfx->setCursor(192, 167); gfx->printf("%.0fppm", previousSensors.co2Level);
+  printSensorValue(198, 105, BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_ENV_TEMP), "%.1fC", previousSensors.envTemp);
+  printSensorValue(192, 120, BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_ENV_HUMIDITY), "%.0f%%", previousSensors.envHumidity);
+  printSensorValue(134, 72,  BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_LIGHT), "%.0f lx", previousSensors.lightLevel);
+  printSensorValue(192, 167, BLACK, isSensorValid(previousSensors.validMask, SENSOR_VALID_CO2), "%.0fppm", previousSensors.co2Level);
 
   // Draw current values (draw label in WHITE, then value in color)
-  gfx->setCursor(45, 290); gfx->setTextColor(waterTempColor);  gfx->printf("%.1fC", currentSensors.waterTemp);
-  gfx->setCursor(39, 300); gfx->setTextColor(phColor);         gfx->printf("%.1f", currentSensors.waterPH);
-  gfx->setCursor(39, 310); gfx->setTextColor(waterECColor);    gfx->printf("%.2f", currentSensors.waterEC);
+  printSensorValue(45, 290,  waterTempColor, waterTempValid, "%.1fC", currentSensors.waterTemp);
+  printSensorValue(39, 300,  phColor, phValid, "%.1f", currentSensors.waterPH);
+  printSensorValue(39, 310,  waterECColor, waterECValid, "%.2f", currentSensors.waterEC);
   gfx->setCursor(206, 295);gfx->setTextColor(pumpStatusColor); gfx->print(currentSensors.pumpStatus ? "ON" : "OFF");
   gfx->setCursor(212, 305);gfx->setTextColor(waterLevelColor); gfx->print(currentSensors.waterLevel ? "OK" : "LOW");
-  gfx->setCursor(198, 105);gfx->setTextColor(envTempColor);    gfx->printf("%.1fC", currentSensors.envTemp);
-  gfx->setCursor(192, 120);gfx->setTextColor(humidityColor);   gfx->printf("%.0f%%", currentSensors.envHumidity);
-  gfx->setCursor(134, 72); gfx->setTextColor(lightColor);      gfx->printf("%.0f lx", currentSensors.lightLevel);
-  gfx->setCursor(192, 167);gfx->setTextColor(co2Color);        gfx->printf("%.0fppm", currentSensors.co2Level);
+  printSensorValue(198, 105, envTempColor, envTempValid, "%.1fC", currentSensors.envTemp);
+  printSensorValue(192, 120, humidityColor, humidityValid, "%.0f%%", currentSensors.envHumidity);
+  printSensorValue(134, 72,  lightColor, lightValid, "%.0f lx", currentSensors.lightLevel);
+  printSensorValue(192, 167, co2Color, co2Valid, "%.0fppm", currentSensors.co2Level);
   
   // Clear previous system status text with a black rectangle
   gfx->fillRect(32, 44, 120, 16, BLACK); // Clear text area (width: 120px, height: 16px for size 2 text)
   
-  // Calculate overall system status based on worst sensor (excluding pump)
-  uint16_t sensorColors[] = {waterTempColor, phColor, waterECColor, waterLevelColor, envTempColor, humidityColor, lightColor, co2Color};
-  uint16_t systemStatusColor = GREEN; // Start with best status
-  const char* systemStatusText = "System OK";
-  
-  // Check all sensor colors and find the worst one
-  for (int i = 0; i < 8; i++) {
-    if (sensorColors[i] == RED) {
-      systemStatusColor = RED;
-      systemStatusText = "Critical";
-      break; // Red is worst, no need to check further
-    } else if (sensorColors[i] == ORANGE && systemStatusColor != RED) {
-      systemStatusColor = ORANGE;
-      systemStatusText = "Warning";
-    } else if (sensorColors[i] == YELLOW && systemStatusColor != RED && systemStatusColor != ORANGE) {
-      systemStatusColor = YELLOW;
-      systemStatusText = "Caution";
-    }
-  }
-  printSystemStatus(systemStatusColor, systemStatusText); // Print overall system status
-}
-
-// Function to get status color based on value ranges (float)
-uint16_t getStatusColor(float value, float minGood, float maxGood, float minYellow, float maxYellow, float minOrange, float maxOrange) {
-    if (value >= minGood && value <= maxGood) return GREEN;
-    if (value >= minYellow && value <= maxYellow) return YELLOW;
-    if (value >= minOrange && value <= maxOrange) return ORANGE;
-    return RED;
+  printSystemStatus(getStatusColor(status.overall), status.text); // Print overall system status
 }
 
-// Overloaded function to get status color for boolean values
-uint16_t getStatusColor(bool status) {
-    return status ? GREEN : RED;
+// Display color of a STATUS_* level
+uint16_t getStatusColor(uint8_t level) {
+    static const uint16_t colors[] = {GREEN, YELLOW, ORANGE, RED, DARKGREY};
+    return level <= STATUS_INVALID ? colors[level] : RED;
 }
 
 void printSystemStatus(uint16_t color, const char* text) {
@@ -0,0 +1,143 @@
+#include "hal.h"
+#include <Preferences.h>
+#include <esp_adc_cal.h>
+#include "esp_task_wdt.h"
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+
+static esp_adc_cal_characteristics_t adcCharacteristics;
+static portMUX_TYPE halMux = portMUX_INITIALIZER_UNLOCKED;
+Preferences halPrefs; // NVS access for the portable modules
+
+unsigned long halMillis() {
+  return millis();
+}
+
+unsigned long halMicros() {
+  return micros();
+}
+
+void halDelay(unsigned long ms) {
+  delay(ms);
+}
+
+void halPinMode(uint8_t pin, uint8_t mode) {
+  pinMode(pin, mode);
+}
+
+int halDigitalRead(uint8_t pin) {
+  return digitalRead(pin);
+}
+
+void halDigitalWrite(uint8_t pin, uint8_t level) {
+  digitalWrite(pin, level);
+}
+
+void halPwmSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits) {
+  ledcSetup(channel, frequency, resolutionBits);
+}
+
+void halPwmAttach(uint8_t pin, uint8_t channel) {
+  ledcAttachPin(pin, channel);
+}
+
+void halPwmWrite(uint8_t channel, uint32_t duty) {
+  ledcWrite(channel, duty);
+}
+
+uint16_t halAnalogRead(uint8_t pin) {
+  return analogRead(pin);
+}
+
+uint8_t halAdcCharacterize(uint32_t defaultVref) {
+  esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                                        defaultVref, &adcCharacteristics);
+  switch (source) {
+    case ESP_ADC_CAL_VAL_EFUSE_TP: return HAL_ADC_CAL_EFUSE_TWO_POINT;
+    case ESP_ADC_CAL_VAL_EFUSE_VREF: return HAL_ADC_CAL_EFUSE_VREF;
+    default: return HAL_ADC_CAL_DEFAULT_VREF;
+  }
+}
+
+uint32_t halAdcToMillivolts(uint16_t code) {
+  return esp_adc_cal_raw_to_voltage(code, &adcCharacteristics);
+}
+
+uint32_t halAdcVref() {
+  return adcCharacteristics.vref;
+}
+
+size_t halNvsGetBytes(const char* space, const char* key, void* data, size_t length) {
+  halPrefs.begin(space, true);
+  size_t read = halPrefs.getBytes(key, data, length);
+  halPrefs.end();
+  return read;
+}
+
+size_t halNvsPutBytes(const char* space, const char* key, const void* data, size_t length) {
+  halPrefs.begin(space, false);
+  size_t written = halPrefs.putBytes(key, data, length);
+  halPrefs.end();
+  return written;
+}
+
+void halEnterCritical() {
+  portENTER_CRITICAL(&halMux);
+}
+
+void halExitCritical() {
+  portEXIT_CRITICAL(&halMux);
+}
+
+void halWatchdogReset() {
+  esp_task_wdt_reset();
+}
+
+uint32_t halFreeHeap() {
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+uint32_t halMinFreeHeap() {
+  return heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+}
+
+uint32_t halLargestFreeBlock() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+bool halTaskStackFree(const char* taskName, uint32_t &minFreeBytes) {
+  TaskHandle_t task = xTaskGetHandle(taskName);
+  if (task == NULL) {
+    return false;
+  }
+  minFreeBytes = uxTaskGetStackHighWaterMark(task);  // ESP-IDF counts stack in bytes
+  return true;
+}
+
+const char* halResetReason() {
+  switch (esp_reset_reason()) {
+    case ESP_RST_POWERON: return "poweron";
+    case ESP_RST_EXT: return "external";
+    case ESP_RST_SW: return "software";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "int_wdt";
+    case ESP_RST_TASK_WDT: return "task_wdt";
+    case ESP_RST_WDT: return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    case ESP_RST_SDIO: return "sdio";
+    default: return "unknown";
+  }
+}
+
+uint32_t halTaskId() {
+  return (uint32_t)xTaskGetCurrentTaskHandle();
+}
+
+const char* halTaskName(uint32_t taskId) {
+  return pcTaskGetName((TaskHandle_t)taskId);
+}
+
+uint8_t halCoreId() {
+  return xPortGetCoreID();
+}
@@ -0,0 +1,185 @@
+#include "heap_monitor.h"
+#include "hal.h"
+#include "metrics.h"
+
+// Tasks whose stack high-water mark is reported, add new tasks here
+static const char* watchedTasks[] = {"loopTask", "acquisition", "adc_sampler", "async_tcp", "wifi", "tiT",
+                                     "arduino_events", "esp_timer", "IDLE0", "IDLE1"};
+static const char* subsystemNames[HEAP_SUBSYSTEMS] = {"other", "sensors", "control", "display", "logger", "web"};
+
+static HeapSample samples[HEAP_SAMPLES];
+static uint32_t sampleCount = 0;         // Taken since boot, the ring holds the last HEAP_SAMPLES
+static unsigned long lastSampleMs = 0;
+
+struct TaskSubsystem {
+  uint32_t taskId;                        // 0 = free slot
+  uint8_t subsystem;
+};
+
+static TaskSubsystem taskSubsystems[HEAP_MAX_TAGGED_TASKS] = {};
+static AllocationStats allocations[HEAP_SUBSYSTEMS] = {};
+static uint32_t allocationCount = 0;
+static uint32_t freeCount = 0;
+
+float getHeapFragmentation() {
+  uint32_t freeHeap = halFreeHeap();
+  if (freeHeap == 0) {
+    return 0;
+  }
+  return 1.0f - (float)halLargestFreeBlock() / freeHeap;
+}
+
+void sampleHeap() {
+  unsigned long now = halMillis();
+  if (sampleCount > 0 && now - lastSampleMs < HEAP_SAMPLE_INTERVAL_MS) {
+    return;
+  }
+  lastSampleMs = now;
+  HeapSample &sample = samples[sampleCount % HEAP_SAMPLES];
+  sample.uptimeS = now / 1000;
+  sample.freeHeap = halFreeHeap();
+  sample.largestBlock = halLargestFreeBlock();
+  sample.requests = getHttpRequestCount();
+  sample.allocations = allocationCount;
+  sampleCount++;
+}
+
+uint8_t getWatchedTaskCount() {
+  return sizeof(watchedTasks) / sizeof(watchedTasks[0]);
+}
+
+const char* getWatchedTaskName(uint8_t index) {
+  return index < getWatchedTaskCount() ? watchedTasks[index] : "unknown";
+}
+
+const char* getHeapSubsystemName(uint8_t subsystem) {
+  return subsystem < HEAP_SUBSYSTEMS ? subsystemNames[subsystem] : "unknown";
+}
+
+AllocationStats getAllocationStats(uint8_t subsystem) {
+  AllocationStats stats = {};
+  if (subsystem < HEAP_SUBSYSTEMS) {
+    halEnterCritical();
+    stats = allocations[subsystem];
+    halExitCritical();
+  }
+  return stats;
+}
+
+uint32_t getFreeCount() {
+  return freeCount;
+}
+
+uint16_t getHeapSampleCount() {
+  return min(sampleCount, (uint32_t)HEAP_SAMPLES);
+}
+
+// Each task only ever touches its own slot, a free slot is claimed atomically
+uint8_t setHeapSubsystem(uint8_t subsystem) {
+  uint32_t taskId = halTaskId();
+  for (uint8_t i = 0; i < HEAP_MAX_TAGGED_TASKS; i++) {
+    if (__atomic_load_n(&taskSubsystems[i].taskId, __ATOMIC_ACQUIRE) == taskId) {
+      uint8_t previous = taskSubsystems[i].subsystem;
+      taskSubsystems[i].subsystem = subsystem;
+      return previous;
+    }
+  }
+  for (uint8_t i = 0; i < HEAP_MAX_TAGGED_TASKS; i++) {
+    uint32_t expected = 0;
+    if (__atomic_compare_exchange_n(&taskSubsystems[i].taskId, &expected, taskId, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      taskSubsystems[i].subsystem = subsystem;
+      return HEAP_OTHER;
+    }
+  }
+  return HEAP_OTHER;  // Table full, the task's allocations stay under "other"
+}
+
+void beginHeapSamplesExport(HeapSamplesExport &exp) {
+  exp.count = getHeapSampleCount();
+  uint32_t first = sampleCount - exp.count;
+  for (uint16_t i = 0; i < exp.count; i++) {
+    exp.samples[i] = samples[(first + i) % HEAP_SAMPLES];
+  }
+  exp.position = 0;
+  exp.done = false;
+}
+
+static int formatSampleLine(const HeapSamplesExport &exp, uint16_t position, char* line) {
+  if (position == 0) {
+    return snprintf(line, HEAP_CSV_LINE_MAX, "uptime_s,free_bytes,largest_block_bytes,fragmentation,requests,allocations\n");
+  }
+  const HeapSample &sample = exp.samples[position - 1];
+  float fragmentation = sample.freeHeap ? 1.0f - (float)sample.largestBlock / sample.freeHeap : 0;
+  return snprintf(line, HEAP_CSV_LINE_MAX, "%lu,%lu,%lu,%.3f,%lu,%lu\n", (unsigned long)sample.uptimeS,
+                  (unsigned long)sample.freeHeap, (unsigned long)sample.largestBlock, fragmentation,
+                  (unsigned long)sample.requests, (unsigned long)sample.allocations);
+}
+
+size_t readHeapSamplesExport(HeapSamplesExport &exp, char* buffer, size_t maxLen) {
+  size_t written = 0;
+  char line[HEAP_CSV_LINE_MAX];
+  while (exp.position <= exp.count) {
+    int length = formatSampleLine(exp, exp.position, line);
+    length = min(length, HEAP_CSV_LINE_MAX - 1);
+    if (written + length > maxLen) {
+      break;
+    }
+    memcpy(buffer + written, line, length);
+    written += length;
+    exp.position++;
+  }
+  exp.done = exp.position > exp.count;
+  return written;
+}
+
+#if HEAP_TRACKING
+// Linked in place of the allocator with -Wl,--wrap (see heap_monitor.h). Runs for every
+// allocation in the firmware, so only a table lookup and a short critical section.
+static void countAllocation(size_t size) {
+  uint32_t taskId = halTaskId();
+  uint8_t subsystem = HEAP_OTHER;
+  for (uint8_t i = 0; i < HEAP_MAX_TAGGED_TASKS; i++) {
+    if (__atomic_load_n(&taskSubsystems[i].taskId, __ATOMIC_ACQUIRE) == taskId) {
+      subsystem = taskSubsystems[i].subsystem;
+      break;
+    }
+  }
+  halEnterCritical();
+  allocations[subsystem].count++;
+  allocations[subsystem].bytes += size;
+  allocationCount++;
+  halExitCritical();
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+  countAllocation(size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  countAllocation(count * size);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (size > 0) {
+    countAllocation(size);
+  }
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr != NULL) {
+    __atomic_fetch_add(&freeCount, 1, __ATOMIC_RELAXED);
+  }
+  __real_free(ptr);
+}
+}
+#endif
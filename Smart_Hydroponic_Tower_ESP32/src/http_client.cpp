@@ -0,0 +1,51 @@
+#include "http_client.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+void httpBegin(HttpRequest &request, const String &url) {
+  request.url = url;
+  request.headerCount = 0;
+}
+
+bool httpAddHeader(HttpRequest &request, const String &name, const String &value) {
+  if (request.headerCount >= HTTP_MAX_HEADERS) {
+    return false;
+  }
+  request.headerNames[request.headerCount] = name;
+  request.headerValues[request.headerCount] = value;
+  request.headerCount++;
+  return true;
+}
+
+int httpPost(const HttpRequest &request, const String &body) {
+  HTTPClient http;
+  http.begin(request.url);
+  for (uint8_t i = 0; i < request.headerCount; i++) {
+    http.addHeader(request.headerNames[i], request.headerValues[i]);
+  }
+  int httpResponseCode = http.POST(body);
+  http.end();
+  return httpResponseCode;
+}
+
+bool isNetworkConnected() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+static volatile unsigned long connections = 0;
+
+static void onGotIP(WiFiEvent_t event, WiFiEventInfo_t info) {
+  connections++;
+}
+
+void initNetworkMonitor() {
+  WiFi.onEvent(onGotIP, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+int getNetworkRssi() {
+  return isNetworkConnected() ? WiFi.RSSI() : 0;
+}
+
+unsigned long getNetworkReconnects() {
+  return connections > 1 ? connections - 1 : 0;
+}
@@ -0,0 +1,14 @@
+#include "light_sensor.h"
+#include <Wire.h>
+#include <BH1750.h>
+
+BH1750 lightMeter; //Light sensor object
+
+bool initLightSensor() {
+  Wire.begin(); // Initialize the I2C bus (BH1750 library doesn't do this automatically)
+  return lightMeter.begin(); // Initialize the light sensor
+}
+
+float readLightLevel() {
+  return lightMeter.readLightLevel(); // measured in lux, negative on I2C errors
+}
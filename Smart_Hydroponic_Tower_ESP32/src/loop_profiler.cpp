@@ -0,0 +1,104 @@
+#include "loop_profiler.h"
+#include "hal.h"
+
+// Upper bucket bounds (same as the /metrics histograms)
+static const unsigned long bucketUs[PROFILE_BUCKETS] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+                                                        100000, 250000, 1000000, 5000000};
+static const char* stageNames[STAGE_COUNT] = {"sensors", "pump", "ph", "display", "previousValues"};
+static const char* sectionNames[SECTION_COUNT] = {"control", "dataLogger", "selfBench", "webServer"};
+
+static LoopProfile profile = {};
+static unsigned long lastStartUs = 0;     // Start of the previous control tick
+static unsigned long stageMarkUs = 0;
+static unsigned long sectionMarkUs = 0;
+static uint8_t slowestSection = 0;        // Since the previous control tick
+static unsigned long slowestSectionUs = 0;
+
+static void observe(ProfileHistogram &histogram, unsigned long us) {
+  uint8_t bucket = 0;
+  while (bucket < PROFILE_BUCKETS && us > bucketUs[bucket]) {
+    bucket++;
+  }
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  histogram.sumUs += us;
+  histogram.maxUs = max(histogram.maxUs, us);
+}
+
+void beginControlProfile(unsigned long dueUs, uint16_t missedTicks) {
+  unsigned long startUs = halMicros();
+  unsigned long lateUs = startUs - dueUs;
+
+  observe(profile.lateness, lateUs);
+  if (profile.ticks > 0) {
+    unsigned long intervalUs = startUs - lastStartUs;
+    profile.minIntervalUs = profile.ticks > 1 ? min(profile.minIntervalUs, intervalUs) : intervalUs;
+    profile.maxIntervalUs = max(profile.maxIntervalUs, intervalUs);
+  }
+  profile.ticks++;
+  profile.missedTicks += missedTicks;
+
+  if (lateUs >= PROFILE_STALL_US) {
+    StallEvent &event = profile.stallLog[profile.stalls % PROFILE_STALL_LOG];
+    event.atMs = halMillis();
+    event.lateUs = lateUs;
+    event.missedTicks = missedTicks;
+    event.section = slowestSection;
+    event.sectionUs = slowestSectionUs;
+    profile.stalls++;
+    Serial.printf("Control tick %lums late, %u missed (%s took %lums)\n", lateUs / 1000, missedTicks,
+                  sectionNames[slowestSection], slowestSectionUs / 1000);
+  }
+
+  lastStartUs = startUs;
+  stageMarkUs = startUs;
+  slowestSectionUs = 0;
+}
+
+void profileStage(uint8_t stage) {
+  unsigned long now = halMicros();
+  if (stage < STAGE_COUNT) {
+    observe(profile.stages[stage], now - stageMarkUs);
+  }
+  stageMarkUs = now;
+}
+
+void beginLoopProfile() {
+  sectionMarkUs = halMicros();
+}
+
+void profileSection(uint8_t section) {
+  unsigned long now = halMicros();
+  unsigned long us = now - sectionMarkUs;
+  sectionMarkUs = now;
+  if (section >= SECTION_COUNT) {
+    return;
+  }
+  LoopSectionStats &stats = profile.sections[section];
+  stats.maxUs = max(stats.maxUs, us);
+  stats.totalUs += us;
+  if (us > slowestSectionUs) {
+    slowestSection = section;
+    slowestSectionUs = us;
+  }
+}
+
+void resetLoopProfile() {
+  memset(&profile, 0, sizeof(profile));
+}
+
+LoopProfile getLoopProfile() {
+  return profile;
+}
+
+unsigned long getProfileBucketUs(uint8_t bucket) {
+  return bucket < PROFILE_BUCKETS ? bucketUs[bucket] : 0;
+}
+
+const char* getStageName(uint8_t stage) {
+  return stage < STAGE_COUNT ? stageNames[stage] : "unknown";
+}
+
+const char* getSectionName(uint8_t section) {
+  return section < SECTION_COUNT ? sectionNames[section] : "unknown";
+}
@@ -4,24 +4,83 @@
 #include "wifi_server.h"
 #include "pump_control.h"
 #include "data_logger.h"
+#include "sensor_scheduler.h"
+#include "self_bench.h"
+#include "span_trace.h"
+#include "metrics.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
 
-#define measureInterval 1000000 //1 second (1,000,000 microseconds)
+#define measureInterval (SCHEDULER_TICK_MS * 1000) // Scheduler tick in microseconds
+#define controlTicks (1000 / SCHEDULER_TICK_MS)    // Control and display still run once per second
+
+// Sensor acquisition task
+#define ACQUISITION_CORE 1       // Same core as the loop, WiFi stays on core 0
+#define ACQUISITION_PRIORITY 2   // Above the loop so ticks aren't delayed by web/display work
+#define ACQUISITION_STACK 6144
 
 // Timer variables
 hw_timer_t * timer = NULL;
 volatile bool readSensors = false;
+volatile unsigned int tickCount = 0;
+volatile unsigned long controlDueUs = 0;      // When the pending control tick fell due
+volatile uint16_t controlTicksMissed = 0;     // Fell due again before the loop got to it
+TaskHandle_t acquisitionTaskHandle = NULL;
 
-// Timer interrupt service routine
+// Timer interrupt service routine: wakes the acquisition task every tick, the loop once per second
 void IRAM_ATTR onTimer() {
-  readSensors = true;
+  BaseType_t higherPriorityWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(acquisitionTaskHandle, &higherPriorityWoken);
+  if (++tickCount >= controlTicks) {
+    tickCount = 0;
+    if (readSensors) {
+      controlTicksMissed++;
+    } else {
+      controlDueUs = micros();
+    }
+    readSensors = true;
+  }
+  if (higherPriorityWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+// Reads the sensors due on each tick and publishes a new snapshot
+void acquisitionTask(void *parameter) {
+  HEAP_SCOPE(HEAP_SENSORS);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    TRACE_BEGIN("acquisitionTick");
+    unsigned long startUs = micros();
+    updateSensorValues();
+    observeAcquisitionTick(micros() - startUs);
+    TRACE_END("acquisitionTick");
+    updateActuatorMetrics();
+  }
 }
 
 void handleSystemUpdate() {
-  updateSensorValues(); // Update sensor values
+  TRACE_SPAN("systemUpdate");
+  HEAP_SCOPE(HEAP_CONTROL);
+  getSensorSnapshot(currentSensors); // Consistent copy, never half old and half new
+  profileStage(STAGE_SENSORS);
+  TRACE_BEGIN("pumpControl");
   updatePumpControl();  // Update pump control
+  TRACE_END("pumpControl");
+  profileStage(STAGE_PUMP);
+  TRACE_BEGIN("phControl");
   updatePHControl();    // Update pH control
-  drawSensorStatus(); // Redraw sensor status with updated values
+  TRACE_END("phControl");
+  profileStage(STAGE_PH);
+  TRACE_BEGIN("drawSensorStatus");
+  {
+    HEAP_SCOPE(HEAP_DISPLAY);
+    drawSensorStatus(); // Redraw sensor status with updated values
+  }
+  TRACE_END("drawSensorStatus");
+  profileStage(STAGE_DISPLAY);
   updatePreviousValues(); // Update previous values for next clearing cycle
+  profileStage(STAGE_PREVIOUS);
 }
 
 void setup() {
@@ -33,24 +92,48 @@ void setup() {
   initWiFi(); // Initialize WiFi and web server
   initDataLogger(); // Initialize simple data logging
 
+  // Sensor acquisition runs in its own task, everything else reads its snapshots
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQUISITION_STACK, NULL,
+                          ACQUISITION_PRIORITY, &acquisitionTaskHandle, ACQUISITION_CORE);
+
   // Initialize timer (Timer 0, divider 80, count up)
   timer = timerBegin(0, 80, true); // ESP32 clock is 80MHz, so: 80MHz/80 = 1MHz = 1μs per tick
   timerAttachInterrupt(timer, &onTimer, true); // Attach interrupt function to timer
-  timerAlarmWrite(timer, measureInterval, true); // Set timer to trigger every 1 seconds
+  timerAlarmWrite(timer, measureInterval, true); // Set timer to trigger every scheduler tick
   timerAlarmEnable(timer); // Enable the timer
+
+  if (SELF_BENCH_AT_BOOT) {
+    startSelfBench(false);
+  }
  
 }
 
 void loop() {
+  beginLoopProfile();
   if (readSensors) {
+    unsigned long dueUs = controlDueUs;
+    uint16_t missed = controlTicksMissed;
+    controlTicksMissed = 0;
     readSensors = false; // Reset the flag
+    beginControlProfile(dueUs, missed);
+    unsigned long startUs = micros();
     handleSystemUpdate();
+    observeSystemUpdate(micros() - startUs);
+    sampleHeap(); // Heap history for /diagnostics, every HEAP_SAMPLE_INTERVAL_MS
+    updateLiveState(); // /state ETag, dashboards on /ws
   }
+  profileSection(SECTION_CONTROL);
 
   // Handle data logging (checks timer internally)
   logSensorDataToCloud();
+  profileSection(SECTION_LOGGER);
+
+  // One sample of a running self benchmark (GET/POST /bench)
+  serviceSelfBench();
+  profileSection(SECTION_SELF_BENCH);
 
   // Handle any additional web server tasks if needed
   handleWebServer();
+  profileSection(SECTION_WEB);
 
-}
\ No newline at end of file
+}
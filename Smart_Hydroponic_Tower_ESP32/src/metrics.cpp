@@ -0,0 +1,266 @@
+#include "metrics.h"
+#include "pump_control.h"
+#include "http_client.h"
+
+// Upper bucket bounds, with their "le" label
+static const unsigned long bucketUs[METRICS_BUCKETS] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+                                                        100000, 250000, 1000000, 5000000};
+static const char* bucketLabels[METRICS_BUCKETS] = {"0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005",
+                                                    "0.01", "0.025", "0.1", "0.25", "1", "5"};
+static const char* actuatorNames[ACTUATOR_COUNT] = {"water_pump", "ph_up", "ph_down"};
+
+static LatencyHistogram acquisitionTick = {};
+static LatencyHistogram systemUpdate = {};
+static LatencyHistogram upload = {};
+static LatencyHistogram sensorReads[SCHEDULER_MAX_TASKS] = {};
+static RouteMetrics routes[METRICS_MAX_ROUTES] = {};
+static uint8_t routeCount = 0;
+static uint32_t requestCount = 0;
+static uint32_t uploadsOk = 0;
+static uint32_t uploadsFailed = 0;
+static uint32_t uploadRetries = 0;
+static ActuatorMetrics actuators[ACTUATOR_COUNT] = {};
+static unsigned long lastActuatorPollMs = 0;
+
+static void observe(LatencyHistogram &histogram, unsigned long us) {
+  uint8_t bucket = 0;
+  while (bucket < METRICS_BUCKETS && us > bucketUs[bucket]) {
+    bucket++;
+  }
+  histogram.buckets[bucket]++;
+  histogram.sumUs += us;
+}
+
+void observeAcquisitionTick(unsigned long us) {
+  observe(acquisitionTick, us);
+}
+
+void observeSystemUpdate(unsigned long us) {
+  observe(systemUpdate, us);
+}
+
+void observeSensorRead(uint8_t task, unsigned long us) {
+  if (task < SCHEDULER_MAX_TASKS) {
+    observe(sensorReads[task], us);
+  }
+}
+
+void observeRoute(const char* route, unsigned long us) {
+  requestCount++;
+  // Routes are string literals, the pointer identifies them
+  for (uint8_t i = 0; i < routeCount; i++) {
+    if (routes[i].route == route) {
+      observe(routes[i].latency, us);
+      return;
+    }
+  }
+  if (routeCount < METRICS_MAX_ROUTES) {
+    routes[routeCount].route = route;
+    observe(routes[routeCount].latency, us);
+    routeCount++;
+  }
+}
+
+uint32_t getHttpRequestCount() {
+  return requestCount;
+}
+
+void observeUpload(unsigned long us, bool success, uint8_t attempts) {
+  observe(upload, us);
+  if (success) {
+    uploadsOk++;
+  } else {
+    uploadsFailed++;
+  }
+  uploadRetries += attempts > 1 ? attempts - 1 : 0;
+}
+
+// Polled every 50ms tick instead of hooking each switch: also covers manual toggles from
+// the web handlers, and on-time is accurate to one tick
+void updateActuatorMetrics() {
+  bool states[ACTUATOR_COUNT] = {getPumpState(), getPHUpState(), getPHDownState()};
+  unsigned long now = halMillis();
+  for (uint8_t i = 0; i < ACTUATOR_COUNT; i++) {
+    ActuatorMetrics &actuator = actuators[i];
+    if (actuator.on) {
+      actuator.onMs += now - lastActuatorPollMs;
+    }
+    if (states[i] && !actuator.on) {
+      actuator.activations++;
+    }
+    actuator.on = states[i];
+  }
+  lastActuatorPollMs = now;
+}
+
+void beginMetricsExport(MetricsExport &exp) {
+  exp.uptimeMs = halMillis();
+  exp.freeHeap = halFreeHeap();
+  exp.minFreeHeap = halMinFreeHeap();
+  exp.largestFreeBlock = halLargestFreeBlock();
+  exp.networkConnected = isNetworkConnected();
+  exp.rssi = getNetworkRssi();
+  exp.reconnects = getNetworkReconnects();
+  exp.acquisitionTick = acquisitionTick;
+  exp.systemUpdate = systemUpdate;
+  exp.upload = upload;
+  exp.scheduler = getSchedulerStats();
+  exp.taskCount = getSensorTaskCount();
+  for (uint8_t i = 0; i < exp.taskCount; i++) {
+    SensorTask task = getSensorTask(i);
+    exp.taskNames[i] = task.name;
+    exp.taskSamples[i] = task.samples;
+    exp.sensorReads[i] = sensorReads[i];
+  }
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    exp.health[i] = getSensorHealth(i);
+  }
+  exp.routeCount = routeCount;
+  memcpy(exp.routes, routes, sizeof(RouteMetrics) * routeCount);
+  exp.uploadsOk = uploadsOk;
+  exp.uploadsFailed = uploadsFailed;
+  exp.uploadRetries = uploadRetries;
+  memcpy(exp.actuators, actuators, sizeof(actuators));
+  exp.linesSent = 0;
+  exp.done = false;
+}
+
+// Writes whole lines into one chunk: lines sent in earlier chunks are skipped without
+// formatting, the first line that doesn't fit ends the chunk
+struct MetricsWriter {
+  char* buffer;
+  size_t maxLen;
+  size_t written;
+  uint16_t line;
+  uint16_t firstLine;
+  bool full;
+};
+
+static void emit(MetricsWriter &w, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void emit(MetricsWriter &w, const char* format, ...) {
+  if (w.full) {
+    return;
+  }
+  if (w.line < w.firstLine) {
+    w.line++;
+    return;
+  }
+  char text[METRICS_LINE_MAX];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  length = min(max(length, 0), METRICS_LINE_MAX - 1);
+  if (w.written + length > w.maxLen) {
+    w.full = true;
+    return;
+  }
+  memcpy(w.buffer + w.written, text, length);
+  w.written += length;
+  w.line++;
+}
+
+static void emitHeader(MetricsWriter &w, const char* name, const char* type, const char* help) {
+  emit(w, "# HELP %s %s\n", name, help);
+  emit(w, "# TYPE %s %s\n", name, type);
+}
+
+// labels: "" or e.g. "sensor=\"co2\"", without braces
+static void emitHistogram(MetricsWriter &w, const char* name, const char* labels, const LatencyHistogram &h) {
+  const char* separator = labels[0] ? "," : "";
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < METRICS_BUCKETS; i++) {
+    cumulative += h.buckets[i];
+    emit(w, "%s_bucket{%s%sle=\"%s\"} %lu\n", name, labels, separator, bucketLabels[i], (unsigned long)cumulative);
+  }
+  cumulative += h.buckets[METRICS_BUCKETS];
+  emit(w, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, separator, (unsigned long)cumulative);
+  if (labels[0]) {
+    emit(w, "%s_sum{%s} %.6f\n", name, labels, h.sumUs / 1e6);
+    emit(w, "%s_count{%s} %lu\n", name, labels, (unsigned long)cumulative);
+  } else {
+    emit(w, "%s_sum %.6f\n", name, h.sumUs / 1e6);
+    emit(w, "%s_count %lu\n", name, (unsigned long)cumulative);
+  }
+}
+
+static void writeMetrics(const MetricsExport &exp, MetricsWriter &w) {
+  char labels[80];
+
+  emitHeader(w, "hydro_uptime_seconds", "gauge", "Time since boot");
+  emit(w, "hydro_uptime_seconds %.3f\n", exp.uptimeMs / 1000.0);
+  emitHeader(w, "hydro_heap_free_bytes", "gauge", "Free heap");
+  emit(w, "hydro_heap_free_bytes %lu\n", (unsigned long)exp.freeHeap);
+  emitHeader(w, "hydro_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+  emit(w, "hydro_heap_min_free_bytes %lu\n", (unsigned long)exp.minFreeHeap);
+  emitHeader(w, "hydro_heap_largest_free_block_bytes", "gauge", "Largest allocatable block");
+  emit(w, "hydro_heap_largest_free_block_bytes %lu\n", (unsigned long)exp.largestFreeBlock);
+
+  emitHeader(w, "hydro_wifi_connected", "gauge", "1 while the station is connected");
+  emit(w, "hydro_wifi_connected %d\n", exp.networkConnected ? 1 : 0);
+  emitHeader(w, "hydro_wifi_rssi_dbm", "gauge", "Signal strength of the access point");
+  emit(w, "hydro_wifi_rssi_dbm %d\n", exp.rssi);
+  emitHeader(w, "hydro_wifi_reconnects_total", "counter", "Connections after the first one");
+  emit(w, "hydro_wifi_reconnects_total %lu\n", exp.reconnects);
+
+  emitHeader(w, "hydro_acquisition_tick_seconds", "histogram", "Sensor acquisition tick (every 50ms)");
+  emitHistogram(w, "hydro_acquisition_tick_seconds", "", exp.acquisitionTick);
+  emitHeader(w, "hydro_system_update_seconds", "histogram", "Loop control, pH and display update (every second)");
+  emitHistogram(w, "hydro_system_update_seconds", "", exp.systemUpdate);
+  emitHeader(w, "hydro_scheduler_deferrals_total", "counter", "Sensor reads pushed back by the tick budget");
+  emit(w, "hydro_scheduler_deferrals_total %lu\n", exp.scheduler.deferrals);
+
+  emitHeader(w, "hydro_sensor_read_seconds", "histogram", "Duration of one scheduled sensor read");
+  for (uint8_t i = 0; i < exp.taskCount; i++) {
+    snprintf(labels, sizeof(labels), "sensor=\"%s\"", exp.taskNames[i]);
+    emitHistogram(w, "hydro_sensor_read_seconds", labels, exp.sensorReads[i]);
+  }
+  emitHeader(w, "hydro_sensor_samples_total", "counter", "Reads that produced a new sample");
+  for (uint8_t i = 0; i < exp.taskCount; i++) {
+    emit(w, "hydro_sensor_samples_total{sensor=\"%s\"} %lu\n", exp.taskNames[i], exp.taskSamples[i]);
+  }
+  emitHeader(w, "hydro_sensor_failures_total", "counter", "Failed reads per device");
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    emit(w, "hydro_sensor_failures_total{device=\"%s\"} %lu\n", getSensorName(i), exp.health[i].totalFailures);
+  }
+  emitHeader(w, "hydro_sensor_valid", "gauge", "1 while the device's readings can be trusted");
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    emit(w, "hydro_sensor_valid{device=\"%s\"} %d\n", getSensorName(i), exp.health[i].valid ? 1 : 0);
+  }
+
+  emitHeader(w, "hydro_http_request_seconds", "histogram", "Web handler duration per route");
+  for (uint8_t i = 0; i < exp.routeCount; i++) {
+    const char* route = exp.routes[i].route;
+    const char* path = strchr(route, ' ');
+    snprintf(labels, sizeof(labels), "method=\"%.*s\",route=\"%s\"", path ? (int)(path - route) : 0, route,
+             path ? path + 1 : route);
+    emitHistogram(w, "hydro_http_request_seconds", labels, exp.routes[i].latency);
+  }
+
+  emitHeader(w, "hydro_upload_seconds", "histogram", "Supabase upload including retries and back-off");
+  emitHistogram(w, "hydro_upload_seconds", "", exp.upload);
+  emitHeader(w, "hydro_uploads_total", "counter", "Finished uploads by result");
+  emit(w, "hydro_uploads_total{result=\"success\"} %lu\n", (unsigned long)exp.uploadsOk);
+  emit(w, "hydro_uploads_total{result=\"failure\"} %lu\n", (unsigned long)exp.uploadsFailed);
+  emitHeader(w, "hydro_upload_retries_total", "counter", "Repeated upload attempts");
+  emit(w, "hydro_upload_retries_total %lu\n", (unsigned long)exp.uploadRetries);
+
+  emitHeader(w, "hydro_actuator_activations_total", "counter", "Times the output was switched on");
+  for (uint8_t i = 0; i < ACTUATOR_COUNT; i++) {
+    emit(w, "hydro_actuator_activations_total{actuator=\"%s\"} %lu\n", actuatorNames[i],
+         (unsigned long)exp.actuators[i].activations);
+  }
+  emitHeader(w, "hydro_actuator_on_seconds_total", "counter", "Cumulative on-time");
+  for (uint8_t i = 0; i < ACTUATOR_COUNT; i++) {
+    emit(w, "hydro_actuator_on_seconds_total{actuator=\"%s\"} %.2f\n", actuatorNames[i],
+         exp.actuators[i].onMs / 1000.0);
+  }
+}
+
+size_t readMetricsExport(MetricsExport &exp, char* buffer, size_t maxLen) {
+  MetricsWriter w = {buffer, maxLen, 0, 0, exp.linesSent, false};
+  writeMetrics(exp, w);
+  exp.linesSent = w.line;
+  exp.done = !w.full;
+  return w.written;
+}
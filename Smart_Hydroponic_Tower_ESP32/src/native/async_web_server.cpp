@@ -0,0 +1,705 @@
+#include <ESPAsyncWebServer.h>
+#include "fake_hardware.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Host stand-in for ESPAsyncWebServer/AsyncTCP: one thread, non-blocking sockets, every
+// handler runs from fakeServerPoll() between ticks of the fake clock
+
+struct AsyncWebServer::Client {
+  int fd;
+  std::string in;
+  std::string out;             // Not sent yet
+  AwsResponseFiller filler;    // Chunked response still producing
+  size_t fillerIndex;
+  bool responded;              // Close once out is empty and the filler is done
+  AsyncWebSocket *socket;      // Upgraded to a WebSocket, stays open
+  AsyncWebSocketClient *wsClient;
+};
+
+static AsyncWebServer *activeServer = NULL;
+static uint16_t portOverride = 0;
+static unsigned long requestCount = 0;
+static unsigned long rejectedCount = 0;
+
+void fakeServerSetPort(uint16_t port) {
+  portOverride = port;
+}
+
+unsigned long fakeGetServerRequestCount() {
+  return requestCount;
+}
+
+unsigned long fakeGetServerRejectedCount() {
+  return rejectedCount;
+}
+
+static const char* statusText(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+static WebRequestMethodComposite parseMethod(const std::string &method) {
+  static const struct { const char* name; WebRequestMethodComposite method; } methods[] = {
+    {"GET", HTTP_GET}, {"POST", HTTP_POST}, {"DELETE", HTTP_DELETE}, {"PUT", HTTP_PUT},
+    {"PATCH", HTTP_PATCH}, {"HEAD", HTTP_HEAD}, {"OPTIONS", HTTP_OPTIONS},
+  };
+  for (const auto &entry : methods) {
+    if (method == entry.name) {
+      return entry.method;
+    }
+  }
+  return 0;
+}
+
+static String urlDecode(const std::string &text) {
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '+') {
+      decoded += ' ';
+    } else if (text[i] == '%' && i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) &&
+               isxdigit((unsigned char)text[i + 2])) {
+      decoded += (char)strtol(text.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+    } else {
+      decoded += text[i];
+    }
+  }
+  return String(decoded);
+}
+
+// WebSocket
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+static uint32_t rotateLeft(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+// Only for the handshake's Sec-WebSocket-Accept
+static void sha1(const std::string &text, uint8_t digest[20]) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  std::string message = text;
+  uint64_t bits = (uint64_t)text.size() * 8;
+  message += (char)0x80;
+  while (message.size() % 64 != 56) {
+    message += (char)0;
+  }
+  for (int i = 7; i >= 0; i--) {
+    message += (char)(bits >> (i * 8));
+  }
+  for (size_t block = 0; block < message.size(); block += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const uint8_t *p = (const uint8_t*)message.data() + block + i * 4;
+      w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+    for (int i = 16; i < 80; i++) {
+      w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotateLeft(b, 30);
+      b = a;
+      a = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  for (int i = 0; i < 20; i++) {
+    digest[i] = h[i / 4] >> (24 - (i % 4) * 8);
+  }
+}
+
+static std::string base64(const uint8_t *data, size_t length) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string encoded;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t group = (uint32_t)data[i] << 16 | (i + 1 < length ? data[i + 1] << 8 : 0) | (i + 2 < length ? data[i + 2] : 0);
+    encoded += alphabet[group >> 18 & 63];
+    encoded += alphabet[group >> 12 & 63];
+    encoded += i + 1 < length ? alphabet[group >> 6 & 63] : '=';
+    encoded += i + 2 < length ? alphabet[group & 63] : '=';
+  }
+  return encoded;
+}
+
+// Server frames are never masked or fragmented
+static void queueFrame(std::string &out, uint8_t opcode, const char *data, size_t length) {
+  out += (char)(0x80 | opcode);
+  if (length < 126) {
+    out += (char)length;
+  } else if (length <= 0xFFFF) {
+    out += (char)126;
+    out += (char)(length >> 8);
+    out += (char)length;
+  } else {
+    out += (char)127;
+    for (int i = 7; i >= 0; i--) {
+      out += (char)((uint64_t)length >> (i * 8));
+    }
+  }
+  out.append(data, length);
+}
+
+void AsyncWebSocketClient::text(const String &message) {
+  if (_out && !_closing) {
+    queueFrame(*_out, WS_TEXT, message.c_str(), message.length());
+  }
+}
+
+void AsyncWebSocketClient::close() {
+  if (_out && !_closing) {
+    const char status[2] = {(char)(1000 >> 8), (char)(1000 & 0xFF)};  // Normal closure
+    queueFrame(*_out, WS_DISCONNECT, status, sizeof(status));
+    _closing = true;
+  }
+}
+
+size_t AsyncWebSocket::count() const {
+  size_t open = 0;
+  for (const auto &client : _clients) {
+    open += client->_out && !client->_closing;
+  }
+  return open;
+}
+
+void AsyncWebSocket::textAll(const String &message) {
+  for (auto &client : _clients) {
+    client->text(message);
+  }
+}
+
+void AsyncWebSocket::cleanupClients(uint16_t maxClients) {
+  for (auto &client : _clients) {
+    if (count() <= maxClients) {
+      break;
+    }
+    client->close();
+  }
+}
+
+// Request
+
+bool AsyncWebServerRequest::hasParam(const String &name, bool post, bool file) const {
+  return getParam(name, post, file) != NULL;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const {
+  if (post || file) {
+    return NULL; // Only query parameters, the handlers don't read form bodies
+  }
+  for (const auto &param : _params) {
+    if (param->name() == name) {
+      return param.get();
+    }
+  }
+  return NULL;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String &name) const {
+  return getHeader(name) != NULL;
+}
+
+AsyncWebHeader *AsyncWebServerRequest::getHeader(const String &name) const {
+  for (const auto &header : _headers) {
+    if (strcasecmp(header->name().c_str(), name.c_str()) == 0) {
+      return header.get();
+    }
+  }
+  return NULL;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content) {
+  AsyncWebServerResponse *response = new AsyncWebServerResponse;
+  response->code = code;
+  response->contentType = contentType;
+  response->content = content;
+  return response;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller filler) {
+  AsyncWebServerResponse *response = beginResponse(200, contentType);
+  response->filler = filler;
+  return response;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response) {
+  _response.reset(response);
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content) {
+  send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String &contentType, const char *content) {
+  send(beginResponse(code, contentType, String(content)));
+}
+
+// Server
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : port(port) {
+}
+
+AsyncWebServer::~AsyncWebServer() {
+  end();
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler) {
+  routes.push_back({String(uri), method, handler});
+}
+
+void AsyncWebServer::addHandler(AsyncWebHandler *handler) {
+  AsyncWebSocket *socket = dynamic_cast<AsyncWebSocket*>(handler);
+  if (socket) {
+    sockets.push_back(socket);
+  }
+}
+
+void AsyncWebServer::begin() {
+  if (portOverride) {
+    port = portOverride;
+  }
+  listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 128) < 0) {
+    fprintf(stderr, "Can't listen on port %u: %s\n", port, strerror(errno));
+    close(listenFd);
+    listenFd = -1;
+    return;
+  }
+  activeServer = this;
+}
+
+void AsyncWebServer::end() {
+  for (auto &client : clients) {
+    close(client->fd);
+  }
+  clients.clear();
+  for (AsyncWebSocket *socket : sockets) {
+    socket->_clients.clear();
+  }
+  if (listenFd >= 0) {
+    close(listenFd);
+    listenFd = -1;
+  }
+  if (activeServer == this) {
+    activeServer = NULL;
+  }
+}
+
+static void queueResponse(AsyncWebServer::Client &client, AsyncWebServerResponse &response) {
+  std::string head = "HTTP/1.1 " + std::to_string(response.code) + " " + statusText(response.code) + "\r\n";
+  head += "Connection: close\r\nAccept-Ranges: none\r\n";
+  if (response.filler) {
+    head += "Transfer-Encoding: chunked\r\n";
+  } else {
+    head += "Content-Length: " + std::to_string(response.content.length()) + "\r\n";
+  }
+  if (response.contentType.length()) {
+    head += std::string("Content-Type: ") + response.contentType.c_str() + "\r\n";
+  }
+  for (const auto &header : response.headers) {
+    head += std::string(header.first.c_str()) + ": " + header.second.c_str() + "\r\n";
+  }
+  client.out += head + "\r\n";
+  if (response.filler) {
+    client.filler = response.filler;
+    client.fillerIndex = 0;
+  } else {
+    client.out.append(response.content.c_str(), response.content.length());
+  }
+  client.responded = true;
+}
+
+static void upgradeClient(AsyncWebServer::Client &client, AsyncWebSocket &socket, const AsyncWebServerRequest &request) {
+  AsyncWebHeader *keyHeader = request.getHeader("Sec-WebSocket-Key");
+  std::string key = keyHeader ? keyHeader->value().c_str() : "";
+  if (key.empty()) {
+    AsyncWebServerResponse response;
+    response.code = 400;
+    queueResponse(client, response);
+    return;
+  }
+  uint8_t digest[20];
+  sha1(key + WS_GUID, digest);
+  client.out += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n\r\n";
+
+  AsyncWebSocketClient *wsClient = new AsyncWebSocketClient;
+  wsClient->_id = socket._nextId++;
+  wsClient->_server = &socket;
+  wsClient->_out = &client.out;
+  socket._clients.emplace_back(wsClient);
+  client.socket = &socket;
+  client.wsClient = wsClient;
+  if (socket._handler) {
+    socket._handler(&socket, wsClient, WS_EVT_CONNECT, NULL, NULL, 0);
+  }
+}
+
+static void dispatch(AsyncWebServer &server, AsyncWebServer::Client &client, const std::string &head) {
+  AsyncWebServerRequest request;
+  size_t methodEnd = head.find(' ');
+  size_t targetEnd = methodEnd == std::string::npos ? std::string::npos : head.find(' ', methodEnd + 1);
+  if (targetEnd == std::string::npos) {
+    AsyncWebServerResponse response;
+    response.code = 400;
+    queueResponse(client, response);
+    return;
+  }
+  request._method = parseMethod(head.substr(0, methodEnd));
+  std::string target = head.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+  size_t query = target.find('?');
+  request._url = urlDecode(target.substr(0, query));
+  if (query != std::string::npos) {
+    std::string params = target.substr(query + 1);
+    size_t start = 0;
+    while (start <= params.size()) {
+      size_t end = params.find('&', start);
+      std::string pair = params.substr(start, end == std::string::npos ? std::string::npos : end - start);
+      if (!pair.empty()) {
+        size_t equals = pair.find('=');
+        request._params.emplace_back(new AsyncWebParameter(
+          urlDecode(pair.substr(0, equals)), equals == std::string::npos ? String() : urlDecode(pair.substr(equals + 1))));
+      }
+      if (end == std::string::npos) {
+        break;
+      }
+      start = end + 1;
+    }
+  }
+  size_t lineStart = head.find("\r\n");
+  while (lineStart != std::string::npos) {
+    lineStart += 2;
+    size_t lineEnd = head.find("\r\n", lineStart);
+    std::string line = head.substr(lineStart, lineEnd == std::string::npos ? std::string::npos : lineEnd - lineStart);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      std::string value = line.substr(colon + 1);
+      value.erase(0, value.find_first_not_of(" \t"));
+      value.erase(value.find_last_not_of(" \t") + 1);
+      request._headers.emplace_back(new AsyncWebHeader(line.substr(0, colon).c_str(), value.c_str()));
+    }
+    lineStart = lineEnd;
+  }
+
+  requestCount++;
+  for (AsyncWebSocket *socket : server.sockets) {
+    if (request._url == socket->_url && request._method == HTTP_GET) {
+      upgradeClient(client, *socket, request);
+      return;
+    }
+  }
+  for (const AsyncWebServer::Route &route : server.routes) {
+    if (!(route.methods & request._method)) {
+      continue;
+    }
+    if (route.uri != request._url && !request._url.startsWith(route.uri + "/")) {
+      continue;
+    }
+    route.handler(&request);
+    if (request._response) {
+      queueResponse(client, *request._response);
+    } else {
+      client.responded = true; // Never answered, the connection is just closed
+    }
+    return;
+  }
+  AsyncWebServerResponse response;
+  response.code = 404;
+  queueResponse(client, response);
+}
+
+// A complete head (and body, which is read and dropped) is answered
+static void readClient(AsyncWebServer &server, AsyncWebServer::Client &client, bool &closed) {
+  char buffer[4096];
+  for (;;) {
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (n > 0) {
+      client.in.append(buffer, n);
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      closed = !client.responded || client.out.empty();
+    }
+    break;
+  }
+  if (client.responded) {
+    client.in.clear();
+    return;
+  }
+  size_t headEnd = client.in.find("\r\n\r\n");
+  if (headEnd == std::string::npos) {
+    if (client.in.size() > FAKE_SERVER_REQUEST_MAX) {
+      AsyncWebServerResponse response;
+      response.code = 431;
+      queueResponse(client, response);
+      closed = false;
+    }
+    return;
+  }
+  std::string head = client.in.substr(0, headEnd);
+  size_t bodyLength = 0;
+  std::string lower = head;
+  for (char &c : lower) c = tolower((unsigned char)c);
+  size_t contentLength = lower.find("\r\ncontent-length:");
+  if (contentLength != std::string::npos) {
+    bodyLength = strtoul(head.c_str() + contentLength + 17, NULL, 10);
+  }
+  if (client.in.size() < headEnd + 4 + bodyLength && !closed) {
+    return;
+  }
+  dispatch(server, client, head);
+  if (client.wsClient) {
+    client.in.erase(0, headEnd + 4); // Frames may follow the handshake right away
+  } else {
+    client.in.clear();
+  }
+  closed = false;
+}
+
+// Client frames are masked; control frames are answered here, the rest go to the handler
+static void readFrames(AsyncWebServer::Client &client, bool &closed) {
+  char buffer[4096];
+  for (;;) {
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (n > 0) {
+      client.in.append(buffer, n);
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      closed = true;
+    }
+    break;
+  }
+
+  AsyncWebSocket &socket = *client.socket;
+  AsyncWebSocketClient &wsClient = *client.wsClient;
+  while (client.in.size() >= 2) {
+    const uint8_t *frame = (const uint8_t*)client.in.data();
+    uint8_t opcode = frame[0] & 0x0F;
+    bool final = frame[0] & 0x80;
+    uint64_t length = frame[1] & 0x7F;
+    size_t offset = 2;
+    if (length == 126 || length == 127) {
+      size_t bytes = length == 126 ? 2 : 8;
+      if (client.in.size() < offset + bytes) {
+        return;
+      }
+      length = 0;
+      for (size_t i = 0; i < bytes; i++) {
+        length = length << 8 | frame[offset + i];
+      }
+      offset += bytes;
+    }
+    if (!(frame[1] & 0x80) || length > FAKE_SERVER_REQUEST_MAX) {
+      closed = true;  // Unmasked or oversized, the library drops the connection too
+      return;
+    }
+    if (client.in.size() < offset + 4 + length) {
+      return;
+    }
+    AwsFrameInfo info = {};
+    info.message_opcode = opcode;
+    info.final = final;
+    info.masked = 1;
+    info.opcode = opcode;
+    info.len = length;
+    memcpy(info.mask, frame + offset, 4);
+    std::string payload = client.in.substr(offset + 4, length);
+    for (size_t i = 0; i < payload.size(); i++) {
+      payload[i] ^= info.mask[i % 4];
+    }
+    client.in.erase(0, offset + 4 + length);
+
+    if (opcode == WS_PING) {
+      queueFrame(client.out, WS_PONG, payload.data(), payload.size());
+    } else if (opcode == WS_DISCONNECT) {
+      wsClient.close();
+    } else if (socket._handler && !wsClient._closing) {
+      AwsEventType type = opcode == WS_PONG ? WS_EVT_PONG : WS_EVT_DATA;
+      socket._handler(&socket, &wsClient, type, &info, (uint8_t*)&payload[0], payload.size());
+    }
+  }
+}
+
+static void closeSocketClient(AsyncWebServer::Client &client) {
+  AsyncWebSocket &socket = *client.socket;
+  client.wsClient->_out = NULL;
+  if (socket._handler) {
+    socket._handler(&socket, client.wsClient, WS_EVT_DISCONNECT, NULL, NULL, 0);
+  }
+  socket._clients.erase(std::remove_if(socket._clients.begin(), socket._clients.end(),
+                                       [&client](const std::unique_ptr<AsyncWebSocketClient> &entry) {
+                                         return entry.get() == client.wsClient;
+                                       }),
+                        socket._clients.end());
+  client.wsClient = NULL;
+  client.socket = NULL;
+}
+
+// Sends what is queued, refilling from a chunked response's filler as the socket drains
+static bool writeClient(AsyncWebServer::Client &client) {
+  for (;;) {
+    if (client.out.empty() && client.filler) {
+      uint8_t chunk[FAKE_SERVER_CHUNK_SIZE];
+      size_t length = client.filler(chunk, sizeof(chunk), client.fillerIndex);
+      if (length == RESPONSE_TRY_AGAIN) {
+        return true;  // Polled again on the next pass
+      }
+      char size[16];
+      snprintf(size, sizeof(size), "%zx\r\n", length);
+      client.out += size;
+      client.out.append((const char*)chunk, length);
+      client.out += "\r\n";
+      client.fillerIndex += length;
+      if (length == 0) {
+        client.filler = nullptr;
+      }
+    }
+    if (client.out.empty()) {
+      return true;
+    }
+    ssize_t n = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+    if (n < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    client.out.erase(0, n);
+    if (!client.out.empty()) {
+      return true;
+    }
+  }
+}
+
+// Connections beyond the pool are reset straight away, as lwIP does without a free PCB
+static void acceptClients(AsyncWebServer &server) {
+  for (;;) {
+    int fd = accept4(server.listenFd, NULL, NULL, SOCK_NONBLOCK);
+    if (fd < 0) {
+      return;
+    }
+    if (server.clients.size() >= FAKE_SERVER_MAX_CLIENTS) {
+      linger reset = {1, 0};
+      setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+      close(fd);
+      rejectedCount++;
+      continue;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    AsyncWebServer::Client *client = new AsyncWebServer::Client;
+    client->fd = fd;
+    client->fillerIndex = 0;
+    client->responded = false;
+    client->socket = NULL;
+    client->wsClient = NULL;
+    server.clients.emplace_back(client);
+  }
+}
+
+bool fakeServerPoll(int timeoutMs) {
+  AsyncWebServer *server = activeServer;
+  if (!server) {
+    return false;
+  }
+  std::vector<pollfd> fds;
+  fds.push_back({server->listenFd, POLLIN, 0});
+  for (auto &client : server->clients) {
+    short events = client->responded ? POLLOUT : POLLIN;
+    if (client->wsClient) {
+      events = client->out.empty() ? POLLIN : POLLIN | POLLOUT;
+    }
+    fds.push_back({client->fd, events, 0});
+  }
+  int ready = poll(fds.data(), fds.size(), timeoutMs);
+  if (ready <= 0) {
+    return false;
+  }
+
+  size_t count = server->clients.size();
+  for (size_t i = 0; i < count; i++) {
+    AsyncWebServer::Client &client = *server->clients[i];
+    short events = fds[i + 1].revents;
+    if (!events) {
+      continue;
+    }
+    bool closed = false;
+    if (client.wsClient) {
+      if (events & (POLLIN | POLLHUP | POLLERR)) {
+        readFrames(client, closed);
+      }
+      closed = closed || !writeClient(client) || (client.wsClient->_closing && client.out.empty());
+    } else {
+      if (events & (POLLIN | POLLHUP | POLLERR)) {
+        readClient(*server, client, closed);
+      }
+      if (!closed && client.wsClient) {
+        readFrames(client, closed);  // Just upgraded
+      }
+      if (!closed && (client.responded || client.wsClient)) {
+        closed = !writeClient(client) || (!client.wsClient && client.out.empty() && !client.filler);
+      }
+    }
+    if (closed && client.wsClient) {
+      closeSocketClient(client);
+    }
+    if (closed) {
+      shutdown(client.fd, SHUT_RDWR);
+      close(client.fd);
+      client.fd = -1;
+    }
+  }
+  server->clients.erase(std::remove_if(server->clients.begin(), server->clients.end(),
+                                       [](const std::unique_ptr<AsyncWebServer::Client> &client) { return client->fd < 0; }),
+                        server->clients.end());
+  if (fds[0].revents & POLLIN) {
+    acceptClients(*server);
+  }
+  return true;
+}
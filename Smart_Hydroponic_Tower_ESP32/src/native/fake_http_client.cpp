@@ -0,0 +1,68 @@
+#include "fake_hardware.h"
+#include "http_client.h"
+#include <WiFi.h>
+
+// Host stand-in for HTTPClient, requests are counted and answered with a fixed status
+
+static bool networkConnected = true;
+static unsigned long reconnects = 0;
+static int httpStatus = 201;
+static unsigned long postCount = 0;
+static String lastBody;
+
+WiFiClass WiFi;
+
+void fakeSetNetworkConnected(bool connected) {
+  if (connected && !networkConnected) {
+    reconnects++;
+  }
+  networkConnected = connected;
+}
+
+void fakeSetHttpStatus(int status) {
+  httpStatus = status;
+}
+
+unsigned long fakeGetHttpPostCount() {
+  return postCount;
+}
+
+String fakeGetLastHttpBody() {
+  return lastBody;
+}
+
+void httpBegin(HttpRequest &request, const String &url) {
+  request.url = url;
+  request.headerCount = 0;
+}
+
+bool httpAddHeader(HttpRequest &request, const String &name, const String &value) {
+  if (request.headerCount >= HTTP_MAX_HEADERS) {
+    return false;
+  }
+  request.headerNames[request.headerCount] = name;
+  request.headerValues[request.headerCount] = value;
+  request.headerCount++;
+  return true;
+}
+
+int httpPost(const HttpRequest &request, const String &body) {
+  postCount++;
+  lastBody = body;
+  return networkConnected ? httpStatus : -1; // HTTPC_ERROR_CONNECTION_REFUSED
+}
+
+bool isNetworkConnected() {
+  return networkConnected;
+}
+
+void initNetworkMonitor() {
+}
+
+int getNetworkRssi() {
+  return networkConnected ? -60 : 0; // Typical indoor link
+}
+
+unsigned long getNetworkReconnects() {
+  return reconnects;
+}
@@ -0,0 +1,226 @@
+#include "fake_hardware.h"
+#include "water_temp.h"
+#include "co2_sensor.h"
+#include "dht_sensor.h"
+#include "adc_sampler.h"
+#include "light_sensor.h"
+#include "sensor_health.h"
+#include "calibration.h"
+#include "hal.h"
+
+// Host stand-ins for the sensor drivers: every read completes at once with the values
+// set through fake_hardware.h, a faulty device behaves like one that never answers
+
+static bool sensorFault[SENSOR_COUNT] = {};
+
+void fakeSetSensorFault(uint8_t sensor, bool fault) {
+  if (sensor < SENSOR_COUNT) sensorFault[sensor] = fault;
+}
+
+// DS18B20 bus, three probes at fixed ROM codes
+static float waterTemps[MAX_WATER_PROBES] = {21.0, 21.0, 21.0};
+static uint8_t waterResolution = WATER_TEMP_RESOLUTION_DEFAULT;
+static uint8_t requestedResolution = WATER_TEMP_RESOLUTION_DEFAULT;
+static WaterTempTiming waterTiming = {};
+static const char* probeNames[MAX_WATER_PROBES] = {"reservoir", "towerTop", "rootZone"};
+
+void fakeSetWaterTemps(float reservoir, float towerTop, float rootZone) {
+  waterTemps[WATER_PROBE_RESERVOIR] = reservoir;
+  waterTemps[WATER_PROBE_TOWER_TOP] = towerTop;
+  waterTemps[WATER_PROBE_ROOT_ZONE] = rootZone;
+}
+
+static unsigned long conversionTimeMs(uint8_t bits) {
+  return 750UL >> (12 - bits); // 94, 188, 375, 750ms
+}
+
+void initWaterTemp() {
+  waterTiming.resolution = waterResolution;
+  waterTiming.conversionTimeMs = conversionTimeMs(waterResolution);
+}
+
+bool updateWaterTemp(float temperatures[MAX_WATER_PROBES]) {
+  waterResolution = requestedResolution;
+  waterTiming.resolution = waterResolution;
+  waterTiming.conversionTimeMs = conversionTimeMs(waterResolution);
+  waterTiming.conversionMs = waterTiming.conversionTimeMs;
+  for (int i = 0; i < MAX_WATER_PROBES; i++) {
+    temperatures[i] = sensorFault[SENSOR_WATER_TEMP] ? WATER_TEMP_DISCONNECTED : waterTemps[i];
+  }
+  waterTiming.readCount++;
+  return true;
+}
+
+bool setWaterTempResolution(int bits) {
+  if (bits < 9 || bits > 12) {
+    return false;
+  }
+  requestedResolution = bits;
+  return true;
+}
+
+uint8_t getWaterTempResolution() {
+  return requestedResolution;
+}
+
+void rescanWaterProbes() {
+}
+
+WaterTempTiming getWaterTempTiming() {
+  return waterTiming;
+}
+
+WaterProbe getWaterProbe(uint8_t slot) {
+  WaterProbe probe = {};
+  if (slot < MAX_WATER_PROBES) {
+    probe.address[0] = 0x28; // DS18B20 family code
+    probe.address[1] = slot + 1;
+    probe.assigned = true;
+    probe.present = !sensorFault[SENSOR_WATER_TEMP];
+  }
+  return probe;
+}
+
+const char* getWaterProbeName(uint8_t slot) {
+  return slot < MAX_WATER_PROBES ? probeNames[slot] : "unknown";
+}
+
+uint8_t getWaterProbeCount() {
+  return sensorFault[SENSOR_WATER_TEMP] ? 0 : MAX_WATER_PROBES;
+}
+
+// MH-Z19
+static float co2Ppm = 800;
+static CO2Stats co2Stats = {};
+
+void fakeSetCO2(float ppm) {
+  co2Ppm = ppm;
+}
+
+void initCO2Sensor() {
+}
+
+bool updateCO2Sensor(float &co2) {
+  co2Stats.commandsSent++;
+  if (sensorFault[SENSOR_CO2]) {
+    co2Stats.timeouts++;
+    co2Stats.stale = halMillis() - co2Stats.lastFrameMs >= CO2_STALE_MS;
+    return false;
+  }
+  co2Stats.framesReceived++;
+  co2Stats.lastFrameMs = halMillis();
+  co2Stats.stale = false;
+  co2 = co2Ppm;
+  return true;
+}
+
+bool isCO2Stale() {
+  return co2Stats.stale;
+}
+
+bool isCO2ReplyPending() {
+  return false;
+}
+
+CO2Stats getCO2Stats() {
+  return co2Stats;
+}
+
+// DHT22
+static float dhtTemperature = 24.0;
+static float dhtHumidity = 60.0;
+static DHTStats dhtStats = {DHT_BACKEND_DEFAULT};
+
+void fakeSetDHT(float temperature, float humidity) {
+  dhtTemperature = temperature;
+  dhtHumidity = humidity;
+}
+
+void initDHTSensor() {
+}
+
+bool updateDHTSensor(float &temperature, float &humidity) {
+  if (sensorFault[SENSOR_DHT]) {
+    dhtStats.timeouts++;
+    return false;
+  }
+  dhtStats.reads++;
+  dhtStats.lastReadMs = halMillis();
+  temperature = dhtTemperature;
+  humidity = dhtHumidity;
+  return true;
+}
+
+bool setDHTBackend(uint8_t backend) {
+  if (backend != DHT_BACKEND_ADAFRUIT && backend != DHT_BACKEND_RMT) {
+    return false;
+  }
+  dhtStats.backend = backend;
+  return true;
+}
+
+uint8_t getDHTBackend() {
+  return dhtStats.backend;
+}
+
+bool isDHTCapturePending() {
+  return false;
+}
+
+DHTStats getDHTStats() {
+  return dhtStats;
+}
+
+// BH1750
+static float lightLux = 1000;
+
+void fakeSetLight(float lux) {
+  lightLux = lux;
+}
+
+bool initLightSensor() {
+  return true;
+}
+
+float readLightLevel() {
+  return sensorFault[SENSOR_LIGHT] ? -1 : lightLux;
+}
+
+// pH/EC probes: raw ADC code the firmware converts back to the wanted value
+// (the conversions are monotonic, so a bisection over the code range finds it)
+template <typename Convert>
+static uint16_t invertConversion(Convert convert, float target) {
+  int low = 1, high = 4094;
+  bool rising = convert(high) > convert(low);
+  while (high - low > 1) {
+    int middle = (low + high) / 2;
+    if ((convert(middle) < target) == rising) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return fabs(convert(low) - target) <= fabs(convert(high) - target) ? low : high;
+}
+
+void fakeSetPH(float ph) {
+  fakeSetAnalog(waterPHPin, invertConversion([](float code) { return convertPH(code); }, ph));
+}
+
+void fakeSetEC(float ec, float temperature) {
+  fakeSetAnalog(waterECPin, invertConversion([temperature](float code) { return convertEC(code, temperature); }, ec));
+}
+
+// No sampler task on the host, pH/EC fall back to one halAnalogRead() per tick
+bool initAdcSampler() {
+  return false;
+}
+
+bool updateAdcSampler(float values[ADC_CHANNEL_COUNT]) {
+  return false;
+}
+
+AdcSamplerStats getAdcSamplerStats() {
+  AdcSamplerStats stats = {};
+  return stats;
+}
@@ -0,0 +1,75 @@
+#include "fake_hardware.h"
+#include "water_level.h"
+#include "pump_control.h"
+#include "hal.h"
+
+// Host stand-in for the level interrupt: no debounce timer, a low level is latched on the spot
+
+static bool interlocked = false;
+static bool faultLatched = false;
+static bool lockPHPumps = WATER_LEVEL_LOCK_PH_DEFAULT;
+static WaterLevelStats stats = {};
+
+// A direct write takes the pump pin away from the PWM, like the GPIO matrix switch on the device
+static void forcePumpsLow() {
+  halDigitalWrite(waterPumpPin, LOW);
+  if (lockPHPumps) {
+    halDigitalWrite(phUpPumpPin, LOW);
+    halDigitalWrite(phDownPumpPin, LOW);
+  }
+}
+
+void fakeSetWaterPresent(bool present) {
+  fakeSetPin(waterLevelPin, present ? LOW : HIGH);
+  if (present || interlocked) {
+    return;
+  }
+  forcePumpsLow();
+  interlocked = true;
+  faultLatched = true;
+  stats.trips++;
+  stats.lastTripMs = halMillis();
+}
+
+void initWaterLevel() {
+  halPinMode(waterLevelPin, INPUT);
+  if (halDigitalRead(waterLevelPin) == HIGH) {
+    forcePumpsLow();
+    interlocked = true;
+    faultLatched = true;
+  }
+}
+
+bool isPumpInterlocked() {
+  return interlocked;
+}
+
+bool isWaterLevelFault() {
+  return faultLatched;
+}
+
+bool arePHPumpsLocked() {
+  return interlocked && lockPHPumps;
+}
+
+bool clearWaterLevelFault() {
+  if (halDigitalRead(waterLevelPin) == HIGH) {
+    return false; // Still no water
+  }
+  faultLatched = false;
+  interlocked = false;
+  reconnectPumpOutputs();
+  return true;
+}
+
+void setWaterLevelPHLock(bool lock) {
+  lockPHPumps = lock;
+}
+
+WaterLevelStats getWaterLevelStats() {
+  WaterLevelStats current = stats;
+  current.interlocked = interlocked;
+  current.faultLatched = faultLatched;
+  current.lockPHPumps = lockPHPumps;
+  return current;
+}
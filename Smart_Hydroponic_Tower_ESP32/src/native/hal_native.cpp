@@ -0,0 +1,179 @@
+#include "hal.h"
+#include "fake_hardware.h"
+#include <map>
+#include <string>
+#include <vector>
+
+#define FAKE_PIN_COUNT 40
+#define FAKE_PWM_CHANNELS 16
+
+HardwareSerial Serial;
+
+static unsigned long long clockUs = 0;
+static uint8_t inputLevels[FAKE_PIN_COUNT] = {};
+static uint8_t outputLevels[FAKE_PIN_COUNT] = {};
+static uint8_t pinChannels[FAKE_PIN_COUNT] = {};  // PWM channel + 1 driving the pin, 0 = plain GPIO
+static uint32_t pwmDuty[FAKE_PWM_CHANNELS] = {};
+static uint16_t analogValues[FAKE_PIN_COUNT] = {};
+static uint32_t adcVref = 1100;
+static std::map<std::string, std::vector<uint8_t>> nvs; // "namespace/key" -> blob
+
+// Clock
+unsigned long halMillis() {
+  return (unsigned long)(clockUs / 1000);
+}
+
+unsigned long halMicros() {
+  return (unsigned long)clockUs;
+}
+
+void halDelay(unsigned long ms) {
+  clockUs += ms * 1000ULL; // Nothing else runs while a single-threaded host waits
+}
+
+void delay(unsigned long ms) {
+  halDelay(ms);
+}
+
+void fakeAdvanceMicros(unsigned long long us) {
+  clockUs += us;
+}
+
+void fakeAdvanceMillis(unsigned long ms) {
+  clockUs += ms * 1000ULL;
+}
+
+unsigned long long fakeMicros() {
+  return clockUs;
+}
+
+// GPIO and PWM
+void halPinMode(uint8_t pin, uint8_t mode) {
+}
+
+int halDigitalRead(uint8_t pin) {
+  if (pin >= FAKE_PIN_COUNT) return LOW;
+  return inputLevels[pin];
+}
+
+void halDigitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= FAKE_PIN_COUNT) return;
+  pinChannels[pin] = 0; // Like the GPIO matrix, a direct write takes the pin away from the PWM
+  outputLevels[pin] = level ? HIGH : LOW;
+}
+
+void halPwmSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits) {
+  if (channel < FAKE_PWM_CHANNELS) pwmDuty[channel] = 0;
+}
+
+void halPwmAttach(uint8_t pin, uint8_t channel) {
+  if (pin < FAKE_PIN_COUNT && channel < FAKE_PWM_CHANNELS) pinChannels[pin] = channel + 1;
+}
+
+void halPwmWrite(uint8_t channel, uint32_t duty) {
+  if (channel < FAKE_PWM_CHANNELS) pwmDuty[channel] = duty;
+}
+
+void fakeSetPin(uint8_t pin, uint8_t level) {
+  if (pin < FAKE_PIN_COUNT) inputLevels[pin] = level ? HIGH : LOW;
+}
+
+uint8_t fakeGetPin(uint8_t pin) {
+  if (pin >= FAKE_PIN_COUNT) return LOW;
+  if (pinChannels[pin]) return pwmDuty[pinChannels[pin] - 1] ? HIGH : LOW;
+  return outputLevels[pin];
+}
+
+uint32_t fakeGetPwmDuty(uint8_t channel) {
+  return channel < FAKE_PWM_CHANNELS ? pwmDuty[channel] : 0;
+}
+
+bool fakeIsPwmAttached(uint8_t pin) {
+  return pin < FAKE_PIN_COUNT && pinChannels[pin] != 0;
+}
+
+// ADC, linear over the 11dB range instead of the eFuse curve
+uint16_t halAnalogRead(uint8_t pin) {
+  return pin < FAKE_PIN_COUNT ? analogValues[pin] : 0;
+}
+
+uint8_t halAdcCharacterize(uint32_t defaultVref) {
+  adcVref = defaultVref;
+  return HAL_ADC_CAL_DEFAULT_VREF;
+}
+
+uint32_t halAdcToMillivolts(uint16_t code) {
+  return (uint32_t)code * 3300 / 4095;
+}
+
+uint32_t halAdcVref() {
+  return adcVref;
+}
+
+void fakeSetAnalog(uint8_t pin, uint16_t code) {
+  if (pin < FAKE_PIN_COUNT) analogValues[pin] = code > 4095 ? 4095 : code;
+}
+
+// Non-volatile storage, lives as long as the process
+size_t halNvsGetBytes(const char* space, const char* key, void* data, size_t length) {
+  auto entry = nvs.find(std::string(space) + "/" + key);
+  if (entry == nvs.end() || entry->second.size() > length) {
+    return 0;
+  }
+  memcpy(data, entry->second.data(), entry->second.size());
+  return entry->second.size();
+}
+
+size_t halNvsPutBytes(const char* space, const char* key, const void* data, size_t length) {
+  const uint8_t *bytes = (const uint8_t*)data;
+  nvs[std::string(space) + "/" + key].assign(bytes, bytes + length);
+  return length;
+}
+
+void fakeClearNvs() {
+  nvs.clear();
+}
+
+// The host heap is not tracked
+uint32_t halFreeHeap() {
+  return 0;
+}
+
+uint32_t halMinFreeHeap() {
+  return 0;
+}
+
+uint32_t halLargestFreeBlock() {
+  return 0;
+}
+
+bool halTaskStackFree(const char* taskName, uint32_t &minFreeBytes) {
+  return false;
+}
+
+const char* halResetReason() {
+  return "poweron";
+}
+
+// Single-threaded host, nothing can preempt the caller
+void halEnterCritical() {
+}
+
+void halExitCritical() {
+}
+
+void halWatchdogReset() {
+}
+
+// Single-threaded host: everything runs in one task on one core
+uint32_t halTaskId() {
+  return 1;
+}
+
+const char* halTaskName(uint32_t taskId) {
+  return "main";
+}
+
+uint8_t halCoreId() {
+  return 0;
+}
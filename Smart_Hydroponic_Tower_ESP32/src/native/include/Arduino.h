@@ -0,0 +1,203 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Minimal Arduino core for the native (Linux) environment: just enough of String, Serial
+// and the core macros for the portable modules. Hardware access goes through hal.h.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <cmath>
+#include <string>
+#include <type_traits>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define IRAM_ATTR
+#define PROGMEM
+
+void delay(unsigned long ms);  // Advances the fake clock, as halDelay()
+
+using std::abs;
+using std::isnan;
+using std::round;
+
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type min(T a, U b) { return a < b ? a : b; }
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type max(T a, U b) { return a > b ? a : b; }
+
+class StringSumHelper;
+
+class String {
+ public:
+  String() {}
+  String(const char *text) { if (text) value = text; }
+  String(const std::string &text) : value(text) {}
+  String(char c) : value(1, c) {}
+  String(int number, unsigned char base = 10) { formatInteger((long long)number, base); }
+  String(unsigned int number, unsigned char base = 10) { formatInteger((unsigned long long)number, base); }
+  String(long number, unsigned char base = 10) { formatInteger((long long)number, base); }
+  String(unsigned long number, unsigned char base = 10) { formatInteger((unsigned long long)number, base); }
+  String(long long number, unsigned char base = 10) { formatInteger(number, base); }
+  String(unsigned long long number, unsigned char base = 10) { formatInteger(number, base); }
+  String(float number, unsigned int decimals = 2) { formatFloat(number, decimals); }
+  String(double number, unsigned int decimals = 2) { formatFloat(number, decimals); }
+
+  String &operator=(const char *text) { value = text ? text : ""; return *this; }
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool reserve(unsigned int size) { value.reserve(size); return true; }
+  char operator[](unsigned int index) const { return index < value.length() ? value[index] : 0; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+
+  bool concat(const String &text) { value += text.value; return true; }
+  bool concat(const char *text) { if (text) value += text; return text != NULL; }
+  bool concat(const char *text, unsigned int length) { if (text) value.append(text, length); return text != NULL; }
+  bool concat(char c) { value += c; return true; }
+  template <typename T>
+  bool concat(T number) { return concat(String(number)); }
+  template <typename T>
+  String &operator+=(const T &other) { concat(other); return *this; }
+
+  bool equals(const String &other) const { return value == other.value; }
+  bool operator==(const String &other) const { return value == other.value; }
+  bool operator==(const char *text) const { return text && value == text; }
+  bool operator!=(const String &other) const { return value != other.value; }
+  bool operator!=(const char *text) const { return !(*this == text); }
+  bool operator<(const String &other) const { return value < other.value; }
+
+  int indexOf(char c, unsigned int from = 0) const { size_t i = value.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+  int indexOf(const String &text, unsigned int from = 0) const { size_t i = value.find(text.value, from); return i == std::string::npos ? -1 : (int)i; }
+  bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.length(), prefix.value) == 0; }
+  bool endsWith(const String &suffix) const {
+    return value.length() >= suffix.value.length() &&
+           value.compare(value.length() - suffix.value.length(), suffix.value.length(), suffix.value) == 0;
+  }
+  String substring(unsigned int from) const { return from < value.length() ? String(value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < value.length() && to > from ? String(value.substr(from, to - from)) : String();
+  }
+  void trim() {
+    size_t first = value.find_first_not_of(" \t\r\n");
+    size_t last = value.find_last_not_of(" \t\r\n");
+    value = first == std::string::npos ? "" : value.substr(first, last - first + 1);
+  }
+  void toLowerCase() { for (char &c : value) c = tolower((unsigned char)c); }
+  void replace(const String &find, const String &with) {
+    if (find.value.empty()) return;
+    for (size_t i = value.find(find.value); i != std::string::npos; i = value.find(find.value, i + with.value.length())) {
+      value.replace(i, find.value.length(), with.value);
+    }
+  }
+  long toInt() const { return strtol(value.c_str(), NULL, 10); }
+  float toFloat() const { return strtof(value.c_str(), NULL); }
+
+ private:
+  void formatInteger(long long number, unsigned char base) {
+    if (base == 10) {
+      value = std::to_string(number);
+    } else {
+      formatInteger((unsigned long long)number, base);
+    }
+  }
+  void formatInteger(unsigned long long number, unsigned char base) {
+    if (base < 2 || base > 16) base = 10;
+    char buffer[66];
+    char *p = buffer + sizeof(buffer) - 1;
+    *p = 0;
+    do {
+      *--p = "0123456789abcdef"[number % base];
+      number /= base;
+    } while (number);
+    value = p;
+  }
+  void formatFloat(double number, unsigned int decimals) {
+    if (isnan(number)) { value = "nan"; return; }
+    if (std::isinf(number)) { value = "inf"; return; }
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, number);
+    value = buffer;
+  }
+
+  std::string value;
+};
+
+// Result of String concatenation, so chains like "a" + String(b) + "c" work as on the device
+class StringSumHelper : public String {
+ public:
+  StringSumHelper(const String &s) : String(s) {}
+  StringSumHelper(const char *p) : String(p) {}
+};
+
+inline StringSumHelper operator+(const StringSumHelper &lhs, const String &rhs) {
+  StringSumHelper result(lhs);
+  result.concat(rhs);
+  return result;
+}
+inline StringSumHelper operator+(const StringSumHelper &lhs, const char *rhs) {
+  StringSumHelper result(lhs);
+  result.concat(rhs);
+  return result;
+}
+inline StringSumHelper operator+(const StringSumHelper &lhs, char rhs) {
+  StringSumHelper result(lhs);
+  result.concat(rhs);
+  return result;
+}
+template <typename T>
+inline StringSumHelper operator+(const StringSumHelper &lhs, T rhs) {
+  StringSumHelper result(lhs);
+  result.concat(String(rhs));
+  return result;
+}
+inline StringSumHelper operator+(const String &lhs, const String &rhs) {
+  return StringSumHelper(lhs) + rhs;
+}
+inline StringSumHelper operator+(const String &lhs, const char *rhs) {
+  return StringSumHelper(lhs) + rhs;
+}
+inline StringSumHelper operator+(const char *lhs, const String &rhs) {
+  return StringSumHelper(lhs) + rhs;
+}
+inline bool operator==(const char *lhs, const String &rhs) { return rhs == lhs; }
+
+// Serial writes to stdout (muted = output is dropped, e.g. during a replay)
+class HardwareSerial {
+ public:
+  void begin(unsigned long) {}
+  void setDebugOutput(bool) {}
+  size_t print(const String &s) { return muted || fputs(s.c_str(), stdout) >= 0 ? s.length() : 0; }
+  size_t print(const char *s) { return print(String(s)); }
+  template <typename T>
+  size_t print(T value) { return print(String(value)); }
+  size_t print(double value, int decimals) { return print(String(value, decimals)); }
+  size_t println() { return print("\n"); }
+  template <typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+  size_t println(double value, int decimals) { size_t n = print(value, decimals); return n + println(); }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    if (muted) return 0;
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n < 0 ? 0 : n;
+  }
+  void flush() { fflush(stdout); }
+
+  bool muted = false;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef NATIVE_ARDUINO_GFX_LIBRARY_H
+#define NATIVE_ARDUINO_GFX_LIBRARY_H
+
+// Host stand-in for Arduino_GFX: just enough for display.cpp. Drawing calls are only
+// counted, text is formatted into a line buffer like the library's Print path, so the
+// formatting work in drawSensorStatus() can be measured without a panel.
+
+#include <Arduino.h>
+
+#define BLACK 0x0000
+#define BLUE 0x001F
+#define RED 0xF800
+#define GREEN 0x07E0
+#define CYAN 0x07FF
+#define YELLOW 0xFFE0
+#define WHITE 0xFFFF
+#define ORANGE 0xFD20
+#define DARKGREY 0x7BEF
+
+class Arduino_DataBus {
+ public:
+  virtual ~Arduino_DataBus() {}
+};
+
+class Arduino_ESP32SPI : public Arduino_DataBus {
+ public:
+  Arduino_ESP32SPI(int8_t dc, int8_t cs, int8_t sck, int8_t mosi, int8_t miso) {}
+};
+
+class Arduino_GFX {
+ public:
+  virtual ~Arduino_GFX() {}
+  bool begin() { return true; }
+  void fillScreen(uint16_t color) { drawCalls++; }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) { drawCalls++; }
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) { drawCalls++; }
+  void fillCircle(int16_t x, int16_t y, int16_t r, uint16_t color) { drawCalls++; }
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) { drawCalls++; }
+  void setTextColor(uint16_t color) { textColor = color; }
+  void setTextSize(uint8_t size) { textSize = size; }
+  void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+  size_t print(const char *text) { return write(text, strlen(text)); }
+  size_t print(const String &text) { return write(text.c_str(), text.length()); }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[64];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return n < 0 ? 0 : write(buffer, min((size_t)n, sizeof(buffer) - 1));
+  }
+
+  unsigned long drawCalls = 0;
+  unsigned long charsPrinted = 0;
+
+ private:
+  size_t write(const char *text, size_t length) {
+    cursorX += length * 6 * textSize; // 5x7 font plus spacing
+    charsPrinted += length;
+    return length;
+  }
+
+  int16_t cursorX = 0, cursorY = 0;
+  uint16_t textColor = WHITE;
+  uint8_t textSize = 1;
+};
+
+class Arduino_ST7789 : public Arduino_GFX {
+ public:
+  Arduino_ST7789(Arduino_DataBus *bus, int8_t rst, uint8_t rotation, bool ips, int16_t w, int16_t h) {}
+};
+
+#endif
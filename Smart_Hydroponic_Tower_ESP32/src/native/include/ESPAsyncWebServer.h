@@ -0,0 +1,170 @@
+#ifndef NATIVE_ESP_ASYNC_WEB_SERVER_H
+#define NATIVE_ESP_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Host implementation of the ESPAsyncWebServer API used by wifi_server.cpp, on non-blocking
+// POSIX sockets. Requests are parsed and answered from fakeServerPoll(), routes match like
+// the library's (exact path or a sub-path, first registration wins), every response closes
+// the connection as the library does, WebSocket connections stay open. Only built in the
+// native environment.
+
+#define FAKE_SERVER_MAX_CLIENTS 16     // Open connections, like the ESP32's TCP PCB pool
+#define FAKE_SERVER_REQUEST_MAX 8192   // Longer request heads are answered with 431
+#define FAKE_SERVER_CHUNK_SIZE 1436    // Chunked response buffer (one TCP segment on the device)
+#define DEFAULT_MAX_WS_CLIENTS 8       // As the library on the ESP32
+
+enum WebRequestMethod {
+  HTTP_GET = 0x01,
+  HTTP_POST = 0x02,
+  HTTP_DELETE = 0x04,
+  HTTP_PUT = 0x08,
+  HTTP_PATCH = 0x10,
+  HTTP_HEAD = 0x20,
+  HTTP_OPTIONS = 0x40,
+  HTTP_ANY = 0x7F,
+};
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF  // From a filler: nothing fits now, call again (0 ends the response)
+
+class AsyncWebParameter {
+ public:
+  AsyncWebParameter(const String &name, const String &value) : _name(name), _value(value) {}
+  const String &name() const { return _name; }
+  const String &value() const { return _value; }
+ private:
+  String _name;
+  String _value;
+};
+
+class AsyncWebHeader {
+ public:
+  AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+  const String &name() const { return _name; }
+  const String &value() const { return _value; }
+ private:
+  String _name;
+  String _value;
+};
+
+class AsyncWebServerResponse {
+ public:
+  void addHeader(const String &name, const String &value) { headers.push_back({name, value}); }
+
+  int code = 200;
+  String contentType;
+  String content;
+  AwsResponseFiller filler;     // Set for chunked responses
+  std::vector<std::pair<String, String>> headers;
+};
+
+class AsyncWebServerRequest {
+ public:
+  WebRequestMethodComposite method() const { return _method; }
+  const String &url() const { return _url; }
+  size_t params() const { return _params.size(); }
+  bool hasParam(const String &name, bool post = false, bool file = false) const;
+  AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+  bool hasHeader(const String &name) const;        // Case-insensitive, as the library
+  AsyncWebHeader *getHeader(const String &name) const;
+
+  AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String());
+  AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller filler);
+  void send(AsyncWebServerResponse *response);  // Takes ownership
+  void send(int code, const String &contentType = String(), const String &content = String());
+  void send_P(int code, const String &contentType, const char *content);
+
+  // Server side
+  WebRequestMethodComposite _method = 0;
+  String _url;
+  std::vector<std::unique_ptr<AsyncWebParameter>> _params;
+  std::vector<std::unique_ptr<AsyncWebHeader>> _headers;
+  std::unique_ptr<AsyncWebServerResponse> _response;
+};
+
+// WebSocket: handshake and frames as the library delivers them, one event per received frame
+enum AwsEventType { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA };
+enum AwsFrameType { WS_CONTINUATION = 0x00, WS_TEXT = 0x01, WS_BINARY = 0x02, WS_DISCONNECT = 0x08, WS_PING = 0x09, WS_PONG = 0x0A };
+
+struct AwsFrameInfo {
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+};
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+ public:
+  uint32_t id() const { return _id; }
+  AsyncWebSocket *server() { return _server; }
+  void text(const String &message);
+  void close();
+
+  // Server side
+  uint32_t _id = 0;
+  AsyncWebSocket *_server = NULL;
+  std::string *_out = NULL;         // Connection's send buffer, NULL once it's gone
+  bool _closing = false;
+};
+
+typedef std::function<void(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                           void *arg, uint8_t *data, size_t len)> AwsEventHandler;
+
+class AsyncWebHandler {
+ public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncWebSocket : public AsyncWebHandler {
+ public:
+  explicit AsyncWebSocket(const String &url) : _url(url) {}
+  const char *url() const { return _url.c_str(); }
+  void onEvent(AwsEventHandler handler) { _handler = handler; }
+  size_t count() const;
+  void textAll(const String &message);
+  void cleanupClients(uint16_t maxClients = DEFAULT_MAX_WS_CLIENTS); // Closes the oldest beyond maxClients
+
+  // Server side
+  String _url;
+  AwsEventHandler _handler;
+  std::vector<std::unique_ptr<AsyncWebSocketClient>> _clients;
+  uint32_t _nextId = 1;
+};
+
+class AsyncWebServer {
+ public:
+  explicit AsyncWebServer(uint16_t port);
+  ~AsyncWebServer();
+  void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler);
+  void addHandler(AsyncWebHandler *handler);
+  void begin();
+  void end();
+
+  struct Route {
+    String uri;
+    WebRequestMethodComposite methods;
+    ArRequestHandlerFunction handler;
+  };
+  struct Client;
+
+  uint16_t port;
+  int listenFd = -1;
+  std::vector<Route> routes;
+  std::vector<AsyncWebSocket *> sockets;
+  std::vector<std::unique_ptr<Client>> clients;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <Arduino.h>
+#include "http_client.h"
+
+// Host stand-in for the ESP32 WiFi station: always configured, connected while the fake
+// network is (fakeSetNetworkConnected). Only built in the native environment.
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class IPAddress {
+ public:
+  IPAddress() : octets{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+  }
+  operator String() const { return toString(); }
+ private:
+  uint8_t octets[4];
+};
+
+class WiFiClass {
+ public:
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+              IPAddress dns2 = IPAddress()) {
+    address = local;
+    return true;
+  }
+  void begin(const char* ssid, const char* password) {}
+  int status() { return isNetworkConnected() ? WL_CONNECTED : WL_DISCONNECTED; }
+  IPAddress localIP() { return address; }
+ private:
+  IPAddress address;
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef FAKE_HARDWARE_H
+#define FAKE_HARDWARE_H
+
+#include <Arduino.h>
+
+// Controls for the host fakes behind hal.h and the sensor driver interfaces.
+// Only built in the native environment.
+
+// Clock (starts at 0, only moves when advanced)
+void fakeAdvanceMicros(unsigned long long us);
+void fakeAdvanceMillis(unsigned long ms);
+unsigned long long fakeMicros();
+
+// GPIO, PWM and ADC
+void fakeSetPin(uint8_t pin, uint8_t level);        // Input level seen by halDigitalRead()
+uint8_t fakeGetPin(uint8_t pin);                     // Output level, HIGH for a PWM pin with non-zero duty
+uint32_t fakeGetPwmDuty(uint8_t channel);
+bool fakeIsPwmAttached(uint8_t pin);                 // false after a direct halDigitalWrite() took the pin over
+void fakeSetAnalog(uint8_t pin, uint16_t code);
+void fakeClearNvs();
+
+// Sensor drivers, values are returned on the next read; a faulty driver times out
+void fakeSetWaterTemps(float reservoir, float towerTop, float rootZone);
+void fakeSetCO2(float ppm);
+void fakeSetDHT(float temperature, float humidity);
+void fakeSetLight(float lux);                        // Negative = I2C error
+void fakeSetPH(float ph);                            // ADC code the calibration converts back to this pH
+void fakeSetEC(float ec, float temperature);         // Same for EC (mS/cm at the given water temperature)
+void fakeSetSensorFault(uint8_t sensor, bool fault); // SENSOR_* from sensor_health.h
+
+// Water level switch: a low level trips the interlock immediately, as the interrupt does
+void fakeSetWaterPresent(bool present);
+
+// HTTP client
+void fakeSetNetworkConnected(bool connected);
+void fakeSetHttpStatus(int status);                  // Returned by every httpPost()
+unsigned long fakeGetHttpPostCount();
+String fakeGetLastHttpBody();
+
+// Web server (ESPAsyncWebServer.h on POSIX sockets)
+void fakeServerSetPort(uint16_t port);               // Before initWiFi(), instead of the firmware's port 80
+bool fakeServerPoll(int timeoutMs);                  // Accepts, answers and sends; false if nothing happened
+unsigned long fakeGetServerRequestCount();
+unsigned long fakeGetServerRejectedCount();          // Connections reset because the pool was full
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LOAD_TEST_H
+#define LOAD_TEST_H
+
+#include <Arduino.h>
+#include <vector>
+
+// HTTP load generator for a tower's REST API, real or simulated (program tower). N clients
+// each send requests at a fixed rate, picking routes from a weighted mix, one connection per
+// request as the dashboard's fetch() gets from the device. Reports throughput, latency
+// percentiles, error and reset rates, and the target's heap over the run (GET /diagnostics).
+// Only built in the native environment.
+
+#define LOAD_PORT_DEFAULT 80
+#define LOAD_CLIENTS_DEFAULT 4           // Open dashboard tabs
+#define LOAD_RATE_DEFAULT 3              // Requests per second per client, a tab polls 3 routes every second
+#define LOAD_DURATION_DEFAULT_S 30
+#define LOAD_TIMEOUT_DEFAULT_S 5         // Per request, connect to last byte
+#define LOAD_HEAP_INTERVAL_DEFAULT_S 2   // GET /diagnostics period, 0 = off
+#define LOAD_MAX_CLIENTS 1000
+
+struct LoadRoute {
+  String method;
+  String path;                     // With the query string
+  unsigned weight;
+};
+
+struct LoadOptions {
+  String host;
+  uint16_t port;
+  unsigned clients;
+  float rate;
+  float durationS;
+  float timeoutS;
+  float heapIntervalS;
+  std::vector<LoadRoute> routes;   // Empty = the dashboard's mix
+  String heapCsv;                  // Heap samples written here, empty = not written
+};
+
+// Function declarations
+LoadOptions defaultLoadOptions();
+bool parseLoadOption(LoadOptions &options, const char* arg); // "host[:port]" or "name=value"
+int runLoadTest(const LoadOptions &options);
+
+#endif
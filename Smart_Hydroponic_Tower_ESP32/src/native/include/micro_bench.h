@@ -0,0 +1,16 @@
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <Arduino.h>
+
+// Host microbenchmarks of the hot firmware paths (JSON builders, status strings, filters,
+// status evaluation, display formatting, scheduler/control ticks). Only built in the
+// native environment.
+
+#define BENCH_MIN_TIME_MS 100   // Each repetition runs at least this long
+#define BENCH_REPETITIONS 5     // ns/op is reported as min and median over the repetitions
+
+// Function declarations
+int runBenchmarks(const char* filter, bool json); // filter: substring of the benchmark name, NULL = all
+
+#endif
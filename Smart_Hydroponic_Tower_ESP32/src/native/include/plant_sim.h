@@ -0,0 +1,50 @@
+#ifndef PLANT_SIM_H
+#define PLANT_SIM_H
+
+#include <Arduino.h>
+#include <random>
+#include <vector>
+
+// Closed-loop reservoir model driven by the real pump and pH control code on the fake clock.
+// Only built in the native environment.
+
+struct PlantParams {
+  float volumeL;              // Reservoir volume
+  float bufferMmolPerLPH;     // Buffer capacity: mmol of acid/base per litre per pH unit
+  float acidMolPerL;          // pH DOWN solution strength (mmol H+ per ml)
+  float baseMolPerL;          // pH UP solution strength (mmol OH- per ml)
+  float doseMlPerS;           // Peristaltic pump flow while on
+  float transportDelayS;      // Dosing line and tower loop until the dose reaches the bulk
+  float mixTauPumpOnS;        // Mixing time constant with the circulation pump running
+  float mixTauPumpOffS;       // ... and with it stopped (diffusion only)
+  float probeTauS;            // pH probe response time constant
+  float noisePH;              // Probe noise (standard deviation)
+  float driftPHPerHour;       // Nutrient uptake pushes the pH up over time
+  float startPH;
+  float target;               // 0 = firmware default
+  float tolerance;            // 0 = firmware default
+  float hours;                // Simulated duration
+  unsigned long seed;         // Noise seed, same seed = same run
+  const char* csvPath;        // Optional trajectory (one row per simulated 10 s)
+};
+
+// Reservoir state between scheduler ticks
+struct PlantModel {
+  PlantParams params;
+  float ph;                     // Bulk
+  float probePH;
+  std::vector<float> line;      // mmol H+ per tick still in the dosing line
+  size_t lineHead;
+  float unmixedMmol;            // Entered the reservoir, not mixed yet
+  std::mt19937 random;
+  std::normal_distribution<float> noise;
+};
+
+// Function declarations
+PlantParams defaultPlantParams();
+void initPlantModel(PlantModel &model, const PlantParams &params); // Also sets the fake probes, before initSensors()
+void stepPlantModel(PlantModel &model);                           // One scheduler tick, reads the pump outputs
+bool parsePlantParam(PlantParams &params, const char* arg); // "name=value"
+int runPlantSimulation(const PlantParams &params);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TOWER_SIM_H
+#define TOWER_SIM_H
+
+#include <Arduino.h>
+#include "plant_sim.h"
+
+// A whole simulated tower: the firmware's web server and routes (wifi_server.cpp) on a
+// local port, the sensor scheduler, pump and pH control on the fake clock, the reservoir
+// model behind the pH probe. Runs until SIGINT/SIGTERM. Only built in the native environment.
+
+#define TOWER_PORT_DEFAULT 8080
+#define TOWER_PHOTOPERIOD_H 16     // Grow light on hours per simulated day
+
+struct TowerOptions {
+  uint16_t port;
+  float speed;                     // Simulated seconds per wall clock second
+  bool quiet;                      // Drop the firmware's Serial output
+  PlantParams plant;               // hours is ignored
+};
+
+// Function declarations
+TowerOptions defaultTowerOptions();
+bool parseTowerOption(TowerOptions &options, const char* arg); // "port=", "speed=", "quiet=1" or a plant parameter
+int runTowerSimulation(const TowerOptions &options);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <Arduino.h>
+#include <vector>
+#include "sensors.h"
+
+// Replay of recorded sensor_data rows (Supabase CSV or JSON export) through the firmware
+// core on the fake clock. Only built in the native environment.
+
+#define REPLAY_HOLD_DEFAULT_S 10   // Scheduler ticks run for this long after each row, the rest of the gap is skipped
+#define REPLAY_GAP_MAX_S 3600      // Longer gaps (device offline) are shortened to this
+
+// One recorded row, validMask marks the columns that weren't null
+struct TraceRow {
+  double timeS;      // created_at (or timestamp) in seconds
+  SensorData data;
+};
+
+struct ReplayOptions {
+  unsigned long holdS;  // 0 = run every scheduler tick of every gap
+};
+
+// Function declarations
+bool loadTrace(const char* path, std::vector<TraceRow> &rows); // .json = array of rows, anything else CSV with a header
+int runReplay(const std::vector<TraceRow> &rows, const ReplayOptions &options);
+
+#endif
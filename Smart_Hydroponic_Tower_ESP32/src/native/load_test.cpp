@@ -0,0 +1,537 @@
+#include "load_test.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LOAD_POLL_MAX_MS 50         // Upper bound on one poll() wait
+#define LOAD_RESPONSE_MAX 262144    // Bytes kept per response, the rest is read and dropped
+#define LOAD_SEED 1                 // Route picks are the same from run to run
+
+// The dashboard's polling (web_page.h): three routes every second per open tab
+static const LoadRoute dashboardRoutes[] = {
+  {"GET", "/sensors", 1},
+  {"GET", "/pump/status", 1},
+  {"GET", "/ph/status", 1},
+};
+
+enum RequestOutcome {
+  OUTCOME_OK,          // 1xx-3xx
+  OUTCOME_HTTP_ERROR,  // 4xx/5xx
+  OUTCOME_CONNECT,     // Refused or unreachable
+  OUTCOME_RESET,       // Reset, or closed before a status line
+  OUTCOME_TIMEOUT,
+  OUTCOME_COUNT
+};
+
+enum ClientState { CLIENT_IDLE, CLIENT_CONNECTING, CLIENT_SENDING, CLIENT_READING };
+
+struct LoadClient {
+  int fd = -1;
+  ClientState state = CLIENT_IDLE;
+  bool monitor = false;       // Fetches /diagnostics for the heap series, not counted
+  size_t route = 0;
+  double dueS = 0;            // Scheduled start of the current or next request
+  double startS = 0;          // Actual start, for the timeout
+  std::string request;
+  size_t sent = 0;
+  std::string response;
+  size_t received = 0;
+};
+
+struct RouteResult {
+  unsigned long outcomes[OUTCOME_COUNT];
+  std::vector<double> latencyMs;   // Every request answered with a status line
+};
+
+struct HeapPoint {
+  double atS;
+  unsigned long freeBytes;
+  unsigned long minFreeBytes;
+  unsigned long largestBlockBytes;
+  unsigned long requests;          // Served by the target since boot
+  unsigned long completed;         // By this run, at the time of the sample
+};
+
+struct LoadRun {
+  const LoadOptions* options;
+  std::vector<LoadRoute> routes;
+  unsigned totalWeight;
+  sockaddr_storage address;
+  socklen_t addressLength;
+  std::chrono::steady_clock::time_point start;
+  std::mt19937 random;
+  std::vector<LoadClient> clients;   // Load clients, then the heap monitor
+  std::vector<RouteResult> results;
+  std::vector<HeapPoint> heap;
+  unsigned long completed;
+  unsigned long behind;              // Requests not started by the end, the clients fell behind
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int signal) {
+  stopRequested = 1;
+}
+
+LoadOptions defaultLoadOptions() {
+  LoadOptions options = {};
+  options.port = LOAD_PORT_DEFAULT;
+  options.clients = LOAD_CLIENTS_DEFAULT;
+  options.rate = LOAD_RATE_DEFAULT;
+  options.durationS = LOAD_DURATION_DEFAULT_S;
+  options.timeoutS = LOAD_TIMEOUT_DEFAULT_S;
+  options.heapIntervalS = LOAD_HEAP_INTERVAL_DEFAULT_S;
+  return options;
+}
+
+// "[METHOD@]/path[:weight]", comma separated
+static bool parseRoutes(std::vector<LoadRoute> &routes, const char* list) {
+  std::string text(list);
+  size_t from = 0;
+  while (from < text.size()) {
+    size_t end = text.find(',', from);
+    std::string item = text.substr(from, end == std::string::npos ? std::string::npos : end - from);
+    from = end == std::string::npos ? text.size() : end + 1;
+
+    LoadRoute route = {"GET", "", 1};
+    size_t at = item.find('@');
+    if (at != std::string::npos) {
+      route.method = item.substr(0, at).c_str();
+      item = item.substr(at + 1);
+    }
+    size_t colon = item.rfind(':');
+    if (colon != std::string::npos) {
+      route.weight = strtoul(item.c_str() + colon + 1, NULL, 10);
+      item = item.substr(0, colon);
+    }
+    if (item.empty() || item[0] != '/' || route.weight == 0) {
+      fprintf(stderr, "Bad route %s, expected [METHOD@]/path[:weight]\n", list);
+      return false;
+    }
+    route.path = item.c_str();
+    routes.push_back(route);
+  }
+  return !routes.empty();
+}
+
+bool parseLoadOption(LoadOptions &options, const char* arg) {
+  if (strncmp(arg, "clients=", 8) == 0) {
+    options.clients = strtoul(arg + 8, NULL, 10);
+    return options.clients > 0 && options.clients <= LOAD_MAX_CLIENTS;
+  }
+  if (strncmp(arg, "rate=", 5) == 0) {
+    options.rate = strtof(arg + 5, NULL);
+    return options.rate > 0;
+  }
+  if (strncmp(arg, "duration=", 9) == 0) {
+    options.durationS = strtof(arg + 9, NULL);
+    return options.durationS > 0;
+  }
+  if (strncmp(arg, "timeout=", 8) == 0) {
+    options.timeoutS = strtof(arg + 8, NULL);
+    return options.timeoutS > 0;
+  }
+  if (strncmp(arg, "heap=", 5) == 0) {
+    options.heapIntervalS = strtof(arg + 5, NULL);
+    return options.heapIntervalS >= 0;
+  }
+  if (strncmp(arg, "routes=", 7) == 0) {
+    options.routes.clear();
+    return parseRoutes(options.routes, arg + 7);
+  }
+  if (strncmp(arg, "csv=", 4) == 0) {
+    options.heapCsv = arg + 4;
+    return options.heapCsv.length() > 0;
+  }
+  if (strchr(arg, '=') != NULL) {
+    fprintf(stderr, "Unknown option %s\n", arg);
+    return false;
+  }
+
+  const char* host = strncmp(arg, "http://", 7) == 0 ? arg + 7 : arg;
+  const char* colon = strchr(host, ':');
+  options.host = colon ? String(std::string(host, colon - host)) : String(host);
+  if (colon) {
+    options.port = strtoul(colon + 1, NULL, 10);
+  }
+  return options.host.length() > 0 && options.port > 0;
+}
+
+static double elapsedS(const LoadRun &run) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - run.start).count();
+}
+
+static bool resolveTarget(LoadRun &run) {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* found = NULL;
+  String port(run.options->port);
+  int error = getaddrinfo(run.options->host.c_str(), port.c_str(), &hints, &found);
+  if (error != 0 || found == NULL) {
+    fprintf(stderr, "Can't resolve %s: %s\n", run.options->host.c_str(), gai_strerror(error));
+    return false;
+  }
+  memcpy(&run.address, found->ai_addr, found->ai_addrlen);
+  run.addressLength = found->ai_addrlen;
+  freeaddrinfo(found);
+  return true;
+}
+
+static size_t pickRoute(LoadRun &run) {
+  unsigned pick = run.random() % run.totalWeight;
+  size_t route = 0;
+  while (pick >= run.routes[route].weight) {
+    pick -= run.routes[route].weight;
+    route++;
+  }
+  return route;
+}
+
+// Status code of a complete status line, 0 while it hasn't arrived
+static int parseStatus(const std::string &response) {
+  size_t lineEnd = response.find("\r\n");
+  if (lineEnd == std::string::npos || response.compare(0, 5, "HTTP/") != 0) {
+    return 0;
+  }
+  size_t space = response.find(' ');
+  return space < lineEnd ? atoi(response.c_str() + space + 1) : 0;
+}
+
+static unsigned long jsonNumber(const std::string &body, const char* key) {
+  std::string quoted = std::string("\"") + key + "\":";
+  size_t at = body.find(quoted);
+  return at == std::string::npos ? 0 : strtoul(body.c_str() + at + quoted.size(), NULL, 10);
+}
+
+static void recordHeap(LoadRun &run, const std::string &response) {
+  size_t bodyStart = response.find("\r\n\r\n");
+  if (bodyStart == std::string::npos) {
+    return;
+  }
+  std::string body = response.substr(bodyStart + 4);
+  HeapPoint point = {elapsedS(run), jsonNumber(body, "freeBytes"), jsonNumber(body, "minFreeBytes"),
+                     jsonNumber(body, "largestBlockBytes"), jsonNumber(body, "requests"), run.completed};
+  run.heap.push_back(point);
+}
+
+static void finishRequest(LoadRun &run, LoadClient &client, RequestOutcome outcome) {
+  if (client.fd >= 0) {
+    close(client.fd);
+    client.fd = -1;
+  }
+  client.state = CLIENT_IDLE;
+  if (client.monitor) {
+    if (outcome == OUTCOME_OK) {
+      recordHeap(run, client.response);
+    }
+    client.dueS += run.options->heapIntervalS;
+    return;
+  }
+
+  RouteResult &result = run.results[client.route];
+  result.outcomes[outcome]++;
+  if (outcome == OUTCOME_OK || outcome == OUTCOME_HTTP_ERROR) {
+    // From the scheduled start: a client that fell behind counts its queueing as latency
+    result.latencyMs.push_back((elapsedS(run) - client.dueS) * 1000);
+    run.completed++;
+  }
+  client.dueS += 1 / run.options->rate;
+}
+
+static RequestOutcome socketErrorOutcome(int error, bool connected) {
+  if (error == ETIMEDOUT) {
+    return OUTCOME_TIMEOUT;
+  }
+  return connected ? OUTCOME_RESET : OUTCOME_CONNECT;
+}
+
+static void startRequest(LoadRun &run, LoadClient &client) {
+  const LoadRoute &route = client.monitor ? LoadRoute{"GET", "/diagnostics", 1} : run.routes[client.route = pickRoute(run)];
+  client.request = std::string(route.method.c_str()) + " " + route.path.c_str() + " HTTP/1.1\r\nHost: " +
+                   run.options->host.c_str() + "\r\nConnection: close\r\n";
+  if (route.method != "GET") {
+    client.request += "Content-Length: 0\r\n";
+  }
+  client.request += "\r\n";
+  client.sent = 0;
+  client.response.clear();
+  client.received = 0;
+  client.startS = elapsedS(run);
+
+  client.fd = socket(run.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (client.fd < 0) {
+    perror("socket");
+    finishRequest(run, client, OUTCOME_CONNECT);
+    return;
+  }
+  if (connect(client.fd, (sockaddr*)&run.address, run.addressLength) == 0) {
+    client.state = CLIENT_SENDING;
+  } else if (errno == EINPROGRESS) {
+    client.state = CLIENT_CONNECTING;
+  } else {
+    finishRequest(run, client, socketErrorOutcome(errno, false));
+  }
+}
+
+static void sendRequest(LoadRun &run, LoadClient &client) {
+  ssize_t written = send(client.fd, client.request.data() + client.sent, client.request.size() - client.sent, MSG_NOSIGNAL);
+  if (written < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      finishRequest(run, client, socketErrorOutcome(errno, true));
+    }
+    return;
+  }
+  client.sent += written;
+  if (client.sent == client.request.size()) {
+    client.state = CLIENT_READING;
+  }
+}
+
+static void readResponse(LoadRun &run, LoadClient &client) {
+  char buffer[4096];
+  ssize_t length = recv(client.fd, buffer, sizeof(buffer), 0);
+  if (length < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return;
+    }
+    // The device resets instead of closing sometimes, a full status line still counts
+    int status = parseStatus(client.response);
+    if (status == 0 || errno != ECONNRESET) {
+      finishRequest(run, client, socketErrorOutcome(errno, true));
+      return;
+    }
+    length = 0;
+  }
+  if (length == 0) {
+    int status = parseStatus(client.response);
+    finishRequest(run, client, status == 0 ? OUTCOME_RESET : status < 400 ? OUTCOME_OK : OUTCOME_HTTP_ERROR);
+    return;
+  }
+  client.received += length;
+  if (client.response.size() < LOAD_RESPONSE_MAX) {
+    client.response.append(buffer, min((size_t)length, LOAD_RESPONSE_MAX - client.response.size()));
+  }
+}
+
+static void handleEvent(LoadRun &run, LoadClient &client, short events) {
+  if (client.state == CLIENT_CONNECTING) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+      finishRequest(run, client, socketErrorOutcome(error, false));
+      return;
+    }
+    if (events & POLLOUT) {
+      client.state = CLIENT_SENDING;
+    }
+  }
+  if (client.state == CLIENT_SENDING && (events & (POLLOUT | POLLERR | POLLHUP))) {
+    sendRequest(run, client);
+  } else if (client.state == CLIENT_READING && (events & (POLLIN | POLLERR | POLLHUP))) {
+    readResponse(run, client);
+  }
+}
+
+// Starts what's due, waits for socket events (at most until the next start), handles them
+static void pollClients(LoadRun &run, bool scheduling) {
+  double now = elapsedS(run);
+  double waitS = LOAD_POLL_MAX_MS / 1000.0;
+  for (LoadClient &client : run.clients) {
+    if (client.state == CLIENT_IDLE && scheduling && client.dueS < run.options->durationS) {
+      if (client.dueS <= now) {
+        startRequest(run, client);
+      } else {
+        waitS = min(waitS, client.dueS - now);
+      }
+    }
+    if (client.state != CLIENT_IDLE && now - client.startS >= run.options->timeoutS) {
+      finishRequest(run, client, OUTCOME_TIMEOUT);
+    }
+  }
+
+  std::vector<pollfd> fds;
+  std::vector<LoadClient*> owners;
+  for (LoadClient &client : run.clients) {
+    if (client.state != CLIENT_IDLE) {
+      short events = client.state == CLIENT_READING ? POLLIN : POLLOUT;
+      fds.push_back({client.fd, events, 0});
+      owners.push_back(&client);
+    }
+  }
+  int timeoutMs = (int)ceil(waitS * 1000);
+  if (fds.empty()) {
+    usleep(timeoutMs * 1000);
+    return;
+  }
+  if (poll(fds.data(), fds.size(), timeoutMs) <= 0) {
+    return;
+  }
+  for (size_t i = 0; i < fds.size(); i++) {
+    if (fds[i].revents) {
+      handleEvent(run, *owners[i], fds[i].revents);
+    }
+  }
+}
+
+static bool anyInFlight(const LoadRun &run) {
+  for (const LoadClient &client : run.clients) {
+    if (client.state != CLIENT_IDLE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static double percentile(const std::vector<double> &sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (size_t)ceil(fraction * sorted.size());
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void printResultRow(const char* name, const RouteResult &result) {
+  std::vector<double> sorted = result.latencyMs;
+  std::sort(sorted.begin(), sorted.end());
+  unsigned long sent = 0;
+  for (int i = 0; i < OUTCOME_COUNT; i++) {
+    sent += result.outcomes[i];
+  }
+  printf("%-28s %7lu %7lu %6lu %7lu %6lu %7lu %8.1f %8.1f %8.1f %8.1f\n", name, sent, result.outcomes[OUTCOME_OK],
+         result.outcomes[OUTCOME_HTTP_ERROR], result.outcomes[OUTCOME_CONNECT], result.outcomes[OUTCOME_RESET],
+         result.outcomes[OUTCOME_TIMEOUT], percentile(sorted, 0.5), percentile(sorted, 0.95),
+         percentile(sorted, 0.99), sorted.empty() ? 0 : sorted.back());
+}
+
+static void printHeap(const LoadRun &run) {
+  if (run.heap.empty()) {
+    printf("Heap: no samples (heap=0, or GET /diagnostics failed)\n");
+    return;
+  }
+  const HeapPoint &first = run.heap.front();
+  const HeapPoint &last = run.heap.back();
+  if (last.freeBytes == 0) {
+    printf("Heap: not reported by the target (host build), %lu requests served\n", last.requests - first.requests);
+    return;
+  }
+  unsigned long lowestFree = first.freeBytes;
+  unsigned long lowestBlock = first.largestBlockBytes;
+  for (const HeapPoint &point : run.heap) {
+    lowestFree = min(lowestFree, point.freeBytes);
+    lowestBlock = min(lowestBlock, point.largestBlockBytes);
+  }
+  printf("Heap free:          start %lu, lowest %lu, end %lu bytes (lowest since boot %lu)\n", first.freeBytes,
+         lowestFree, last.freeBytes, last.minFreeBytes);
+  printf("Heap largest block: start %lu, lowest %lu, end %lu bytes\n", first.largestBlockBytes, lowestBlock,
+         last.largestBlockBytes);
+  printf("Fragmentation:      start %.3f, end %.3f (%zu samples, %lu requests served)\n",
+         1.0 - (double)first.largestBlockBytes / first.freeBytes, 1.0 - (double)last.largestBlockBytes / last.freeBytes,
+         run.heap.size(), last.requests - first.requests);
+}
+
+static bool writeHeapCsv(const LoadRun &run, const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  fprintf(file, "time_s,free_bytes,min_free_bytes,largest_block_bytes,target_requests,completed\n");
+  for (const HeapPoint &point : run.heap) {
+    fprintf(file, "%.3f,%lu,%lu,%lu,%lu,%lu\n", point.atS, point.freeBytes, point.minFreeBytes,
+            point.largestBlockBytes, point.requests, point.completed);
+  }
+  fclose(file);
+  return true;
+}
+
+int runLoadTest(const LoadOptions &options) {
+  LoadRun run = {};
+  run.options = &options;
+  run.routes = options.routes;
+  if (run.routes.empty()) {
+    run.routes.assign(dashboardRoutes, dashboardRoutes + sizeof(dashboardRoutes) / sizeof(dashboardRoutes[0]));
+  }
+  for (const LoadRoute &route : run.routes) {
+    run.totalWeight += route.weight;
+  }
+  run.results.resize(run.routes.size());
+  run.random.seed(LOAD_SEED);
+  if (!resolveTarget(run)) {
+    return 1;
+  }
+
+  // Start times spread evenly over one interval, as tabs opened at different moments
+  run.clients.resize(options.clients);
+  for (unsigned i = 0; i < options.clients; i++) {
+    run.clients[i].dueS = (double)i / options.clients / options.rate;
+  }
+  if (options.heapIntervalS > 0) {
+    LoadClient monitor;
+    monitor.monitor = true;
+    run.clients.push_back(monitor);
+  }
+
+  signal(SIGINT, requestStop);
+  signal(SIGPIPE, SIG_IGN);
+  printf("Load on %s:%u: %u clients x %.2f req/s for %.0f s\n", options.host.c_str(), options.port,
+         options.clients, options.rate, options.durationS);
+  run.start = std::chrono::steady_clock::now();
+  while (!stopRequested && elapsedS(run) < options.durationS) {
+    pollClients(run, true);
+  }
+  double loadS = min(elapsedS(run), (double)options.durationS);
+  while (anyInFlight(run)) {
+    pollClients(run, false);
+  }
+  for (unsigned i = 0; i < options.clients; i++) {
+    for (double dueS = run.clients[i].dueS; dueS < loadS; dueS += 1 / options.rate) {
+      run.behind++;
+    }
+  }
+  // Once more after the load, to see what the heap returns to
+  if (options.heapIntervalS > 0) {
+    LoadClient &monitor = run.clients.back();
+    monitor.dueS = 0;
+    startRequest(run, monitor);
+    while (anyInFlight(run)) {
+      pollClients(run, false);
+    }
+  }
+
+  printf("%-28s %7s %7s %6s %7s %6s %7s %8s %8s %8s %8s\n", "Route", "Sent", "OK", "HTTP", "Connect", "Reset",
+         "Timeout", "p50 ms", "p95 ms", "p99 ms", "max ms");
+  RouteResult total = {};
+  for (size_t i = 0; i < run.routes.size(); i++) {
+    String name = run.routes[i].method + " " + run.routes[i].path;
+    printResultRow(name.c_str(), run.results[i]);
+    for (int outcome = 0; outcome < OUTCOME_COUNT; outcome++) {
+      total.outcomes[outcome] += run.results[i].outcomes[outcome];
+    }
+    total.latencyMs.insert(total.latencyMs.end(), run.results[i].latencyMs.begin(), run.results[i].latencyMs.end());
+  }
+  printResultRow("Total", total);
+
+  unsigned long sent = 0;
+  for (int i = 0; i < OUTCOME_COUNT; i++) {
+    sent += total.outcomes[i];
+  }
+  unsigned long failed = sent - total.outcomes[OUTCOME_OK];
+  printf("\nThroughput: %.1f req/s OK (%.1f offered), errors %.2f%%, resets %.2f%%, %lu requests behind schedule\n",
+         total.outcomes[OUTCOME_OK] / loadS, options.clients * options.rate,
+         sent ? 100.0 * failed / sent : 0, sent ? 100.0 * total.outcomes[OUTCOME_RESET] / sent : 0, run.behind);
+  printHeap(run);
+  if (options.heapCsv.length() > 0 && !writeHeapCsv(run, options.heapCsv.c_str())) {
+    return 1;
+  }
+  return failed > 0 ? 2 : 0;
+}
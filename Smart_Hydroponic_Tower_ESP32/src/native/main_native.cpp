@@ -0,0 +1,104 @@
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#include "fake_hardware.h"
+#include "sensors.h"
+#include "pump_control.h"
+#include "data_logger.h"
+#include "sensor_scheduler.h"
+#include "adc_sampler.h"
+#include "api_json.h"
+#include "trace_replay.h"
+#include "plant_sim.h"
+#include "micro_bench.h"
+#include "tower_sim.h"
+#include "load_test.h"
+
+#define controlTicks (1000 / SCHEDULER_TICK_MS) // Control runs once per second, as on the device
+
+// Runs the firmware core on the fake clock: same tick order as the timer interrupt,
+// acquisition task and loop on the ESP32.
+// Usage: program [simulated seconds]
+//        program replay <trace.csv|trace.json> [hold seconds, 0 = every tick]
+//        program plant [name=value ...]
+//        program bench [name filter] [--json]
+//        program tower [port=8080] [speed=1] [quiet=1] [plant name=value ...]
+//        program load <host[:port]> [clients=4] [rate=3] [duration=30] [routes=...] [heap=2] [csv=file]
+int main(int argc, char **argv) {
+  if (argc > 2 && strcmp(argv[1], "replay") == 0) {
+    std::vector<TraceRow> rows;
+    if (!loadTrace(argv[2], rows)) {
+      return 1;
+    }
+    ReplayOptions options = {argc > 3 ? strtoul(argv[3], NULL, 10) : REPLAY_HOLD_DEFAULT_S};
+    return runReplay(rows, options);
+  }
+  if (argc > 1 && strcmp(argv[1], "plant") == 0) {
+    PlantParams params = defaultPlantParams();
+    for (int i = 2; i < argc; i++) {
+      if (!parsePlantParam(params, argv[i])) {
+        return 1;
+      }
+    }
+    return runPlantSimulation(params);
+  }
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    const char* filter = NULL;
+    bool json = false;
+    for (int i = 2; i < argc; i++) {
+      if (strcmp(argv[i], "--json") == 0) {
+        json = true;
+      } else {
+        filter = argv[i];
+      }
+    }
+    return runBenchmarks(filter, json);
+  }
+  if (argc > 1 && strcmp(argv[1], "tower") == 0) {
+    TowerOptions options = defaultTowerOptions();
+    for (int i = 2; i < argc; i++) {
+      if (!parseTowerOption(options, argv[i])) {
+        return 1;
+      }
+    }
+    return runTowerSimulation(options);
+  }
+  if (argc > 2 && strcmp(argv[1], "load") == 0) {
+    LoadOptions options = defaultLoadOptions();
+    for (int i = 2; i < argc; i++) {
+      if (!parseLoadOption(options, argv[i])) {
+        return 1;
+      }
+    }
+    return runLoadTest(options);
+  }
+
+  unsigned long seconds = argc > 1 ? strtoul(argv[1], NULL, 10) : 60;
+
+  fakeSetWaterPresent(true);
+  fakeSetAnalog(waterPHPin, 1310); // ~pH 6.2 with the default calibration
+  fakeSetAnalog(waterECPin, 285);  // ~1.5 mS/cm
+
+  initSensors();
+  initPump();
+  initDataLogger();
+
+  unsigned long ticks = seconds * controlTicks;
+  for (unsigned long tick = 1; tick <= ticks; tick++) {
+    fakeAdvanceMillis(SCHEDULER_TICK_MS);
+    updateSensorValues();
+    if (tick % controlTicks == 0) {
+      getSensorSnapshot(currentSensors);
+      updatePumpControl();
+      updatePHControl();
+      updatePreviousValues();
+    }
+    logSensorDataToCloud();
+  }
+
+  Serial.println(getSensorDataJSON());
+  Serial.println(getSchedulerJSON());
+  Serial.println(getSensorHealthJSON());
+  Serial.printf("Pump: %s, uploads: %lu\n", getPumpStatusString().c_str(), fakeGetHttpPostCount());
+  return 0;
+}
+#endif
@@ -0,0 +1,285 @@
+#include "micro_bench.h"
+#include "fake_hardware.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "sensors.h"
+#include "pump_control.h"
+#include "data_logger.h"
+#include "sensor_scheduler.h"
+#include "sensor_status.h"
+#include "display.h"
+#include "api_json.h"
+#include "filters.h"
+
+// Allocation counting: glibc lets the program replace malloc, which also sees operator new
+// (std::string behind the String shim) and ArduinoJson's DynamicJsonDocument pool
+static bool countingAllocations = false;
+static unsigned long long allocationCount = 0;
+static unsigned long long allocatedBytes = 0;
+
+#if defined(__GLIBC__)
+#define BENCH_COUNTS_ALLOCATIONS 1
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) noexcept {
+  if (countingAllocations) {
+    allocationCount++;
+    allocatedBytes += size;
+  }
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  if (countingAllocations) {
+    allocationCount++;
+    allocatedBytes += count * size;
+  }
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  if (countingAllocations) {
+    allocationCount++;
+    allocatedBytes += size;
+  }
+  return __libc_realloc(ptr, size);
+}
+}
+#else
+#define BENCH_COUNTS_ALLOCATIONS 0  // Reported as n/a
+#endif
+
+// Keeps a result alive so the compiler can't drop the call that produced it
+template <typename T>
+static inline void keep(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// One operation per benchmark, looped without an indirect call per iteration
+static void benchSensorDataJSON() {
+  String json = getSensorDataJSON();
+  keep(json.length());
+}
+
+static void benchLoggerJSON() {
+  String json = createJsonFromSensorData(currentSensors);
+  keep(json.length());
+}
+
+static void benchPumpStatusString() {
+  String status = getPumpStatusString();
+  keep(status.length());
+}
+
+static void benchPHControlStatus() {
+  String status = getPHControlStatus();
+  keep(status.length());
+}
+
+static void benchPHMovingAverage() {
+  static float reading = 6.0;
+  reading = reading > 6.5 ? 5.9 : reading + 0.01f;
+  keep(calculatePHMovingAverage(reading));
+}
+
+// Filters from filters.h on a noisy pH-like stream with a spike every 64 samples, one sample per op
+#define FILTER_INPUT_SIZE 1024
+static float filterInput[FILTER_INPUT_SIZE];
+
+static void prepareFilterInput() {
+  uint32_t state = 1;
+  for (int i = 0; i < FILTER_INPUT_SIZE; i++) {
+    state = state * 1664525u + 1013904223u;
+    filterInput[i] = 6.0f + ((state >> 8) / 8388608.0f - 1.0f) * 0.05f + (i % 64 == 63 ? 2.0f : 0.0f);
+  }
+}
+
+template <typename Filter>
+static void benchFilter() {
+  static Filter filter;
+  static unsigned int next = 0;
+  keep(filter.update(filterInput[next++ % FILTER_INPUT_SIZE]));
+}
+
+static void benchIntMovingAverage() {
+  static MovingAverage<10, int32_t> filter;
+  static unsigned int next = 0;
+  keep(filter.update((int32_t)(filterInput[next++ % FILTER_INPUT_SIZE] * 1000)));
+}
+
+static void benchStatusLevel() {
+  keep(getStatusLevel(currentSensors.waterPH, 5.5, 6.5, 5, 7, 4, 8));
+}
+
+static void benchEvaluateStatus() {
+  SensorStatus status;
+  evaluateSensorStatus(currentSensors, false, status);
+  keep(status.overall);
+}
+
+static void benchStatusColor() {
+  static uint8_t level = 0;
+  level = (level + 1) % (STATUS_INVALID + 1);
+  keep(getStatusColor(level));
+}
+
+static void benchDrawSensorStatus() {
+  drawSensorStatus();
+}
+
+static void benchAcquisitionTick() {
+  fakeAdvanceMillis(SCHEDULER_TICK_MS);
+  updateSensorValues();
+}
+
+static void benchControlTick() {
+  getSensorSnapshot(currentSensors);
+  updatePumpControl();
+  updatePHControl();
+}
+
+template <void (*Operation)()>
+static void loop(unsigned long iterations) {
+  for (unsigned long i = 0; i < iterations; i++) {
+    Operation();
+  }
+}
+
+struct Benchmark {
+  const char* name;
+  void (*run)(unsigned long iterations);
+};
+
+static const Benchmark benchmarks[] = {
+  {"getSensorDataJSON", loop<benchSensorDataJSON>},
+  {"createJsonFromSensorData", loop<benchLoggerJSON>},
+  {"getPumpStatusString", loop<benchPumpStatusString>},
+  {"getPHControlStatus", loop<benchPHControlStatus>},
+  {"calculatePHMovingAverage", loop<benchPHMovingAverage>},
+  {"MovingAverage<10>", loop<benchFilter<MovingAverage<10>>>},
+  {"MovingAverage<10,int32>", loop<benchIntMovingAverage>},
+  {"MedianFilter<7>", loop<benchFilter<MedianFilter<7>>>},
+  {"MedianFilter<31>", loop<benchFilter<MedianFilter<31>>>},
+  {"ExponentialFilter<1,8>", loop<benchFilter<ExponentialFilter<1, 8>>>},
+  {"HampelFilter<7>", loop<benchFilter<HampelFilter<7>>>},
+  {"KalmanFilter1D<10,500>", loop<benchFilter<KalmanFilter1D<10, 500>>>},
+  {"FilterChain<Hampel,Kalman>", loop<benchFilter<FilterChain<HampelFilter<7>, KalmanFilter1D<10, 500>>>>},
+  {"getStatusLevel", loop<benchStatusLevel>},
+  {"evaluateSensorStatus", loop<benchEvaluateStatus>},
+  {"getStatusColor", loop<benchStatusColor>},
+  {"drawSensorStatus", loop<benchDrawSensorStatus>},
+  {"acquisitionTick", loop<benchAcquisitionTick>},   // updateSensorValues() every 50ms
+  {"controlTick", loop<benchControlTick>},           // Snapshot + pump + pH control every second
+};
+
+struct BenchResult {
+  const char* name;
+  unsigned long iterations;  // Per repetition
+  double minNs;              // ns/op
+  double medianNs;
+  double allocsPerOp;
+  double bytesPerOp;
+};
+
+static double runTimed(const Benchmark &bench, unsigned long iterations) {
+  auto start = std::chrono::steady_clock::now();
+  bench.run(iterations);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult measure(const Benchmark &bench) {
+  // Grow the iteration count until one run is long enough to time reliably
+  unsigned long iterations = 1;
+  double elapsedNs = runTimed(bench, iterations);
+  while (elapsedNs < BENCH_MIN_TIME_MS * 1e6 / 10) {
+    iterations *= 10;
+    elapsedNs = runTimed(bench, iterations);
+  }
+  iterations = max(iterations, (unsigned long)(iterations * (BENCH_MIN_TIME_MS * 1e6 / elapsedNs)));
+
+  std::vector<double> nsPerOp;
+  allocationCount = 0;
+  allocatedBytes = 0;
+  countingAllocations = true;
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    nsPerOp.push_back(runTimed(bench, iterations) / iterations);
+  }
+  countingAllocations = false;
+  std::sort(nsPerOp.begin(), nsPerOp.end());
+
+  double ops = (double)iterations * BENCH_REPETITIONS;
+  BenchResult result = {bench.name, iterations, nsPerOp.front(), nsPerOp[nsPerOp.size() / 2],
+                        allocationCount / ops, allocatedBytes / ops};
+  return result;
+}
+
+// Steady state the benchmarks start from: all sensors valid and in range, filters full
+static void prepareFirmware() {
+  fakeSetWaterPresent(true);
+  fakeSetWaterTemps(20.5, 20.8, 20.6);
+  fakeSetDHT(24, 60);
+  fakeSetCO2(800);
+  fakeSetLight(12000);
+  fakeSetPH(6.1);
+  fakeSetEC(1.1, 20.5);
+
+  initSensors();
+  initPump();
+  initDataLogger();
+  initDisplay();
+  for (int tick = 1; tick <= 60 * 1000 / SCHEDULER_TICK_MS; tick++) {
+    fakeAdvanceMillis(SCHEDULER_TICK_MS);
+    updateSensorValues();
+  }
+  getSensorSnapshot(currentSensors);
+  updatePreviousValues();
+  prepareFilterInput();
+}
+
+int runBenchmarks(const char* filter, bool json) {
+  Serial.muted = true; // Pump/pH control logs every switch
+  prepareFirmware();
+
+  std::vector<BenchResult> results;
+  for (const Benchmark &bench : benchmarks) {
+    if (!filter || strstr(bench.name, filter)) {
+      results.push_back(measure(bench));
+    }
+  }
+  Serial.muted = false;
+  if (results.empty()) {
+    fprintf(stderr, "No benchmark matches %s\n", filter);
+    return 1;
+  }
+
+  if (json) {
+    printf("[");
+    for (size_t i = 0; i < results.size(); i++) {
+      const BenchResult &r = results[i];
+      printf("%s\n  {\"name\":\"%s\",\"iterations\":%lu,\"nsPerOpMin\":%.1f,\"nsPerOpMedian\":%.1f", i ? "," : "",
+             r.name, r.iterations, r.minNs, r.medianNs);
+      if (BENCH_COUNTS_ALLOCATIONS) {
+        printf(",\"allocsPerOp\":%.2f,\"bytesPerOp\":%.1f", r.allocsPerOp, r.bytesPerOp);
+      }
+      printf("}");
+    }
+    printf("\n]\n");
+    return 0;
+  }
+
+  printf("%-26s %12s %12s %12s %10s %10s\n", "Benchmark", "Iterations", "ns/op min", "ns/op med", "allocs/op", "bytes/op");
+  for (const BenchResult &r : results) {
+    printf("%-26s %12lu %12.1f %12.1f", r.name, r.iterations, r.minNs, r.medianNs);
+    if (BENCH_COUNTS_ALLOCATIONS) {
+      printf(" %10.2f %10.1f\n", r.allocsPerOp, r.bytesPerOp);
+    } else {
+      printf(" %10s %10s\n", "n/a", "n/a");
+    }
+  }
+  return 0;
+}
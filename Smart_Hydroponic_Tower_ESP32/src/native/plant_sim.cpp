@@ -0,0 +1,232 @@
+#include "plant_sim.h"
+#include "fake_hardware.h"
+#include <chrono>
+#include <stddef.h>
+#include "sensors.h"
+#include "pump_control.h"
+#include "sensor_scheduler.h"
+
+#define PLANT_CONTROL_TICKS (1000 / SCHEDULER_TICK_MS)  // Control once per second, as on the device
+#define PLANT_CSV_TICKS (10000 / SCHEDULER_TICK_MS)     // Trajectory row every 10 simulated seconds
+
+// Command line names of the float parameters
+struct PlantParamName {
+  const char* name;
+  size_t offset;  // Into PlantParams
+};
+
+static const PlantParamName paramNames[] = {
+  {"volume", offsetof(PlantParams, volumeL)},
+  {"buffer", offsetof(PlantParams, bufferMmolPerLPH)},
+  {"acid", offsetof(PlantParams, acidMolPerL)},
+  {"base", offsetof(PlantParams, baseMolPerL)},
+  {"flow", offsetof(PlantParams, doseMlPerS)},
+  {"delay", offsetof(PlantParams, transportDelayS)},
+  {"mixOn", offsetof(PlantParams, mixTauPumpOnS)},
+  {"mixOff", offsetof(PlantParams, mixTauPumpOffS)},
+  {"probeTau", offsetof(PlantParams, probeTauS)},
+  {"noise", offsetof(PlantParams, noisePH)},
+  {"drift", offsetof(PlantParams, driftPHPerHour)},
+  {"start", offsetof(PlantParams, startPH)},
+  {"target", offsetof(PlantParams, target)},
+  {"tolerance", offsetof(PlantParams, tolerance)},
+  {"hours", offsetof(PlantParams, hours)},
+};
+
+PlantParams defaultPlantParams() {
+  PlantParams params = {};
+  params.volumeL = 100;
+  params.bufferMmolPerLPH = 2.0;   // Typical nutrient solution
+  params.acidMolPerL = 0.5;
+  params.baseMolPerL = 0.5;
+  params.doseMlPerS = 1.0;         // ~60ml/min peristaltic pump
+  params.transportDelayS = 20;
+  params.mixTauPumpOnS = 60;
+  params.mixTauPumpOffS = 600;
+  params.probeTauS = 15;
+  params.noisePH = 0.02;
+  params.driftPHPerHour = 0.02;
+  params.startPH = 7.5;
+  params.hours = 24;
+  params.seed = 1;
+  return params;
+}
+
+bool parsePlantParam(PlantParams &params, const char* arg) {
+  const char* value = strchr(arg, '=');
+  if (!value) {
+    return false;
+  }
+  String name = String(arg).substring(0, value - arg);
+  value++;
+  if (name == "seed") {
+    params.seed = strtoul(value, NULL, 10);
+    return true;
+  }
+  if (name == "csv") {
+    params.csvPath = value;
+    return true;
+  }
+  for (const PlantParamName &param : paramNames) {
+    if (name == param.name) {
+      *(float*)((uint8_t*)&params + param.offset) = strtof(value, NULL);
+      return true;
+    }
+  }
+  fprintf(stderr, "Unknown parameter %s, known:", name.c_str());
+  for (const PlantParamName &param : paramNames) {
+    fprintf(stderr, " %s", param.name);
+  }
+  fprintf(stderr, " seed csv\n");
+  return false;
+}
+
+void initPlantModel(PlantModel &model, const PlantParams &params) {
+  const float dt = SCHEDULER_TICK_MS / 1000.0f;
+  model.params = params;
+  model.ph = params.startPH;
+  model.probePH = params.startPH;
+  model.line.assign(max(1, (int)lroundf(params.transportDelayS / dt)), 0.0f);
+  model.lineHead = 0;
+  model.unmixedMmol = 0;
+  model.random.seed(params.seed);
+  model.noise = std::normal_distribution<float>(0, params.noisePH > 0 ? params.noisePH : 1e-9f);
+
+  fakeSetWaterPresent(true);
+  fakeSetEC(1.5, 21);
+  fakeSetPH(model.probePH);
+}
+
+void stepPlantModel(PlantModel &model) {
+  const float dt = SCHEDULER_TICK_MS / 1000.0f;
+  const PlantParams &params = model.params;
+  bool downOn = fakeGetPin(phDownPumpPin) == HIGH;
+  bool upOn = fakeGetPin(phUpPumpPin) == HIGH;
+  bool circulating = fakeGetPin(waterPumpPin) == HIGH;
+  float doseMl = params.doseMlPerS * dt;
+
+  model.unmixedMmol += model.line[model.lineHead]; // Leaves the line after the transport delay
+  model.line[model.lineHead] = (downOn ? doseMl * params.acidMolPerL : 0) - (upOn ? doseMl * params.baseMolPerL : 0);
+  model.lineHead = (model.lineHead + 1) % model.line.size();
+
+  float tau = circulating ? params.mixTauPumpOnS : params.mixTauPumpOffS;
+  float mixedMmol = model.unmixedMmol * (1 - expf(-dt / max(tau, dt)));
+  model.unmixedMmol -= mixedMmol;
+  model.ph -= mixedMmol / (params.bufferMmolPerLPH * params.volumeL);
+  model.ph += params.driftPHPerHour * dt / 3600;
+  model.ph = min(max(model.ph, 0.0f), 14.0f);
+
+  model.probePH += (model.ph - model.probePH) * (1 - expf(-dt / max(params.probeTauS, dt)));
+  fakeSetPH(model.probePH + model.noise(model.random));
+}
+
+// Rising edges of one output
+struct EdgeCounter {
+  bool last;
+  unsigned long count;
+  bool update(bool level) {
+    bool rising = level && !last;
+    count += rising;
+    last = level;
+    return rising;
+  }
+};
+
+int runPlantSimulation(const PlantParams &params) {
+  const float dt = SCHEDULER_TICK_MS / 1000.0f;
+  FILE *csv = NULL;
+  if (params.csvPath) {
+    csv = fopen(params.csvPath, "w");
+    if (!csv) {
+      fprintf(stderr, "Can't write %s\n", params.csvPath);
+      return 1;
+    }
+    fprintf(csv, "time_s,ph,probe_ph,firmware_ph,ph_up,ph_down,pump\n");
+  }
+
+  PlantModel model;
+  initPlantModel(model, params);
+  const float &ph = model.ph;
+  Serial.muted = true; // Every dose is logged, the run would be I/O bound
+  initSensors();
+  initPump();
+  PHConfig config = getPHConfig();
+  if (params.target > 0) config.target = params.target;
+  if (params.tolerance > 0) config.tolerance = params.tolerance;
+  setPHTarget(config.target, config.tolerance);
+
+  // Metrics on the true (bulk) pH
+  float initialError = params.startPH - config.target;
+  float direction = initialError >= 0 ? 1 : -1;
+  float overshoot = 0, minPH = ph, maxPH = ph, iae = 0;
+  double lastOutsideS = -1, timeInBandS = 0;
+  float acidMl = 0, baseMl = 0;
+  EdgeCounter phDownDoses = {}, phUpDoses = {}, pumpCycles = {};
+
+  unsigned long long ticks = (unsigned long long)(params.hours * 3600 / dt);
+  auto wallStart = std::chrono::steady_clock::now();
+  for (unsigned long long tick = 1; tick <= ticks; tick++) {
+    double timeS = tick * (double)dt;
+
+    // Firmware: same tick order as the acquisition task and the loop
+    fakeAdvanceMillis(SCHEDULER_TICK_MS);
+    updateSensorValues();
+    if (tick % PLANT_CONTROL_TICKS == 0) {
+      getSensorSnapshot(currentSensors);
+      updatePumpControl();
+      updatePHControl();
+    }
+
+    // Plant: doses while the pump outputs are high
+    stepPlantModel(model);
+    bool downOn = fakeGetPin(phDownPumpPin) == HIGH;
+    bool upOn = fakeGetPin(phUpPumpPin) == HIGH;
+    bool circulating = fakeGetPin(waterPumpPin) == HIGH;
+    phDownDoses.update(downOn);
+    phUpDoses.update(upOn);
+    pumpCycles.update(circulating);
+    float doseMl = params.doseMlPerS * dt;
+    acidMl += downOn ? doseMl : 0;
+    baseMl += upOn ? doseMl : 0;
+
+    float error = ph - config.target;
+    overshoot = max(overshoot, -direction * error);
+    minPH = min(minPH, ph);
+    maxPH = max(maxPH, ph);
+    iae += fabsf(error) * dt / 3600;
+    if (fabsf(error) > config.tolerance) {
+      lastOutsideS = timeS;
+    } else {
+      timeInBandS += dt;
+    }
+
+    if (csv && tick % PLANT_CSV_TICKS == 0) {
+      fprintf(csv, "%.0f,%.4f,%.4f,%.4f,%d,%d,%d\n", timeS, ph, model.probePH, currentSensors.waterPH, upOn, downOn, circulating);
+    }
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double simulatedS = ticks * (double)dt;
+  Serial.muted = false;
+  if (csv) {
+    fclose(csv);
+  }
+
+  printf("Simulated %.1f h in %.2f s (%.0fx real time)\n", simulatedS / 3600, wallS, simulatedS / wallS);
+  printf("Plant: %.0f L, buffer %.2f mmol/L/pH, dose %.2f ml/s at %.2f/%.2f mol/L, delay %.0f s, mix %.0f/%.0f s, probe %.0f s +-%.3f, drift %.3f pH/h\n",
+         params.volumeL, params.bufferMmolPerLPH, params.doseMlPerS, params.acidMolPerL, params.baseMolPerL,
+         params.transportDelayS, params.mixTauPumpOnS, params.mixTauPumpOffS, params.probeTauS, params.noisePH,
+         params.driftPHPerHour);
+  printf("Control: target %.2f +-%.2f, start %.2f, final %.2f, range %.2f-%.2f\n",
+         config.target, config.tolerance, params.startPH, ph, minPH, maxPH);
+  if (fabsf(ph - config.target) > config.tolerance) {
+    printf("Settling time: not settled\n");
+  } else {
+    printf("Settling time: %.0f s\n", lastOutsideS < 0 ? 0.0 : lastOutsideS);
+  }
+  printf("Overshoot: %.3f pH (%.0f%% of the initial error)\n", overshoot,
+         fabsf(initialError) > 0 ? overshoot * 100 / fabsf(initialError) : 0);
+  printf("In band: %.1f%%, IAE: %.3f pH*h\n", timeInBandS * 100 / simulatedS, iae);
+  printf("Doses: %lu down (%.0f ml), %lu up (%.0f ml), circulation pump cycles: %lu\n",
+         phDownDoses.count, acidMl, phUpDoses.count, baseMl, pumpCycles.count);
+  return 0;
+}
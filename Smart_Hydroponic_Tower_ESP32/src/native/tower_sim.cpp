@@ -0,0 +1,115 @@
+#include "tower_sim.h"
+#include "fake_hardware.h"
+#include <chrono>
+#include <signal.h>
+#include "sensors.h"
+#include "pump_control.h"
+#include "data_logger.h"
+#include "sensor_scheduler.h"
+#include "wifi_server.h"
+#include "self_bench.h"
+#include "heap_monitor.h"
+#include "metrics.h"
+
+#define TOWER_CONTROL_TICKS (1000 / SCHEDULER_TICK_MS)  // Control once per second, as on the device
+#define TOWER_CATCH_UP_TICKS 200                        // Ticks run back to back before the server is polled again
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int signal) {
+  stopRequested = 1;
+}
+
+TowerOptions defaultTowerOptions() {
+  TowerOptions options = {};
+  options.port = TOWER_PORT_DEFAULT;
+  options.speed = 1;
+  options.plant = defaultPlantParams();
+  options.plant.startPH = 6.2;
+  return options;
+}
+
+bool parseTowerOption(TowerOptions &options, const char* arg) {
+  if (strncmp(arg, "port=", 5) == 0) {
+    options.port = strtoul(arg + 5, NULL, 10);
+    return options.port > 0;
+  }
+  if (strncmp(arg, "speed=", 6) == 0) {
+    options.speed = strtof(arg + 6, NULL);
+    return options.speed > 0;
+  }
+  if (strncmp(arg, "quiet=", 6) == 0) {
+    options.quiet = strtoul(arg + 6, NULL, 10) != 0;
+    return true;
+  }
+  return parsePlantParam(options.plant, arg);
+}
+
+// Grow light, air, CO2 and water temperature follow the simulated day (after initSensors(),
+// the EC code depends on the calibration)
+static void updateAmbient(double timeS) {
+  double hourOfDay = fmod(timeS / 3600, 24);
+  bool lightOn = hourOfDay < TOWER_PHOTOPERIOD_H;
+  float warmth = sinf((float)(hourOfDay / 24 * 2 * M_PI));
+  fakeSetLight(lightOn ? 12000 : 0);
+  fakeSetDHT(23 + 2 * warmth, 60 - 8 * warmth);
+  fakeSetCO2(lightOn ? 650 : 900);   // Plants draw CO2 down under the light
+  fakeSetWaterTemps(20.5 + warmth, 21 + warmth, 20.8 + warmth);
+  fakeSetEC(1.5, 20.5 + warmth);
+}
+
+int runTowerSimulation(const TowerOptions &options) {
+  signal(SIGINT, requestStop);
+  signal(SIGTERM, requestStop);
+  signal(SIGPIPE, SIG_IGN);
+
+  PlantModel plant;
+  initPlantModel(plant, options.plant);
+  Serial.muted = options.quiet;
+  initSensors();
+  updateAmbient(0);
+  initPump();
+  initDataLogger();
+  fakeServerSetPort(options.port);
+  initWiFi();
+  fprintf(stderr, "Tower on port %u at %gx real time\n", options.port, options.speed);
+
+  // Ticks are due on the wall clock scaled by the speed, requests are answered in between
+  auto wallStart = std::chrono::steady_clock::now();
+  double tickWallS = SCHEDULER_TICK_MS / 1000.0 / options.speed;
+  unsigned long long tick = 0;
+  while (!stopRequested) {
+    double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double untilTickS = (tick + 1) * tickWallS - elapsedS;
+    if (untilTickS > 0) {
+      fakeServerPoll((int)ceil(untilTickS * 1000));
+      continue;
+    }
+
+    for (int i = 0; i < TOWER_CATCH_UP_TICKS && untilTickS <= 0; i++, untilTickS += tickWallS) {
+      tick++;
+      fakeAdvanceMillis(SCHEDULER_TICK_MS);
+      updateSensorValues();
+      updateActuatorMetrics();
+      stepPlantModel(plant);
+      if (tick % TOWER_CONTROL_TICKS == 0) {
+        updateAmbient(tick * SCHEDULER_TICK_MS / 1000.0);
+        getSensorSnapshot(currentSensors);
+        updatePumpControl();
+        updatePHControl();
+        updatePreviousValues();
+        sampleHeap();
+        updateLiveState();
+      }
+      logSensorDataToCloud();
+      serviceSelfBench();
+      handleWebServer();
+    }
+    fakeServerPoll(0);
+  }
+
+  Serial.muted = false;
+  fprintf(stderr, "Tower on port %u stopped after %.0f simulated s, %lu requests, %lu connections reset\n",
+          options.port, tick * SCHEDULER_TICK_MS / 1000.0, fakeGetServerRequestCount(), fakeGetServerRejectedCount());
+  return 0;
+}
@@ -0,0 +1,378 @@
+#include "trace_replay.h"
+#include "fake_hardware.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stddef.h>
+#include "sensor_status.h"
+#include "pump_control.h"
+#include "data_logger.h"
+#include "sensor_scheduler.h"
+#include "sensor_health.h"
+#include "water_level.h"
+#include "water_temp.h"
+#include "adc_sampler.h"
+#include "api_json.h"
+
+#define REPLAY_CONTROL_TICKS (1000 / SCHEDULER_TICK_MS)  // Control, status and JSON once per second, as on the device
+#define STAGE_BUCKET_NS 10                               // Latency histogram resolution
+#define STAGE_BUCKETS 20000                              // Up to 200us, slower calls only count towards max
+
+// sensor_data columns carried as floats
+struct TraceColumn {
+  const char* name;
+  uint16_t validBit;
+  size_t offset;  // Into SensorData
+};
+
+static const TraceColumn columns[] = {
+  {"co2_level", SENSOR_VALID_CO2, offsetof(SensorData, co2Level)},
+  {"ph_level", SENSOR_VALID_PH, offsetof(SensorData, waterPH)},
+  {"ec_level", SENSOR_VALID_EC, offsetof(SensorData, waterEC)},
+  {"water_temp", SENSOR_VALID_WATER_TEMP, offsetof(SensorData, waterTemp)},
+  {"water_temp_top", SENSOR_VALID_WATER_TEMP_TOP, offsetof(SensorData, waterTempTop)},
+  {"water_temp_root", SENSOR_VALID_WATER_TEMP_ROOT, offsetof(SensorData, waterTempRoot)},
+  {"env_temp", SENSOR_VALID_ENV_TEMP, offsetof(SensorData, envTemp)},
+  {"humidity", SENSOR_VALID_ENV_HUMIDITY, offsetof(SensorData, envHumidity)},
+  {"light_level", SENSOR_VALID_LIGHT, offsetof(SensorData, lightLevel)},
+};
+#define TRACE_COLUMN_COUNT (sizeof(columns) / sizeof(columns[0]))
+
+static void setColumn(TraceRow &row, const TraceColumn &column, float value) {
+  *(float*)((uint8_t*)&row.data + column.offset) = value;
+  row.data.validMask |= column.validBit;
+}
+
+static TraceRow emptyRow() {
+  TraceRow row = {};
+  row.data.waterLevel = true; // Rows without the column had water
+  return row;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static long daysFromCivil(int year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  long era = (year >= 0 ? year : year - 399) / 400;
+  unsigned yearOfEra = (unsigned)(year - era * 400);
+  unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + (long)dayOfEra - 719468;
+}
+
+// Plain seconds or ISO 8601 ("2025-08-26 14:03:12.123+03", "2025-08-26T14:03:12Z")
+static bool parseTime(const char* text, double &seconds) {
+  int year, month, day, hour, minute, consumed = 0;
+  double second;
+  if (sscanf(text, "%d-%d-%d%*1[T ]%d:%d:%lf%n", &year, &month, &day, &hour, &minute, &second, &consumed) == 6) {
+    seconds = daysFromCivil(year, month, day) * 86400.0 + hour * 3600 + minute * 60 + second;
+    const char* zone = text + consumed;
+    if (*zone == '+' || *zone == '-') {
+      int zoneHours = 0, zoneMinutes = 0;
+      sscanf(zone + 1, "%2d:%2d", &zoneHours, &zoneMinutes);
+      double offset = zoneHours * 3600 + zoneMinutes * 60;
+      seconds += *zone == '+' ? -offset : offset;
+    }
+    return true;
+  }
+  char* end;
+  seconds = strtod(text, &end);
+  return end != text;
+}
+
+static bool isNull(const std::string &text) {
+  return text.empty() || text == "null" || text == "NULL";
+}
+
+static bool parseBool(const std::string &text) {
+  return text == "true" || text == "t" || text == "1" || text == "TRUE";
+}
+
+static std::vector<std::string> splitCSV(const std::string &line) {
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+    } else if (c == ',' && !quoted) {
+      fields.emplace_back();
+    } else if (c != '\r') {
+      fields.back() += c;
+    }
+  }
+  return fields;
+}
+
+static bool loadCSV(std::istream &input, std::vector<TraceRow> &rows) {
+  std::string line;
+  if (!std::getline(input, line)) {
+    return false;
+  }
+  std::vector<std::string> header = splitCSV(line);
+  int columnIndex[TRACE_COLUMN_COUNT];
+  int createdAt = -1, timestamp = -1, waterLevel = -1;
+  for (size_t c = 0; c < TRACE_COLUMN_COUNT; c++) {
+    columnIndex[c] = -1;
+  }
+  for (size_t i = 0; i < header.size(); i++) {
+    if (header[i] == "created_at") createdAt = i;
+    if (header[i] == "timestamp") timestamp = i;
+    if (header[i] == "water_level") waterLevel = i;
+    for (size_t c = 0; c < TRACE_COLUMN_COUNT; c++) {
+      if (header[i] == columns[c].name) columnIndex[c] = i;
+    }
+  }
+  int timeColumn = createdAt >= 0 ? createdAt : timestamp; // timestamp is uptime, resets on reboot
+  if (timeColumn < 0) {
+    fprintf(stderr, "Trace needs a created_at or timestamp column\n");
+    return false;
+  }
+
+  while (std::getline(input, line)) {
+    std::vector<std::string> fields = splitCSV(line);
+    TraceRow row = emptyRow();
+    if ((int)fields.size() <= timeColumn || !parseTime(fields[timeColumn].c_str(), row.timeS)) {
+      continue;
+    }
+    for (size_t c = 0; c < TRACE_COLUMN_COUNT; c++) {
+      if (columnIndex[c] >= 0 && columnIndex[c] < (int)fields.size() && !isNull(fields[columnIndex[c]])) {
+        setColumn(row, columns[c], strtof(fields[columnIndex[c]].c_str(), NULL));
+      }
+    }
+    if (waterLevel >= 0 && waterLevel < (int)fields.size() && !isNull(fields[waterLevel])) {
+      row.data.waterLevel = parseBool(fields[waterLevel]);
+      row.data.validMask |= SENSOR_VALID_WATER_LEVEL;
+    }
+    rows.push_back(row);
+  }
+  return true;
+}
+
+static bool loadJSON(std::string &text, std::vector<TraceRow> &rows) {
+  DynamicJsonDocument doc(text.size() * 2 + 4096); // Zero-copy parse, strings stay in text
+  DeserializationError error = deserializeJson(doc, &text[0]);
+  if (error) {
+    fprintf(stderr, "Trace JSON: %s\n", error.c_str());
+    return false;
+  }
+  for (JsonObject object : doc.as<JsonArray>()) {
+    TraceRow row = emptyRow();
+    const char* createdAt = object["created_at"];
+    if (createdAt ? !parseTime(createdAt, row.timeS) : !object["timestamp"].is<double>()) {
+      continue;
+    }
+    if (!createdAt) {
+      row.timeS = object["timestamp"].as<double>();
+    }
+    for (size_t c = 0; c < TRACE_COLUMN_COUNT; c++) {
+      JsonVariant value = object[columns[c].name];
+      if (!value.isNull()) {
+        setColumn(row, columns[c], value.as<float>());
+      }
+    }
+    if (!object["water_level"].isNull()) {
+      row.data.waterLevel = object["water_level"].as<bool>();
+      row.data.validMask |= SENSOR_VALID_WATER_LEVEL;
+    }
+    rows.push_back(row);
+  }
+  return true;
+}
+
+bool loadTrace(const char* path, std::vector<TraceRow> &rows) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "Can't open %s\n", path);
+    return false;
+  }
+  size_t length = strlen(path);
+  bool loaded;
+  if (length > 5 && strcmp(path + length - 5, ".json") == 0) {
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+    loaded = loadJSON(text, rows);
+  } else {
+    loaded = loadCSV(file, rows);
+  }
+  // Exports are often newest first
+  std::stable_sort(rows.begin(), rows.end(), [](const TraceRow &a, const TraceRow &b) { return a.timeS < b.timeS; });
+  return loaded;
+}
+
+// Drive the fake devices so the next reads return the recorded values
+static void applyRow(const TraceRow &row) {
+  const SensorData &data = row.data;
+  bool reservoir = isSensorValid(data, SENSOR_VALID_WATER_TEMP);
+  bool top = isSensorValid(data, SENSOR_VALID_WATER_TEMP_TOP);
+  bool root = isSensorValid(data, SENSOR_VALID_WATER_TEMP_ROOT);
+  fakeSetSensorFault(SENSOR_WATER_TEMP, !reservoir && !top && !root);
+  fakeSetWaterTemps(reservoir ? data.waterTemp : WATER_TEMP_DISCONNECTED,
+                    top ? data.waterTempTop : WATER_TEMP_DISCONNECTED,
+                    root ? data.waterTempRoot : WATER_TEMP_DISCONNECTED);
+
+  fakeSetSensorFault(SENSOR_CO2, !isSensorValid(data, SENSOR_VALID_CO2));
+  fakeSetCO2(data.co2Level);
+
+  bool envTemp = isSensorValid(data, SENSOR_VALID_ENV_TEMP);
+  bool humidity = isSensorValid(data, SENSOR_VALID_ENV_HUMIDITY);
+  fakeSetSensorFault(SENSOR_DHT, !envTemp && !humidity);
+  fakeSetDHT(envTemp ? data.envTemp : NAN, humidity ? data.envHumidity : NAN);
+
+  fakeSetLight(isSensorValid(data, SENSOR_VALID_LIGHT) ? data.lightLevel : -1);
+
+  // Missing pH/EC rows look like an unplugged probe (ADC at the rail)
+  if (isSensorValid(data, SENSOR_VALID_PH)) {
+    fakeSetPH(data.waterPH);
+  } else {
+    fakeSetAnalog(waterPHPin, 0);
+  }
+  if (isSensorValid(data, SENSOR_VALID_EC)) {
+    fakeSetEC(data.waterEC, reservoir ? data.waterTemp : 25);
+  } else {
+    fakeSetAnalog(waterECPin, 4095);
+  }
+
+  // Nobody is there to clear a dry-run fault, the replay does it once the level is back
+  fakeSetWaterPresent(data.waterLevel);
+  if (data.waterLevel && isWaterLevelFault()) {
+    clearWaterLevelFault();
+  }
+}
+
+// Host-side latency histogram of one pipeline stage
+struct StageStats {
+  const char* name;
+  unsigned long long calls;
+  unsigned long long totalNs;
+  unsigned long long maxNs;
+  std::vector<uint32_t> buckets;
+};
+
+static StageStats makeStage(const char* name) {
+  StageStats stage = {name, 0, 0, 0, std::vector<uint32_t>(STAGE_BUCKETS + 1, 0)};
+  return stage;
+}
+
+static unsigned long long elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void recordStage(StageStats &stage, unsigned long long ns) {
+  stage.calls++;
+  stage.totalNs += ns;
+  stage.maxNs = max(stage.maxNs, ns);
+  stage.buckets[min(ns / STAGE_BUCKET_NS, (unsigned long long)STAGE_BUCKETS)]++;
+}
+
+template <typename Fn>
+static void timeStage(StageStats &stage, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  recordStage(stage, elapsedNs(start));
+}
+
+static double stagePercentileUs(const StageStats &stage, double percentile) {
+  unsigned long long rank = (unsigned long long)ceil(stage.calls * percentile / 100.0);
+  unsigned long long seen = 0;
+  for (size_t i = 0; i < STAGE_BUCKETS; i++) {
+    seen += stage.buckets[i];
+    if (seen >= rank && rank > 0) {
+      return (i + 1) * STAGE_BUCKET_NS / 1000.0;
+    }
+  }
+  return stage.maxNs / 1000.0;
+}
+
+int runReplay(const std::vector<TraceRow> &rows, const ReplayOptions &options) {
+  if (rows.empty()) {
+    fprintf(stderr, "Trace has no rows\n");
+    return 1;
+  }
+
+  fakeSetWaterPresent(true);
+  Serial.muted = true; // Pump and logger messages would dominate the run time
+  initSensors();
+  initPump();
+  initDataLogger();
+
+  StageStats acquisition = makeStage("acquisition"); // Scheduler tick: drivers, filters, health, snapshot
+  StageStats status = makeStage("status");           // Threshold evaluation of the snapshot
+  StageStats control = makeStage("control");         // Pump cycling and pH dosing
+  StageStats json = makeStage("json");               // /sensors body
+  StageStats logger = makeStage("logger");           // Loop calls that uploaded a row
+
+  unsigned long statusTicks[STATUS_INVALID] = {};
+  unsigned long pumpCycles = 0, phUpDoses = 0, phDownDoses = 0;
+  bool pumpWasOn = false, phUpWasOn = false, phDownWasOn = false;
+  unsigned long long tick = 0;
+  unsigned long long virtualStartUs = fakeMicros();
+  auto wallStart = std::chrono::steady_clock::now();
+
+  for (size_t r = 0; r < rows.size(); r++) {
+    applyRow(rows[r]);
+
+    double gapS = r + 1 < rows.size() ? rows[r + 1].timeS - rows[r].timeS : options.holdS;
+    unsigned long long gapMs = (unsigned long long)(min(max(gapS, 0.0), (double)REPLAY_GAP_MAX_S) * 1000);
+    unsigned long long runMs = options.holdS ? min(gapMs, options.holdS * 1000ULL) : gapMs;
+
+    for (unsigned long long ms = 0; ms < runMs; ms += SCHEDULER_TICK_MS) {
+      fakeAdvanceMillis(SCHEDULER_TICK_MS);
+      timeStage(acquisition, [] { updateSensorValues(); });
+
+      if (++tick % REPLAY_CONTROL_TICKS == 0) {
+        getSensorSnapshot(currentSensors);
+        SensorStatus sensorStatus;
+        timeStage(status, [&sensorStatus] { evaluateSensorStatus(currentSensors, isWaterLevelFault(), sensorStatus); });
+        statusTicks[sensorStatus.overall]++;
+        timeStage(control, [] { updatePumpControl(); updatePHControl(); });
+        timeStage(json, [] { getSensorDataJSON(); });
+        updatePreviousValues();
+
+        pumpCycles += getPumpState() && !pumpWasOn;
+        phUpDoses += getPHUpState() && !phUpWasOn;
+        phDownDoses += getPHDownState() && !phDownWasOn;
+        pumpWasOn = getPumpState();
+        phUpWasOn = getPHUpState();
+        phDownWasOn = getPHDownState();
+      }
+
+      unsigned long uploads = fakeGetHttpPostCount();
+      auto start = std::chrono::steady_clock::now();
+      logSensorDataToCloud();
+      if (fakeGetHttpPostCount() != uploads) {
+        recordStage(logger, elapsedNs(start)); // The other calls only compare timestamps
+      }
+    }
+    if (gapMs > runMs) {
+      fakeAdvanceMillis(gapMs - runMs); // Scheduler skips the missed slots, control sees the elapsed time
+    }
+  }
+
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double virtualS = (fakeMicros() - virtualStartUs) / 1e6;
+  Serial.muted = false;
+
+  printf("Replayed %zu rows: %.2f days of virtual time in %.2f s (%.0fx real time, %llu scheduler ticks)\n",
+         rows.size(), virtualS / 86400, wallS, virtualS / wallS, tick);
+  printf("%-12s %10s %10s %10s %10s %10s %12s\n", "stage", "calls", "mean us", "p50 us", "p99 us", "max us", "calls/s");
+  StageStats* stages[] = {&acquisition, &status, &control, &json, &logger};
+  for (StageStats* stage : stages) {
+    if (stage->calls == 0) {
+      printf("%-12s %10llu\n", stage->name, stage->calls);
+      continue;
+    }
+    printf("%-12s %10llu %10.2f %10.2f %10.2f %10.2f %12.0f\n", stage->name, stage->calls,
+           stage->totalNs / 1000.0 / stage->calls, stagePercentileUs(*stage, 50), stagePercentileUs(*stage, 99),
+           stage->maxNs / 1000.0, stage->calls * 1e9 / stage->totalNs);
+  }
+
+  unsigned long statusTotal = max(status.calls, 1ULL);
+  printf("Status: %.1f%% ok, %.1f%% caution, %.1f%% warning, %.1f%% critical\n",
+         statusTicks[STATUS_OK] * 100.0 / statusTotal, statusTicks[STATUS_CAUTION] * 100.0 / statusTotal,
+         statusTicks[STATUS_WARNING] * 100.0 / statusTotal, statusTicks[STATUS_CRITICAL] * 100.0 / statusTotal);
+  printf("Pump cycles: %lu, pH up doses: %lu, pH down doses: %lu, interlock trips: %lu, uploads: %lu\n",
+         pumpCycles, phUpDoses, phDownDoses, getWaterLevelStats().trips, fakeGetHttpPostCount());
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include "pump_control.h"
 #include "sensors.h"
+#include "water_level.h"
+#include "hal.h"
 
 // Pump control variables
 bool pumpState = false;
@@ -39,34 +41,55 @@ PHConfig phConfig = {
 };
 
 void initPump() {
-  ledcSetup(PUMP_PWM_CHANNEL, PUMP_PWM_FREQ, PUMP_PWM_RES);
-  ledcAttachPin(waterPumpPin, PUMP_PWM_CHANNEL);
-  ledcWrite(PUMP_PWM_CHANNEL, 0); // Start with pump off
+  halPwmSetup(PUMP_PWM_CHANNEL, PUMP_PWM_FREQ, PUMP_PWM_RES);
+  halPwmAttach(waterPumpPin, PUMP_PWM_CHANNEL);
+  halPwmWrite(PUMP_PWM_CHANNEL, 0); // Start with pump off
   pumpState = false;
-  pumpLastChange = millis();
+  pumpLastChange = halMillis();
   Serial.println("Pump initialized on pin " + String(waterPumpPin));
   Serial.printf("Auto cycle: %ds ON, %ds OFF\n", pumpConfig.onTime/1000, pumpConfig.offTime/1000);
 
-  pinMode(phUpPumpPin, OUTPUT); // Initialize phUpPumpPin as output
-  pinMode(phDownPumpPin, OUTPUT); // Initialize phDownPumpPin as output
-  digitalWrite(phUpPumpPin, LOW);
-  digitalWrite(phDownPumpPin, LOW);
+  halPinMode(phUpPumpPin, OUTPUT); // Initialize phUpPumpPin as output
+  halPinMode(phDownPumpPin, OUTPUT); // Initialize phDownPumpPin as output
+  halDigitalWrite(phUpPumpPin, LOW);
+  halDigitalWrite(phDownPumpPin, LOW);
+
+  initWaterLevel(); // Level interrupt cuts the pumps directly, so the outputs must exist first
+}
+
+// Gives the pump pins back after an interlock, in the state the control logic wants
+void reconnectPumpOutputs() {
+  halPwmAttach(waterPumpPin, PUMP_PWM_CHANNEL);
+  halPwmWrite(PUMP_PWM_CHANNEL, pumpState ? PUMP_PWM_ON_DUTY : 0);
+  halDigitalWrite(phUpPumpPin, phUpActive ? HIGH : LOW);
+  halDigitalWrite(phDownPumpPin, phDownActive ? HIGH : LOW);
 }
 
 void updatePumpControl() {
+  // The level interrupt already cut the output, only bring the state in line
+  if (isWaterLevelFault() && pumpState) {
+    pumpState = false;
+    pumpLastChange = halMillis();
+    currentSensors.pumpStatus = false;
+    Serial.println("Interlock: Pump OFF (water level low)");
+  }
+  if (isPumpInterlocked()) {
+    return;
+  }
+
   // Only run auto control if auto mode is enabled
   if (!pumpConfig.autoMode) {
     return;
   }
   
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halMillis();
   unsigned long elapsedTime = currentTime - pumpLastChange;
   
   if (pumpState) {
     // Pump is currently ON - check if it should turn OFF
     if (elapsedTime >= pumpConfig.onTime) {
       pumpState = false;
-      ledcWrite(PUMP_PWM_CHANNEL, 0);
+      halPwmWrite(PUMP_PWM_CHANNEL, 0);
       pumpLastChange = currentTime;
       Serial.println("Auto: Pump turned OFF");
     }
@@ -74,7 +97,7 @@ void updatePumpControl() {
     // Pump is currently OFF - check if it should turn ON
     if (elapsedTime >= pumpConfig.offTime) {
       pumpState = true;
-      ledcWrite(PUMP_PWM_CHANNEL, PUMP_PWM_ON_DUTY);
+      halPwmWrite(PUMP_PWM_CHANNEL, PUMP_PWM_ON_DUTY);
       pumpLastChange = currentTime;
       Serial.println("Auto: Pump turned ON (40%% speed)");
     }
@@ -85,9 +108,13 @@ void updatePumpControl() {
 }
 
 void setPumpState(bool state) {
+  if (state && isPumpInterlocked()) {
+    Serial.println("Manual: Pump stays OFF (water level low)");
+    return;
+  }
   pumpState = state;
-  ledcWrite(PUMP_PWM_CHANNEL, state ? PUMP_PWM_ON_DUTY : 0);
-  pumpLastChange = millis();
+  halPwmWrite(PUMP_PWM_CHANNEL, state ? PUMP_PWM_ON_DUTY : 0);
+  pumpLastChange = halMillis();
   currentSensors.pumpStatus = state;
   Serial.println(state ? "Manual: Pump turned ON (40%% speed)" : "Manual: Pump turned OFF");
   pumpConfig.autoMode = false;
@@ -109,7 +136,7 @@ void setPumpTiming(int onMinutes, int offMinutes) {
     
     // Reset cycle if in auto mode
     if (pumpConfig.autoMode) {
-      pumpLastChange = millis();
+      pumpLastChange = halMillis();
     }
   }
 }
@@ -118,7 +145,7 @@ void enableAutoMode(bool enable) {
   pumpConfig.autoMode = enable;
   if (enable) {
     pumpConfig.autoMode = true;
-    pumpLastChange = millis(); // Reset cycle timing
+    pumpLastChange = halMillis(); // Reset cycle timing
     Serial.println("Auto mode enabled");
   } else {
     Serial.println("Auto mode disabled");
@@ -134,7 +161,7 @@ unsigned long getPumpCycleTimeRemaining() {
     return 0;
   }
   
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halMillis();
   unsigned long elapsedTime = currentTime - pumpLastChange;
   
   if (pumpState) {
@@ -147,6 +174,11 @@ unsigned long getPumpCycleTimeRemaining() {
 }
 
 String getPumpStatusString() {
+  // Latched dry-run fault overrides everything else
+  if (isWaterLevelFault()) {
+    return "OFF (Water Level Fault)";
+  }
+
   // prefix: ON or OFF
   String status = pumpState ? "ON" : "OFF";
 
@@ -169,24 +201,49 @@ String getPumpStatusString() {
 }
 
 // pH Control Functions
+
+// The level interrupt can cut the pumps between a lock check and this write (other core or
+// preemption), so check again once the pin is high and take it back down if it lost the race
+static bool startPHPump(int pin) {
+  halDigitalWrite(pin, HIGH);
+  if (arePHPumpsLocked()) {
+    halDigitalWrite(pin, LOW);
+    return false;
+  }
+  return true;
+}
+
 void updatePHControl() {
+  // Dry reservoir: the level interrupt cut the pH pumps (manual or auto); drive them low
+  // anyway in case one was switched on right after the cut
+  if (arePHPumpsLocked()) {
+    halDigitalWrite(phUpPumpPin, LOW);
+    halDigitalWrite(phDownPumpPin, LOW);
+    if (isWaterLevelFault() && (phUpActive || phDownActive)) {
+      phUpActive = false;
+      phDownActive = false;
+      Serial.println("Interlock: pH pumps OFF (water level low)");
+    }
+    return;
+  }
+
   // Only run auto control if auto mode is enabled
   if (!phConfig.autoMode) {
     return;
   }
   
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halMillis();
   
   // Turn off pumps automatically after their on-time in auto mode
   if (phUpActive && (currentTime - phUpStartTime >= PH_PUMP_ON_TIME)) {
-    digitalWrite(phUpPumpPin, LOW);
+    halDigitalWrite(phUpPumpPin, LOW);
     phUpActive = false;
     phUpLastActivation = currentTime;
     Serial.println("pH UP pump turned OFF (auto)");
   }
   
   if (phDownActive && (currentTime - phDownStartTime >= PH_PUMP_ON_TIME)) {
-    digitalWrite(phDownPumpPin, LOW);
+    halDigitalWrite(phDownPumpPin, LOW);
     phDownActive = false;
     phDownLastActivation = currentTime;
     Serial.println("pH DOWN pump turned OFF (auto)");
@@ -196,8 +253,8 @@ void updatePHControl() {
   extern SensorData currentSensors;
   float currentPH = currentSensors.waterPH;
   
-  // Skip pH control if reading is invalid
-  if (currentPH <= 0 || currentPH > 14) {
+  // Skip pH control if reading is invalid (or the probe is failing)
+  if (!isSensorValid(currentSensors, SENSOR_VALID_PH) || currentPH <= 0 || currentPH > 14) {
     return;
   }
   
@@ -209,8 +266,7 @@ void updatePHControl() {
     
     // pH is too high - need to lower it
     if (phDifference > PH_DEADBAND && !phDownActive && !phUpActive) {
-      if (currentTime - phDownLastActivation >= PH_PUMP_COOLDOWN) {
-        digitalWrite(phDownPumpPin, HIGH);
+      if (currentTime - phDownLastActivation >= PH_PUMP_COOLDOWN && startPHPump(phDownPumpPin)) {
         phDownActive = true;
         phDownStartTime = currentTime;
         Serial.printf("pH too high (%.2f) - activating pH DOWN pump\n", currentPH);
@@ -218,8 +274,7 @@ void updatePHControl() {
     }
     // pH is too low - need to raise it  
     else if (phDifference < -PH_DEADBAND && !phUpActive && !phDownActive) {
-      if (currentTime - phUpLastActivation >= PH_PUMP_COOLDOWN) {
-        digitalWrite(phUpPumpPin, HIGH);
+      if (currentTime - phUpLastActivation >= PH_PUMP_COOLDOWN && startPHPump(phUpPumpPin)) {
         phUpActive = true;
         phUpStartTime = currentTime;
         Serial.printf("pH too low (%.2f) - activating pH UP pump\n", currentPH);
@@ -232,8 +287,9 @@ void updatePHControl() {
 String getPHControlStatus() {
   String status;
   
-  extern SensorData currentSensors;
-  float currentPH = currentSensors.waterPH;
+  SensorData sensors;
+  getSensorSnapshot(sensors); // Called from web requests, not the loop
+  float currentPH = sensors.waterPH;
   
   // Determine pH condition
   float phDifference = currentPH - phConfig.target;
@@ -263,7 +319,7 @@ String getPHControlStatus() {
     // Auto mode
     if (phUpActive) {
       // pH UP pump running in auto mode
-      unsigned long timeRemaining = PH_PUMP_ON_TIME - (millis() - phUpStartTime);
+      unsigned long timeRemaining = PH_PUMP_ON_TIME - (halMillis() - phUpStartTime);
       if (timeRemaining > 0 && timeRemaining <= PH_PUMP_ON_TIME) {
         status += "Auto - pH Up " + String(timeRemaining/1000) + "s";
       } else {
@@ -271,7 +327,7 @@ String getPHControlStatus() {
       }
     } else if (phDownActive) {
       // pH DOWN pump running in auto mode
-      unsigned long timeRemaining = PH_PUMP_ON_TIME - (millis() - phDownStartTime);
+      unsigned long timeRemaining = PH_PUMP_ON_TIME - (halMillis() - phDownStartTime);
       if (timeRemaining > 0 && timeRemaining <= PH_PUMP_ON_TIME) {
         status += "Auto - pH Down " + String(timeRemaining/1000) + "s";
       } else {
@@ -279,7 +335,7 @@ String getPHControlStatus() {
       }
     } else {
       // Auto mode but no pumps running - check if in cooldown
-      unsigned long currentTime = millis();
+      unsigned long currentTime = halMillis();
       unsigned long upCooldownRemaining = 0;
       unsigned long downCooldownRemaining = 0;
       
@@ -309,21 +365,26 @@ void togglePHUp() {
   
   if (phUpActive) {
     // Turn OFF pH UP pump
-    digitalWrite(phUpPumpPin, LOW);
+    halDigitalWrite(phUpPumpPin, LOW);
     phUpActive = false;
-    phUpLastActivation = millis();
+    phUpLastActivation = halMillis();
     Serial.println("pH UP pump turned OFF (manual)");
+  } else if (arePHPumpsLocked()) {
+    Serial.println("pH UP pump stays OFF (water level low)");
   } else {
     // Turn ON pH UP pump (but turn off pH DOWN if active)
     if (phDownActive) {
-      digitalWrite(phDownPumpPin, LOW);
+      halDigitalWrite(phDownPumpPin, LOW);
       phDownActive = false;
       Serial.println("pH DOWN pump turned OFF (switching to pH UP)");
     }
-    digitalWrite(phUpPumpPin, HIGH);
-    phUpActive = true;
-    phUpStartTime = millis();
-    Serial.println("pH UP pump turned ON (manual)");
+    if (startPHPump(phUpPumpPin)) {
+      phUpActive = true;
+      phUpStartTime = halMillis();
+      Serial.println("pH UP pump turned ON (manual)");
+    } else {
+      Serial.println("pH UP pump stays OFF (water level low)");
+    }
   }
 }
 
@@ -332,21 +393,26 @@ void togglePHDown() {
   
   if (phDownActive) {
     // Turn OFF pH DOWN pump
-    digitalWrite(phDownPumpPin, LOW);
+    halDigitalWrite(phDownPumpPin, LOW);
     phDownActive = false;
-    phDownLastActivation = millis();
+    phDownLastActivation = halMillis();
     Serial.println("pH DOWN pump turned OFF (manual)");
+  } else if (arePHPumpsLocked()) {
+    Serial.println("pH DOWN pump stays OFF (water level low)");
   } else {
     // Turn ON pH DOWN pump (but turn off pH UP if active)
     if (phUpActive) {
-      digitalWrite(phUpPumpPin, LOW);
+      halDigitalWrite(phUpPumpPin, LOW);
       phUpActive = false;
       Serial.println("pH UP pump turned OFF (switching to pH DOWN)");
     }
-    digitalWrite(phDownPumpPin, HIGH);
-    phDownActive = true;
-    phDownStartTime = millis();
-    Serial.println("pH DOWN pump turned ON (manual)");
+    if (startPHPump(phDownPumpPin)) {
+      phDownActive = true;
+      phDownStartTime = halMillis();
+      Serial.println("pH DOWN pump turned ON (manual)");
+    } else {
+      Serial.println("pH DOWN pump stays OFF (water level low)");
+    }
   }
 }
 
@@ -354,16 +420,16 @@ void stopPHPumps() {
   phConfig.autoMode = false;  // Switch to manual mode
   
   if (phUpActive) {
-    digitalWrite(phUpPumpPin, LOW);
+    halDigitalWrite(phUpPumpPin, LOW);
     phUpActive = false;
-    phUpLastActivation = millis();
+    phUpLastActivation = halMillis();
     Serial.println("pH UP pump stopped manually");
   }
   
   if (phDownActive) {
-    digitalWrite(phDownPumpPin, LOW);
+    halDigitalWrite(phDownPumpPin, LOW);
     phDownActive = false;
-    phDownLastActivation = millis();
+    phDownLastActivation = halMillis();
     Serial.println("pH DOWN pump stopped manually");
   }
 }
@@ -378,37 +444,42 @@ void enablePHAutoMode(bool enable) {
     if (phUpActive || phDownActive) {
       // Turn off any manually running pumps
       if (phUpActive) {
-        digitalWrite(phUpPumpPin, LOW);
+        halDigitalWrite(phUpPumpPin, LOW);
         phUpActive = false;
-        phUpLastActivation = millis();
+        phUpLastActivation = halMillis();
         Serial.println("pH UP pump stopped (switching to auto)");
       }
       if (phDownActive) {
-        digitalWrite(phDownPumpPin, LOW);
+        halDigitalWrite(phDownPumpPin, LOW);
         phDownActive = false;
-        phDownLastActivation = millis();
+        phDownLastActivation = halMillis();
         Serial.println("pH DOWN pump stopped (switching to auto)");
       }
       
       // Immediately evaluate current pH and take action if needed
-      extern SensorData currentSensors;
-      float currentPH = currentSensors.waterPH;
+      SensorData sensors;
+      getSensorSnapshot(sensors); // Called from web requests, not the loop
+      float currentPH = sensors.waterPH;
       
-      if (currentPH > 0 && currentPH <= 14) {
+      if (!arePHPumpsLocked() && isSensorValid(sensors, SENSOR_VALID_PH) && currentPH > 0 && currentPH <= 14) {
         float phDifference = currentPH - phConfig.target;
-        unsigned long currentTime = millis();
+        unsigned long currentTime = halMillis();
         
         // Only start pumps if not in cooldown period
         if (abs(phDifference) > phConfig.tolerance) {
           if (phDifference > PH_DEADBAND && (currentTime - phDownLastActivation >= PH_PUMP_COOLDOWN)) {
             // pH too high - activate pH DOWN pump immediately
-            digitalWrite(phDownPumpPin, HIGH);
+            if (!startPHPump(phDownPumpPin)) {
+              return;
+            }
             phDownActive = true;
             phDownStartTime = currentTime;
             Serial.printf("Auto mode: pH too high (%.2f) - activating pH DOWN pump\n", currentPH);
           } else if (phDifference < -PH_DEADBAND && (currentTime - phUpLastActivation >= PH_PUMP_COOLDOWN)) {
             // pH too low - activate pH UP pump immediately
-            digitalWrite(phUpPumpPin, HIGH);
+            if (!startPHPump(phUpPumpPin)) {
+              return;
+            }
             phUpActive = true;
             phUpStartTime = currentTime;
             Serial.printf("Auto mode: pH too low (%.2f) - activating pH UP pump\n", currentPH);
@@ -421,14 +492,14 @@ void enablePHAutoMode(bool enable) {
     
     // When switching to manual mode, stop any auto-controlled pumps
     if (phUpActive) {
-      digitalWrite(phUpPumpPin, LOW);
+      halDigitalWrite(phUpPumpPin, LOW);
       phUpActive = false;
-      phUpLastActivation = millis();
+      phUpLastActivation = halMillis();
     }
     if (phDownActive) {
-      digitalWrite(phDownPumpPin, LOW);
+      halDigitalWrite(phDownPumpPin, LOW);
       phDownActive = false;
-      phDownLastActivation = millis();
+      phDownLastActivation = halMillis();
     }
   }
 }
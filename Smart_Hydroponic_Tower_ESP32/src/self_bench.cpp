@@ -0,0 +1,191 @@
+#include "self_bench.h"
+#include "hal.h"
+#include "sensors.h"
+#include "display.h"
+#include "data_logger.h"
+#include "api_json.h"
+
+#define SELF_BENCH_NVS_SPACE "selfbench"
+
+struct BenchSeries {
+  uint16_t count;
+  uint16_t errors;   // Failed uploads or NVS writes, not part of the timing
+  unsigned long samplesUs[SELF_BENCH_SAMPLES];
+};
+
+static BenchSeries sensorSeries[SCHEDULER_MAX_TASKS];  // Written by the acquisition task
+static BenchSeries loopSeries[SELF_BENCH_LOOP_ITEMS];
+static volatile uint8_t benchState = SELF_BENCH_IDLE;
+static bool includeUpload = false;
+static unsigned long startMs = 0;
+static unsigned long durationMs = 0;
+
+static const char* loopItemNames[SELF_BENCH_LOOP_ITEMS] = {"drawSensorStatus", "sensorJSON", "loggerJSON", "nvsWrite", "supabasePost"};
+static const char* loopItemGroups[SELF_BENCH_LOOP_ITEMS] = {"display", "json", "json", "nvs", "http"};
+static const uint16_t loopItemSamples[SELF_BENCH_LOOP_ITEMS] = {SELF_BENCH_SAMPLES, SELF_BENCH_SAMPLES, SELF_BENCH_SAMPLES,
+                                                                SELF_BENCH_NVS_SAMPLES, SELF_BENCH_UPLOAD_SAMPLES};
+
+static void addSample(BenchSeries &series, unsigned long us) {
+  if (series.count < SELF_BENCH_SAMPLES) {
+    series.samplesUs[series.count] = us;
+    series.count++; // After the sample, readers on the other core only see complete ones
+  }
+}
+
+// Scheduler hook, runs in the acquisition task
+static void recordSensorRun(uint8_t task, unsigned long durationUs) {
+  if (task < SCHEDULER_MAX_TASKS) {
+    addSample(sensorSeries[task], durationUs);
+  }
+}
+
+bool startSelfBench(bool upload) {
+  if (benchState == SELF_BENCH_RUNNING) {
+    return false;
+  }
+  memset(sensorSeries, 0, sizeof(sensorSeries));
+  memset(loopSeries, 0, sizeof(loopSeries));
+  includeUpload = upload;
+  startMs = halMillis();
+  durationMs = 0;
+  benchState = SELF_BENCH_RUNNING;
+  setSchedulerRunHook(recordSensorRun);
+  Serial.printf("Self benchmark started%s\n", upload ? " (with Supabase round trips)" : "");
+  return true;
+}
+
+static bool isLoopItemPending(uint8_t item) {
+  if (item == SELF_BENCH_UPLOAD && !includeUpload) {
+    return false;
+  }
+  const BenchSeries &series = loopSeries[item];
+  return series.count + series.errors < loopItemSamples[item];
+}
+
+// One timed run of a loop-owned item
+static void takeLoopSample(uint8_t item) {
+  BenchSeries &series = loopSeries[item];
+  HttpRequest http;
+  if (item == SELF_BENCH_UPLOAD) {
+    beginSensorDataRequest(http); // Building the headers is not part of the round trip
+  }
+  uint32_t nvsBlock[8];
+  for (uint8_t i = 0; i < 8; i++) {
+    nvsBlock[i] = series.count + series.errors; // Changes every write, NVS skips identical blobs
+  }
+
+  bool ok = true;
+  unsigned long startUs = halMicros();
+  switch (item) {
+    case SELF_BENCH_DRAW:
+      drawSensorStatus();
+      break;
+    case SELF_BENCH_SENSOR_JSON:
+      getSensorDataJSON();
+      break;
+    case SELF_BENCH_LOGGER_JSON:
+      createJsonFromSensorData(currentSensors);
+      break;
+    case SELF_BENCH_NVS_WRITE:
+      ok = halNvsPutBytes(SELF_BENCH_NVS_SPACE, "block", nvsBlock, sizeof(nvsBlock)) == sizeof(nvsBlock);
+      break;
+    case SELF_BENCH_UPLOAD: {
+      int code = httpPost(http, "[]"); // Empty bulk insert: full TLS + PostgREST round trip, no row written
+      ok = code >= 200 && code < 300;
+      break;
+    }
+  }
+  unsigned long elapsedUs = halMicros() - startUs;
+
+  if (ok) {
+    addSample(series, elapsedUs);
+  } else {
+    series.errors++;
+  }
+}
+
+static void printSelfBench() {
+  Serial.printf("Self benchmark done in %lums (min/mean/p99/max us)\n", durationMs);
+  for (uint8_t i = 0; i < getSelfBenchItemCount(); i++) {
+    SelfBenchItem item = getSelfBenchItem(i);
+    if (item.count > 0) {
+      Serial.printf("  %-8s %-18s n=%-3u %lu/%lu/%lu/%lu\n", item.group, item.name, item.count,
+                    item.minUs, item.meanUs, item.p99Us, item.maxUs);
+    }
+  }
+}
+
+void serviceSelfBench() {
+  if (benchState != SELF_BENCH_RUNNING) {
+    return;
+  }
+  for (uint8_t item = 0; item < SELF_BENCH_LOOP_ITEMS; item++) {
+    if (isLoopItemPending(item)) {
+      takeLoopSample(item);
+      return;
+    }
+  }
+  if (halMillis() - startMs < SELF_BENCH_SENSOR_WINDOW_MS) {
+    return;
+  }
+  setSchedulerRunHook(NULL);
+  durationMs = halMillis() - startMs;
+  benchState = SELF_BENCH_DONE;
+  printSelfBench();
+}
+
+uint8_t getSelfBenchState() {
+  return benchState;
+}
+
+unsigned long getSelfBenchDurationMs() {
+  return benchState == SELF_BENCH_RUNNING ? halMillis() - startMs : durationMs;
+}
+
+bool isSelfBenchUploadIncluded() {
+  return includeUpload;
+}
+
+uint8_t getSelfBenchItemCount() {
+  return getSensorTaskCount() + SELF_BENCH_LOOP_ITEMS;
+}
+
+SelfBenchItem getSelfBenchItem(uint8_t index) {
+  SelfBenchItem item = {};
+  const BenchSeries *series;
+  uint8_t taskCount = getSensorTaskCount();
+  if (index < taskCount) {
+    item.name = getSensorTask(index).name;
+    item.group = "sensor";
+    series = &sensorSeries[index];
+  } else if (index < taskCount + SELF_BENCH_LOOP_ITEMS) {
+    item.name = loopItemNames[index - taskCount];
+    item.group = loopItemGroups[index - taskCount];
+    series = &loopSeries[index - taskCount];
+  } else {
+    return item;
+  }
+
+  // Sorted copy (insertion sort, at most SELF_BENCH_SAMPLES entries)
+  unsigned long sorted[SELF_BENCH_SAMPLES];
+  item.count = min(series->count, (uint16_t)SELF_BENCH_SAMPLES);
+  item.errors = series->errors;
+  if (item.count == 0) {
+    return item;
+  }
+  unsigned long long sumUs = 0;
+  for (uint16_t i = 0; i < item.count; i++) {
+    unsigned long value = series->samplesUs[i];
+    sumUs += value;
+    uint16_t j = i;
+    for (; j > 0 && sorted[j - 1] > value; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = value;
+  }
+  item.minUs = sorted[0];
+  item.meanUs = sumUs / item.count;
+  item.p99Us = sorted[(item.count * 99 + 99) / 100 - 1]; // Nearest rank
+  item.maxUs = sorted[item.count - 1];
+  return item;
+}
@@ -0,0 +1,71 @@
+#include "sensor_health.h"
+#include "hal.h"
+
+static SensorHealth health[SENSOR_COUNT] = {};
+
+static const char* sensorNames[SENSOR_COUNT] = {"waterTemp", "co2", "dht", "light", "ph", "ec"};
+static const char* errorNames[] = {"none", "timeout", "disconnected", "outOfRange", "checksum"};
+
+bool sensorDue(uint8_t sensor) {
+  SensorHealth &h = health[sensor];
+  if (h.backoffMs == 0 || h.probing) {
+    return true;
+  }
+  // Backing off - allow one re-probe once the delay has passed
+  if (halMillis() - h.lastFailureMs >= h.backoffMs) {
+    h.probing = true;
+    return true;
+  }
+  return false;
+}
+
+void reportSensorSuccess(uint8_t sensor) {
+  SensorHealth &h = health[sensor];
+  if (h.backoffMs > 0) {
+    Serial.printf("Sensor %s recovered\n", sensorNames[sensor]);
+  }
+  h.valid = true;
+  h.errorClass = SENSOR_ERROR_NONE;
+  h.lastGoodMs = halMillis();
+  h.consecutiveFailures = 0;
+  h.backoffMs = 0;
+  h.probing = false;
+}
+
+void reportSensorFailure(uint8_t sensor, uint8_t errorClass) {
+  SensorHealth &h = health[sensor];
+  h.errorClass = errorClass;
+  h.consecutiveFailures++;
+  h.totalFailures++;
+  h.lastFailureMs = halMillis();
+  h.probing = false;
+
+  if (h.consecutiveFailures < SENSOR_FAIL_THRESHOLD) {
+    return; // Occasional glitches keep the last good value valid
+  }
+
+  // Exponential back-off: 2s, 4s, 8s ... 5min between re-probes
+  h.valid = false;
+  if (h.backoffMs == 0) {
+    h.backoffMs = SENSOR_BACKOFF_MIN_MS;
+    Serial.printf("Sensor %s failing (%s), backing off\n", sensorNames[sensor], errorNames[errorClass]);
+  } else {
+    h.backoffMs = min(h.backoffMs * 2, (unsigned long)SENSOR_BACKOFF_MAX_MS);
+  }
+}
+
+bool isSensorHealthy(uint8_t sensor) {
+  return health[sensor].valid;
+}
+
+SensorHealth getSensorHealth(uint8_t sensor) {
+  return health[sensor < SENSOR_COUNT ? sensor : 0];
+}
+
+const char* getSensorName(uint8_t sensor) {
+  return sensor < SENSOR_COUNT ? sensorNames[sensor] : "unknown";
+}
+
+const char* getSensorErrorName(uint8_t errorClass) {
+  return errorClass <= SENSOR_ERROR_CHECKSUM ? errorNames[errorClass] : "unknown";
+}
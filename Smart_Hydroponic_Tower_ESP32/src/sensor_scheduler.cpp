@@ -0,0 +1,171 @@
+#include "sensor_scheduler.h"
+#include "hal.h"
+#include "span_trace.h"
+#include "metrics.h"
+
+static SensorTask tasks[SCHEDULER_MAX_TASKS];
+static uint8_t taskCount = 0;
+static SchedulerStats stats = {};
+static volatile SchedulerRunHook runHook = NULL;
+
+// Period changes from the web server task, applied by runSensorScheduler() between runs
+// since it reads and advances the task's slots every tick (0 = nothing pending)
+static volatile unsigned long requestedPeriodMs[SCHEDULER_MAX_TASKS];
+
+// Samples counted over the current one second window
+static unsigned long windowStartMs = 0;
+static unsigned long windowSamples = 0;
+
+// First regular slot strictly after now
+static unsigned long nextSlot(const SensorTask &task, unsigned long now) {
+  if ((long)(now - task.anchorMs) < 0) {
+    return task.anchorMs;
+  }
+  return task.anchorMs + ((now - task.anchorMs) / task.periodMs + 1) * task.periodMs;
+}
+
+// Rounds up to whole ticks so a slot never falls between two ticks
+static unsigned long toTicks(unsigned long ms) {
+  return ((ms + SCHEDULER_TICK_MS - 1) / SCHEDULER_TICK_MS) * SCHEDULER_TICK_MS;
+}
+
+int addSensorTask(const char* name, SensorTaskFn run, unsigned long periodMs, unsigned long phaseMs,
+                  unsigned long costUs, unsigned long minPeriodMs) {
+  if (taskCount >= SCHEDULER_MAX_TASKS) {
+    Serial.printf("Scheduler full, %s not added\n", name);
+    return -1;
+  }
+  SensorTask &task = tasks[taskCount];
+  task = {};
+  task.name = name;
+  task.run = run;
+  task.minPeriodMs = toTicks(max(minPeriodMs, (unsigned long)SCHEDULER_TICK_MS));
+  task.periodMs = max(toTicks(periodMs), task.minPeriodMs);
+  task.phaseMs = toTicks(phaseMs);
+  task.costUs = costUs;
+  task.anchorMs = halMillis() + task.phaseMs;
+  task.nextDueMs = task.anchorMs;
+  return taskCount++;
+}
+
+// Re-anchor so the new period starts from the next phase slot
+static void applyRequestedPeriod(SensorTask &task, unsigned long periodMs, unsigned long now) {
+  task.periodMs = periodMs;
+  task.anchorMs = now + task.phaseMs % task.periodMs;
+  task.nextDueMs = task.anchorMs;
+  Serial.printf("Sensor %s period: %lums\n", task.name, task.periodMs);
+}
+
+void runSensorScheduler() {
+  unsigned long now = halMillis();
+  unsigned long tickStartUs = halMicros();
+  unsigned long spentUs = 0;
+  bool ranTask = false;
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    SensorTask &task = tasks[i];
+    unsigned long requested = requestedPeriodMs[i];
+    // A request arriving after the read stays pending for the next tick
+    if (requested && __sync_bool_compare_and_swap(&requestedPeriodMs[i], requested, 0UL)) {
+      applyRequestedPeriod(task, requested, now);
+    }
+    if ((long)(now - task.nextDueMs) < 0) {
+      continue;
+    }
+
+    // Keep the tick short: a task that doesn't fit the remaining budget waits one tick,
+    // unless it was already deferred or nothing else ran yet
+    unsigned long expectedUs = task.maxUs ? task.maxUs : task.costUs;
+    if (ranTask && !task.deferred && spentUs + expectedUs > SCHEDULER_TICK_BUDGET_US) {
+      task.deferred = true;
+      task.deferrals++;
+      stats.deferrals++;
+      continue;
+    }
+    task.deferred = false;
+
+    unsigned long followUpMs = 0;
+    unsigned long startUs = halMicros();
+    TRACE_BEGIN(task.name);
+    bool sampled = task.run(followUpMs);
+    TRACE_END(task.name);
+    task.lastUs = halMicros() - startUs;
+    if (task.lastUs > task.maxUs) {
+      task.maxUs = task.lastUs;
+    }
+    spentUs += task.lastUs;
+    observeSensorRead(i, task.lastUs);
+    SchedulerRunHook hook = runHook;
+    if (hook) {
+      hook(i, task.lastUs);
+    }
+    ranTask = true;
+
+    task.runs++;
+    if (sampled) {
+      task.samples++;
+      windowSamples++;
+    }
+    task.nextDueMs = followUpMs > 0 ? now + toTicks(followUpMs) : nextSlot(task, now);
+  }
+
+  stats.ticks++;
+  if (ranTask) {
+    stats.busyTicks++;
+  }
+  stats.lastTickUs = halMicros() - tickStartUs;
+  if (stats.lastTickUs > stats.maxTickUs) {
+    stats.maxTickUs = stats.lastTickUs;
+  }
+
+  if (now - windowStartMs >= 1000) {
+    stats.samplesPerSecond = windowSamples * 1000.0f / (now - windowStartMs);
+    windowSamples = 0;
+    windowStartMs = now;
+  }
+}
+
+bool setSensorTaskPeriod(const char* name, unsigned long periodMs) {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    SensorTask &task = tasks[i];
+    if (strcmp(task.name, name) != 0) {
+      continue;
+    }
+    requestedPeriodMs[i] = max(toTicks(periodMs), task.minPeriodMs);
+    return true;
+  }
+  return false;
+}
+
+void resetSchedulerStats() {
+  stats.maxTickUs = 0;
+  stats.deferrals = 0;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    tasks[i].maxUs = 0;
+    tasks[i].deferrals = 0;
+  }
+}
+
+void setSchedulerRunHook(SchedulerRunHook hook) {
+  runHook = hook;
+}
+
+SchedulerStats getSchedulerStats() {
+  return stats;
+}
+
+uint8_t getSensorTaskCount() {
+  return taskCount;
+}
+
+unsigned long getRequestedTaskPeriod(uint8_t index) {
+  if (index >= taskCount) {
+    return 0;
+  }
+  unsigned long requested = requestedPeriodMs[index];
+  return requested ? requested : tasks[index].periodMs;
+}
+
+SensorTask getSensorTask(uint8_t index) {
+  return tasks[index < taskCount ? index : 0];
+}
@@ -0,0 +1,55 @@
+#include "sensor_status.h"
+
+void evaluateSensorStatus(const SensorData &data, bool waterLevelFault, SensorStatus &status) {
+  // Sensor ranges (EDIT THESE FOR YOUR SENSOR RANGES)
+  status.channels[STATUS_WATER_TEMP] = getStatusLevel(data.waterTemp, 18, 22, 15, 25, 12, 28);
+  status.channels[STATUS_PH]         = getStatusLevel(data.waterPH, 5.5, 6.5, 5, 7, 4, 8);
+  status.channels[STATUS_EC]         = getStatusLevel(data.waterEC, 0.8, 1.2, 0.6, 1.8, 0.3, 2.5);
+  status.channels[STATUS_WATER_LEVEL] = getStatusLevel(data.waterLevel);
+  status.channels[STATUS_PUMP]       = waterLevelFault ? STATUS_CRITICAL : getStatusLevel(data.pumpStatus); // Interlocked pump shows red
+  status.channels[STATUS_ENV_TEMP]   = getStatusLevel(data.envTemp, 15, 28, 13, 32, 10, 35);
+  status.channels[STATUS_HUMIDITY]   = getStatusLevel(data.envHumidity, 50, 70, 35, 85, 25, 95);
+  status.channels[STATUS_LIGHT]      = getStatusLevel(data.lightLevel, 10, 40000, 5, 50000, 2, 90000);
+  status.channels[STATUS_CO2]        = getStatusLevel(data.co2Level, 200, 1800, 100, 2200, 50, 3000);
+
+  // Invalid channels are greyed out and left out of the overall status
+  if (!isSensorValid(data, SENSOR_VALID_WATER_TEMP))    status.channels[STATUS_WATER_TEMP] = STATUS_INVALID;
+  if (!isSensorValid(data, SENSOR_VALID_PH))            status.channels[STATUS_PH] = STATUS_INVALID;
+  if (!isSensorValid(data, SENSOR_VALID_EC))            status.channels[STATUS_EC] = STATUS_INVALID;
+  if (!isSensorValid(data, SENSOR_VALID_ENV_TEMP))      status.channels[STATUS_ENV_TEMP] = STATUS_INVALID;
+  if (!isSensorValid(data, SENSOR_VALID_ENV_HUMIDITY))  status.channels[STATUS_HUMIDITY] = STATUS_INVALID;
+  if (!isSensorValid(data, SENSOR_VALID_LIGHT))         status.channels[STATUS_LIGHT] = STATUS_INVALID;
+  if (!isSensorValid(data, SENSOR_VALID_CO2))           status.channels[STATUS_CO2] = STATUS_INVALID;
+
+  // Overall system status from the worst sensor (excluding pump)
+  status.overall = STATUS_OK;
+  for (int i = 0; i < STATUS_CHANNEL_COUNT; i++) {
+    if (i != STATUS_PUMP && status.channels[i] != STATUS_INVALID && status.channels[i] > status.overall) {
+      status.overall = status.channels[i];
+    }
+  }
+  static const char* levelTexts[] = {"System OK", "Caution", "Warning", "Critical"};
+  status.text = levelTexts[status.overall];
+
+  if (status.overall == STATUS_OK && (data.validMask & SENSOR_VALID_ALL) != SENSOR_VALID_ALL) {
+    status.overall = STATUS_CAUTION;
+    status.text = "Sensor Fault"; // Everything readable is fine, but something isn't readable
+  }
+  if (waterLevelFault) {
+    status.overall = STATUS_CRITICAL;
+    status.text = "Pump Fault"; // Dry-run interlock latched, needs clearing
+  }
+}
+
+// Status level based on value ranges (float)
+uint8_t getStatusLevel(float value, float minGood, float maxGood, float minYellow, float maxYellow, float minOrange, float maxOrange) {
+  if (value >= minGood && value <= maxGood) return STATUS_OK;
+  if (value >= minYellow && value <= maxYellow) return STATUS_CAUTION;
+  if (value >= minOrange && value <= maxOrange) return STATUS_WARNING;
+  return STATUS_CRITICAL;
+}
+
+// Status level for boolean values
+uint8_t getStatusLevel(bool status) {
+  return status ? STATUS_OK : STATUS_CRITICAL;
+}
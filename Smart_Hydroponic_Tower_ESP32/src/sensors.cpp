@@ -1,58 +1,58 @@
 #include "sensors.h"
-#include <Wire.h>
-#include <BH1750.h>
-#include "MHZ19.h"
-#include <OneWire.h>
-#include <DallasTemperature.h>
-#include "DHT.h"
 #include "pump_control.h"
-#include "DFRobot_ESP_EC.h"
+#include "water_temp.h"
+#include "co2_sensor.h"
+#include "dht_sensor.h"
+#include "adc_sampler.h"
+#include "filters.h"
+#include "sensor_health.h"
+#include "sensor_scheduler.h"
+#include "water_level.h"
+#include "calibration.h"
+#include "light_sensor.h"
+#include "hal.h"
 
-// Pin definitions for sensors
-#define waterTempPin 13  // GPIO where the DS18B20 water temp sensor is connected to
-#define waterLevelPin 14 // GPIO pin for water level sensor (with voltage divider)
-#define waterPHPin 36    // GPIO pin for pH meter Analog output
-#define waterECPin 34    // GPIO pin for EC meter Analog output
-#define DHTPIN 4         // GPIO pin for DHT22 sensor
+// Split-phase drivers are polled again this soon after starting a transaction
+#define CO2_REPLY_POLL_MS 50     // Reply takes ~20ms at 9600 baud
+#define DHT_COLLECT_POLL_MS 50   // Capture is done ~6ms after the start pulse
 
-#define phOffset 0.6    // ph sensor deviation compensate
-
-// Moving average parameters for pH sensor
+// Moving average parameters for pH sensor (only used when the ADC sampler isn't running)
 #define PH_SAMPLES 10    // Number of samples to average (adjust as needed)
-float phReadings[PH_SAMPLES];  // Array to store pH readings
-int phIndex = 0;              // Current index in the array
-float phSum = 0.0;            // Sum of all readings
-bool phBufferFilled = false;  // Flag to check if buffer is full
-
-#define DHTTYPE DHT22 
-DHT dht(DHTPIN, DHTTYPE); // Initialize DHT sensor.
-
-OneWire oneWire(waterTempPin); // Setup a oneWire instance to communicate with any OneWire devices
-DallasTemperature sensors(&oneWire); // Pass our oneWire reference to Dallas Temperature sensor 
+MovingAverage<PH_SAMPLES> phMovingAverage; // Compensated running sum, doesn't drift
 
-//CO2 sensor definitions
-#define RX_PIN 16 // Rx pin which the MHZ19 Tx pin is attached to
-#define TX_PIN 17 // Tx pin which the MHZ19 Rx pin is attached to
-#define BAUDRATE 9600 // Device to MH-Z19 Serial baudrate (should not be changed)
+// Per-channel filters, applied whenever a channel delivers a new value
+FilterChain<HampelFilter<7>, KalmanFilter1D<5, 200>> phFilter;        // Spikes out, then smooth slowly
+FilterChain<HampelFilter<7>, ExponentialFilter<1, 3>> ecFilter;
+FilterChain<MedianFilter<5>> co2Filter;                               // MH-Z19 occasionally reports spikes
+FilterChain<ExponentialFilter<1, 2>> lightFilter;
+FilterChain<HampelFilter<5>> waterTempFilters[MAX_WATER_PROBES];      // Single bad scratchpad reads
+FilterChain<HampelFilter<5>> envTempFilter;
+FilterChain<HampelFilter<5>, ExponentialFilter<1, 2>> humidityFilter;
 
-MHZ19 myMHZ19; // CO2 sensor object
-HardwareSerial mySerial(2); // On ESP32 we have 2 USARTS available
-BH1750 lightMeter; //Light sensor object
-DFRobot_ESP_EC ec; // EC sensor object
 
-
-// Global sensor data
-SensorData currentSensors = {
+// Working copy, only touched by the acquisition task
+static SensorData acquiredSensors = {
   .waterLevel = false,
   .co2Level = 0,
   .waterPH = 0.0,
   .waterTemp = 0.0,
+  .waterTempTop = 0.0,
+  .waterTempRoot = 0.0,
   .envTemp = 0.0,
   .envHumidity = 0.0,
   .lightLevel = 0.0,
-  .pumpStatus = false
+  .pumpStatus = false,
+  .validMask = 0
 };
 
+// Latest published snapshot. Seqlock: the sequence is odd while the acquisition task is
+// copying into it, readers retry until they see the same even sequence before and after
+static SensorData snapshot = {};
+static volatile uint32_t snapshotSeq = 0;
+
+// Loop task's consistent copy (pump control and display)
+SensorData currentSensors = {};
+
 // Previous values for clearing old text
 PreviousValues previousSensors = {
   .waterLevel = false,
@@ -62,70 +62,270 @@ PreviousValues previousSensors = {
   .envTemp = 0.0,
   .envHumidity = 0.0,
   .lightLevel = 0.0,
-  .pumpStatus = false
+  .pumpStatus = false,
+  .validMask = 0
 };
 
-void initSensors() {
-  // Initialize sensor pins
-  pinMode(waterLevelPin, INPUT);
+// Scheduler tasks (defined below)
+static bool readWaterLevelTask(unsigned long &followUpMs);
+static bool readAnalogTask(unsigned long &followUpMs);
+static bool readWaterTempTask(unsigned long &followUpMs);
+static bool readCO2Task(unsigned long &followUpMs);
+static bool readDHTTask(unsigned long &followUpMs);
+static bool readLightTask(unsigned long &followUpMs);
 
+void initSensors() {
   // Initialize pH moving average buffer
-  for (int i = 0; i < PH_SAMPLES; i++) {
-    phReadings[i] = 0.0;
-  }
-  phIndex = 0;
-  phSum = 0.0;
-  phBufferFilled = false;
+  phMovingAverage.reset();
 
-  dht.begin(); // Initialize the DHT22 sensor
-  sensors.begin(); // Initialize the DS18B20 sensor
+  initDHTSensor(); // Initialize the DHT22 sensor (RMT capture by default)
+  initWaterTemp(); // Enumerate the DS18B20 probes and start the first conversion
 
-  Wire.begin(); // Initialize the I2C bus (BH1750 library doesn't do this automatically)
-  lightMeter.begin(); // Initialize the light sensor
+  initLightSensor(); // Start the I2C bus and the BH1750
 
-  // Initialize the MH-Z19 CO2 sensor
-  mySerial.begin(BAUDRATE); // (Uno example) device to MH-Z19 serial start
-  myMHZ19.begin(mySerial); // *Serial(Stream) reference must be passed to library begin().
-  myMHZ19.autoCalibration(); // Turn auto calibration ON (OFF autoCalibration(false))
-  ec.begin(); // Initialize the EC sensor
+  initCO2Sensor(); // Initialize the MH-Z19 CO2 sensor and its UART receive callback
+  initCalibration(); // Load pH/EC calibration from NVS and build the conversion tables
+  initAdcSampler(); // Start continuous pH/EC sampling
+
+  // Sampling schedule: name, read, period, phase, declared cost (us), minimum period.
+  // Phases keep the slow devices on different ticks; periods can be changed via /scheduler
+  addSensorTask("waterLevel", readWaterLevelTask, 500, 0, 20, SCHEDULER_TICK_MS);
+  addSensorTask("analog", readAnalogTask, 250, 0, 1500, 100);         // pH/EC windows, 4 filtered samples/s
+  addSensorTask("waterTemp", readWaterTempTask, 1000, 100, 3000, 200); // Scratchpad reads of all probes
+  addSensorTask("co2", readCO2Task, 5000, 300, 500, CO2_READ_INTERVAL_MS + SCHEDULER_TICK_MS); // MH-Z19 updates every ~5s
+  addSensorTask("dht", readDHTTask, 2500, 550, 300, DHT_MIN_INTERVAL_MS + SCHEDULER_TICK_MS);  // Margin over the driver's own gate
+  addSensorTask("light", readLightTask, 1000, 800, 1500, 200);        // BH1750 high-res mode needs 120ms
   
   //Serial.println("Sensors initialized");
 }
 
 // Function to calculate moving average for pH
 float calculatePHMovingAverage(float newReading) {
-  // Remove the oldest reading from the sum
-  phSum -= phReadings[phIndex];
-  
-  // Add the new reading
-  phReadings[phIndex] = newReading;
-  phSum += newReading;
-  
-  // Move to the next index (circular buffer)
-  phIndex = (phIndex + 1) % PH_SAMPLES;
-  
-  // Check if we've filled the buffer at least once
-  if (!phBufferFilled && phIndex == 0) {
-    phBufferFilled = true;
+  return phMovingAverage.update(newReading);
+}
+
+// Per-probe validity from the last DS18B20 collection
+static bool waterProbeValid[MAX_WATER_PROBES] = {false, false, false};
+
+static bool isPlausibleWaterTemp(float temperature) {
+  // -127 = probe disconnected, 85 = power-on value of a probe that never converted
+  return temperature > -20 && temperature < 60 && temperature != 85.0;
+}
+
+static bool updateWaterTempChannels() {
+  float waterTemps[MAX_WATER_PROBES];
+  if (!updateWaterTemp(waterTemps)) { // Collects last tick's conversion and starts the next one
+    return false;
   }
-  
-  // Calculate and return the average
-  int samplesCount = phBufferFilled ? PH_SAMPLES : phIndex;
-  return samplesCount > 0 ? phSum / samplesCount : newReading;
+
+  bool anyValid = false;
+  bool anyConnected = false;
+  for (int i = 0; i < MAX_WATER_PROBES; i++) {
+    waterProbeValid[i] = isPlausibleWaterTemp(waterTemps[i]);
+    anyValid |= waterProbeValid[i];
+    anyConnected |= waterTemps[i] != WATER_TEMP_DISCONNECTED;
+    if (waterProbeValid[i]) {
+      waterTemps[i] = waterTempFilters[i].update(waterTemps[i]);
+    }
+  }
+  if (!anyValid) {
+    reportSensorFailure(SENSOR_WATER_TEMP, anyConnected ? SENSOR_ERROR_OUT_OF_RANGE : SENSOR_ERROR_DISCONNECTED);
+    return false;
+  }
+  reportSensorSuccess(SENSOR_WATER_TEMP);
+
+  // water temperatures in Celsius, invalid probes keep their last good value
+  if (waterProbeValid[WATER_PROBE_RESERVOIR]) acquiredSensors.waterTemp = waterTemps[WATER_PROBE_RESERVOIR];
+  if (waterProbeValid[WATER_PROBE_TOWER_TOP]) acquiredSensors.waterTempTop = waterTemps[WATER_PROBE_TOWER_TOP];
+  if (waterProbeValid[WATER_PROBE_ROOT_ZONE]) acquiredSensors.waterTempRoot = waterTemps[WATER_PROBE_ROOT_ZONE];
+  return true;
+}
+
+static bool updateCO2Channel() {
+  CO2Stats before = getCO2Stats();
+  float co2;
+  if (updateCO2Sensor(co2)) { // Collects the last reply and queues the next read command
+    if (co2 > 0 && co2 <= 10000) {
+      reportSensorSuccess(SENSOR_CO2);
+      acquiredSensors.co2Level = co2Filter.update(co2); // CO2 as ppm
+      return true;
+    }
+    reportSensorFailure(SENSOR_CO2, SENSOR_ERROR_OUT_OF_RANGE);
+    return false;
+  }
+
+  // A missing or corrupted reply only shows up in the driver counters
+  CO2Stats after = getCO2Stats();
+  if (after.timeouts != before.timeouts) {
+    reportSensorFailure(SENSOR_CO2, SENSOR_ERROR_TIMEOUT);
+  } else if (after.checksumErrors != before.checksumErrors) {
+    reportSensorFailure(SENSOR_CO2, SENSOR_ERROR_CHECKSUM);
+  }
+  return false;
+}
+
+static bool updateDHTChannels() {
+  DHTStats before = getDHTStats();
+  float envTemp, envHumidity;
+  if (updateDHTSensor(envTemp, envHumidity)) { // Both values come from one DHT22 transaction
+    if (!isnan(envTemp) && !isnan(envHumidity) && envHumidity >= 0 && envHumidity <= 100 && envTemp > -40 && envTemp < 80) {
+      reportSensorSuccess(SENSOR_DHT);
+      acquiredSensors.envTemp = envTempFilter.update(envTemp);
+      acquiredSensors.envHumidity = humidityFilter.update(envHumidity);
+      return true;
+    }
+    reportSensorFailure(SENSOR_DHT, SENSOR_ERROR_OUT_OF_RANGE);
+    return false;
+  }
+
+  DHTStats after = getDHTStats();
+  if (after.timeouts != before.timeouts) {
+    reportSensorFailure(SENSOR_DHT, SENSOR_ERROR_TIMEOUT);
+  } else if (after.checksumErrors != before.checksumErrors) {
+    reportSensorFailure(SENSOR_DHT, SENSOR_ERROR_CHECKSUM);
+  }
+  return false;
+}
+
+static bool updateLightChannel() {
+  float lux = readLightLevel(); // measured in lux, negative on I2C errors
+  if (lux < 0) {
+    reportSensorFailure(SENSOR_LIGHT, SENSOR_ERROR_DISCONNECTED);
+    return false;
+  }
+  reportSensorSuccess(SENSOR_LIGHT);
+  acquiredSensors.lightLevel = lightFilter.update(lux);
+  return true;
 }
 
+static bool updateAnalogChannels() {
+  bool sampled = false;
+  float adcCodes[ADC_CHANNEL_COUNT];
+  bool adcWindow = updateAdcSampler(adcCodes); // Trimmed mean of the last second of samples
+
+  if (!adcWindow) {
+    adcCodes[ADC_CHANNEL_PH] = halAnalogRead(waterPHPin);
+    adcCodes[ADC_CHANNEL_EC] = halAnalogRead(waterECPin);
+  }
+  float ph = convertPH(adcCodes[ADC_CHANNEL_PH]); // eFuse-corrected, calibrated lookup table
+
+  // A probe stuck at either rail is unplugged or shorted
+  if (adcCodes[ADC_CHANNEL_PH] <= 0 || adcCodes[ADC_CHANNEL_PH] >= 4095) {
+    reportSensorFailure(SENSOR_PH, SENSOR_ERROR_DISCONNECTED);
+  } else if (ph <= 0 || ph > 14) {
+    reportSensorFailure(SENSOR_PH, SENSOR_ERROR_OUT_OF_RANGE);
+  } else {
+    reportSensorSuccess(SENSOR_PH);
+    acquiredSensors.waterPH = adcWindow ? phFilter.update(ph) : calculatePHMovingAverage(ph); // apply filtering
+    sampled = true;
+  }
+
+  // Temperature compensated to 25C, assume 25C while the reservoir probe is failing
+  float ecTemperature = isSensorValid(acquiredSensors, SENSOR_VALID_WATER_TEMP) ? acquiredSensors.waterTemp : 25;
+  float ecValue = convertEC(adcCodes[ADC_CHANNEL_EC], ecTemperature);
+  if (adcCodes[ADC_CHANNEL_EC] >= 4095) {
+    reportSensorFailure(SENSOR_EC, SENSOR_ERROR_DISCONNECTED);
+  } else if (isnan(ecValue) || ecValue < 0) {
+    reportSensorFailure(SENSOR_EC, SENSOR_ERROR_OUT_OF_RANGE);
+  } else {
+    reportSensorSuccess(SENSOR_EC);
+    acquiredSensors.waterEC = ecFilter.update(ecValue);
+    sampled = true;
+  }
+  return sampled;
+}
+
+// Scheduler tasks, sensors that keep failing are skipped until their next re-probe
+static bool readWaterLevelTask(unsigned long &followUpMs) {
+  acquiredSensors.waterLevel = !halDigitalRead(waterLevelPin); // The water level  sensor reads LOW when water is present and HIGH there isn't
+  return true;
+}
+
+static bool readAnalogTask(unsigned long &followUpMs) {
+  return updateAnalogChannels(); // Sampled in the background, validated on every read
+}
+
+static bool readWaterTempTask(unsigned long &followUpMs) {
+  return sensorDue(SENSOR_WATER_TEMP) && updateWaterTempChannels();
+}
+
+static bool readCO2Task(unsigned long &followUpMs) {
+  if (!sensorDue(SENSOR_CO2)) {
+    return false;
+  }
+  bool sampled = updateCO2Channel();
+  if (isCO2ReplyPending()) {
+    followUpMs = CO2_REPLY_POLL_MS; // Collect the reply now instead of one period later
+  }
+  return sampled;
+}
+
+static bool readDHTTask(unsigned long &followUpMs) {
+  if (!sensorDue(SENSOR_DHT)) {
+    return false;
+  }
+  bool sampled = updateDHTChannels();
+  if (isDHTCapturePending()) {
+    followUpMs = DHT_COLLECT_POLL_MS;
+  }
+  return sampled;
+}
+
+static bool readLightTask(unsigned long &followUpMs) {
+  return sensorDue(SENSOR_LIGHT) && updateLightChannel();
+}
+
+static uint16_t buildValidMask() {
+  uint16_t mask = SENSOR_VALID_WATER_LEVEL; // Digital input, always readable
+  if (isSensorHealthy(SENSOR_CO2)) mask |= SENSOR_VALID_CO2;
+  if (isSensorHealthy(SENSOR_PH)) mask |= SENSOR_VALID_PH;
+  if (isSensorHealthy(SENSOR_EC)) mask |= SENSOR_VALID_EC;
+  if (isSensorHealthy(SENSOR_DHT)) mask |= SENSOR_VALID_ENV_TEMP | SENSOR_VALID_ENV_HUMIDITY;
+  if (isSensorHealthy(SENSOR_LIGHT)) mask |= SENSOR_VALID_LIGHT;
+  if (isSensorHealthy(SENSOR_WATER_TEMP)) {
+    if (waterProbeValid[WATER_PROBE_RESERVOIR]) mask |= SENSOR_VALID_WATER_TEMP;
+    if (waterProbeValid[WATER_PROBE_TOWER_TOP]) mask |= SENSOR_VALID_WATER_TEMP_TOP;
+    if (waterProbeValid[WATER_PROBE_ROOT_ZONE]) mask |= SENSOR_VALID_WATER_TEMP_ROOT;
+  }
+  return mask;
+}
+
+static void publishSensorSnapshot() {
+  // Only the acquisition task writes the snapshot, so it can compare without the seqlock
+  if (snapshotSeq != 0 && memcmp(&snapshot, &acquiredSensors, sizeof(SensorData)) == 0) {
+    return; // Nothing changed, readers keep their sequence number
+  }
+  halEnterCritical(); // Keeps the odd window to a single memcpy, readers never take it
+  snapshotSeq++;
+  __sync_synchronize();
+  memcpy(&snapshot, &acquiredSensors, sizeof(SensorData));
+  __sync_synchronize();
+  snapshotSeq++;
+  halExitCritical();
+}
+
+// Called from the acquisition task on every scheduler tick
 void updateSensorValues() {
-  currentSensors.waterLevel = !digitalRead(waterLevelPin); // The water level  sensor reads LOW when water is present and HIGH there isn't
-  currentSensors.co2Level = myMHZ19.getCO2(); // Request CO2 (as ppm)
-  float rawPH = 3.5*(analogRead(waterPHPin)*5/4096.0)+phOffset; // Read raw pH value
-  currentSensors.waterPH = calculatePHMovingAverage(rawPH); // apply moving average
-  sensors.requestTemperatures(); // Request temperature from DS18B20 water temperature sensor
-  currentSensors.waterTemp = sensors.getTempCByIndex(0); // water temperature in Celsius
-  currentSensors.waterEC = ec.readEC(analogRead(waterECPin), currentSensors.waterTemp); // Read EC value from the sensor
-  currentSensors.envTemp = dht.readTemperature(); // Read temperature from DHT22 sensor
-  currentSensors.envHumidity = dht.readHumidity(); // Read humidity from DHT22 sensor
-  currentSensors.lightLevel = lightMeter.readLightLevel(); // measured in lux
-  currentSensors.pumpStatus = getPumpState();    // pump status
+  runSensorScheduler(); // Reads only the sensors due on this tick
+
+  acquiredSensors.pumpStatus = getPumpState();    // pump status
+  acquiredSensors.validMask = buildValidMask();
+  publishSensorSnapshot();
+}
+
+uint32_t getSensorSnapshot(SensorData &data) {
+  uint32_t seq;
+  do {
+    seq = snapshotSeq;
+    __sync_synchronize();
+    memcpy(&data, &snapshot, sizeof(SensorData));
+    __sync_synchronize();
+  } while ((seq & 1) || seq != snapshotSeq); // Torn copy, the writer was in the middle of publishing
+  return seq / 2;
+}
+
+uint32_t getSensorSnapshotSeq() {
+  return snapshotSeq / 2;
 }
 
 void updatePreviousValues() {
@@ -138,4 +338,5 @@ void updatePreviousValues() {
   previousSensors.envHumidity = currentSensors.envHumidity;
   previousSensors.lightLevel = currentSensors.lightLevel;
   previousSensors.pumpStatus = currentSensors.pumpStatus;
+  previousSensors.validMask = currentSensors.validMask;
 }
@@ -0,0 +1,130 @@
+#include "span_trace.h"
+#include "hal.h"
+#include <atomic>
+
+#define TRACE_LINE_MAX 192  // Longest serialized piece
+
+volatile bool traceActive = true;
+static TraceEvent events[TRACE_BUFFER_EVENTS];
+static std::atomic<uint32_t> writeIndex(0);
+static uint32_t clearedAt = 0;  // Slots before this were cleared
+
+// Any task may record: the slot is claimed with one atomic add, the sequence number is
+// published last, so the exporter can skip a slot that is being written
+void traceRecord(const char* name, char phase) {
+  uint32_t slot = writeIndex.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent &event = events[slot & (TRACE_BUFFER_EVENTS - 1)];
+  __atomic_store_n(&event.seq, 0, __ATOMIC_RELAXED);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name = name;
+  event.timeUs = halMicros();
+  event.taskId = halTaskId();
+  event.phase = phase;
+  event.core = halCoreId();
+  __atomic_store_n(&event.seq, slot + 1, __ATOMIC_RELEASE);
+}
+
+void setTraceActive(bool active) {
+  traceActive = active;
+}
+
+void clearTrace() {
+  clearedAt = writeIndex.load(std::memory_order_acquire);
+}
+
+uint32_t getTraceEventCount() {
+  return writeIndex.load(std::memory_order_relaxed) - clearedAt;
+}
+
+static uint8_t taskIndex(TraceExport &exp, uint32_t taskId) {
+  for (uint8_t i = 0; i < exp.taskCount; i++) {
+    if (exp.taskIds[i] == taskId) {
+      return i;
+    }
+  }
+  if (exp.taskCount >= TRACE_MAX_TASKS) {
+    return TRACE_MAX_TASKS;
+  }
+  exp.taskIds[exp.taskCount] = taskId;
+  return exp.taskCount++;
+}
+
+void beginTraceExport(TraceExport &exp) {
+  uint32_t end = writeIndex.load(std::memory_order_acquire);
+  uint32_t start = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+  start = max(start, clearedAt);
+  uint16_t depth[TRACE_MAX_TASKS] = {};
+
+  exp.eventCount = 0;
+  exp.taskCount = 0;
+  exp.position = 0;
+  exp.done = false;
+  for (uint32_t slot = start; slot != end; slot++) {
+    const TraceEvent &event = events[slot & (TRACE_BUFFER_EVENTS - 1)];
+    if (__atomic_load_n(&event.seq, __ATOMIC_ACQUIRE) != slot + 1) {
+      continue;
+    }
+    TraceEvent copy = event;
+    if (__atomic_load_n(&event.seq, __ATOMIC_ACQUIRE) != slot + 1) {
+      continue; // Overwritten while copying
+    }
+
+    uint8_t task = taskIndex(exp, copy.taskId);
+    if (task >= TRACE_MAX_TASKS) {
+      continue;
+    }
+    // End events whose begin already left the ring would confuse the viewer
+    if (copy.phase == 'B') {
+      depth[task]++;
+    } else if (depth[task] == 0) {
+      continue;
+    } else {
+      depth[task]--;
+    }
+    exp.events[exp.eventCount++] = copy;
+  }
+}
+
+// One piece of the JSON: header, thread name metadata per task, one event, footer
+static int formatPiece(const TraceExport &exp, uint16_t position, char* line) {
+  if (position == 0) {
+    return snprintf(line, TRACE_LINE_MAX, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  }
+  uint16_t item = position - 1;
+  const char* comma = item > 0 ? "," : "";
+  if (item < exp.taskCount) {
+    return snprintf(line, TRACE_LINE_MAX, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    comma, item + 1, halTaskName(exp.taskIds[item]));
+  }
+  item -= exp.taskCount;
+  if (item < exp.eventCount) {
+    const TraceEvent &event = exp.events[item];
+    uint8_t tid = 1;
+    for (uint8_t i = 0; i < exp.taskCount; i++) {
+      if (exp.taskIds[i] == event.taskId) {
+        tid = i + 1;
+      }
+    }
+    return snprintf(line, TRACE_LINE_MAX, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}",
+                    event.name, event.phase, (unsigned long)event.timeUs, tid, event.core);
+  }
+  return snprintf(line, TRACE_LINE_MAX, "\n]}\n");
+}
+
+size_t readTraceExport(TraceExport &exp, char* buffer, size_t maxLen) {
+  uint16_t pieces = 1 + exp.taskCount + exp.eventCount + 1;
+  size_t written = 0;
+  char line[TRACE_LINE_MAX];
+  while (exp.position < pieces) {
+    int length = formatPiece(exp, exp.position, line);
+    length = min(length, TRACE_LINE_MAX - 1);
+    if (written + length > maxLen) {
+      break;
+    }
+    memcpy(buffer + written, line, length);
+    written += length;
+    exp.position++;
+  }
+  exp.done = exp.position >= pieces;
+  return written;
+}
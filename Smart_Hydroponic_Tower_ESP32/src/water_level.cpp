@@ -0,0 +1,111 @@
+#include "water_level.h"
+#include "pump_control.h"
+#include <freertos/timers.h>
+#include <hal/cpu_hal.h>
+#include <soc/gpio_struct.h>
+#include <soc/gpio_sig_map.h>
+#include <esp32/rom/gpio.h>
+
+static volatile bool interlocked = false;
+static volatile bool faultLatched = false;
+static volatile bool lockPHPumps = WATER_LEVEL_LOCK_PH_DEFAULT;
+static volatile uint32_t actuationCycles = 0;
+static WaterLevelStats stats = {};
+static TimerHandle_t debounceTimer = NULL;
+
+// Cut the pumps in the interrupt itself: route the pump pin away from the LEDC to the
+// plain GPIO output through the matrix (ROM code) and clear all pump pins in one write
+static void IRAM_ATTR forcePumpsLow() {
+  gpio_matrix_out(waterPumpPin, SIG_GPIO_OUT_IDX, false, false);
+  uint32_t mask = (1UL << waterPumpPin);
+  if (lockPHPumps) {
+    mask |= (1UL << phUpPumpPin) | (1UL << phDownPumpPin);
+  }
+  GPIO.out_w1tc = mask;
+}
+
+// Rising edge = water gone
+static void IRAM_ATTR onWaterLevelLow() {
+  uint32_t entryCycles = cpu_hal_get_cycle_count();
+  if (interlocked) {
+    return; // Already cut, the debounce timer decides what happens next
+  }
+  forcePumpsLow();
+  actuationCycles = cpu_hal_get_cycle_count() - entryCycles;
+  interlocked = true;
+
+  BaseType_t higherPriorityWoken = pdFALSE;
+  xTimerStartFromISR(debounceTimer, &higherPriorityWoken);
+  if (higherPriorityWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+// Timer service task, WATER_LEVEL_DEBOUNCE_MS after a trip
+static void confirmWaterLevel(TimerHandle_t timer) {
+  stats.trips++;
+  stats.lastTripMs = millis();
+  stats.lastActuationNs = actuationCycles * 1000UL / getCpuFrequencyMhz();
+  if (stats.lastActuationNs > stats.maxActuationNs) {
+    stats.maxActuationNs = stats.lastActuationNs;
+  }
+
+  if (digitalRead(waterLevelPin) == HIGH) {
+    faultLatched = true;
+    Serial.printf("Water level LOW - pumps interlocked (actuation %luns)\n", stats.lastActuationNs);
+  } else {
+    // Splash or noise on the line, give the outputs back
+    stats.glitches++;
+    interlocked = false;
+    reconnectPumpOutputs();
+  }
+}
+
+void initWaterLevel() {
+  pinMode(waterLevelPin, INPUT);
+  debounceTimer = xTimerCreate("waterLevel", pdMS_TO_TICKS(WATER_LEVEL_DEBOUNCE_MS), pdFALSE, NULL, confirmWaterLevel);
+  attachInterrupt(digitalPinToInterrupt(waterLevelPin), onWaterLevelLow, RISING);
+
+  // Reservoir already empty at boot
+  if (digitalRead(waterLevelPin) == HIGH) {
+    forcePumpsLow();
+    interlocked = true;
+    faultLatched = true;
+    Serial.println("Water level LOW at boot - pumps interlocked");
+  }
+}
+
+bool isPumpInterlocked() {
+  return interlocked;
+}
+
+bool isWaterLevelFault() {
+  return faultLatched;
+}
+
+bool arePHPumpsLocked() {
+  return interlocked && lockPHPumps;
+}
+
+bool clearWaterLevelFault() {
+  if (digitalRead(waterLevelPin) == HIGH) {
+    return false; // Still no water
+  }
+  faultLatched = false;
+  interlocked = false;
+  reconnectPumpOutputs();
+  Serial.println("Water level fault cleared");
+  return true;
+}
+
+void setWaterLevelPHLock(bool lock) {
+  lockPHPumps = lock;
+}
+
+WaterLevelStats getWaterLevelStats() {
+  WaterLevelStats current = stats;
+  current.interlocked = interlocked;
+  current.faultLatched = faultLatched;
+  current.lockPHPumps = lockPHPumps;
+  return current;
+}
@@ -0,0 +1,214 @@
+#include "water_temp.h"
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include <Preferences.h>
+
+OneWire oneWire(waterTempPin); // Setup a oneWire instance to communicate with any OneWire devices
+DallasTemperature sensors(&oneWire); // Pass our oneWire reference to Dallas Temperature sensor
+Preferences probePrefs; // NVS storage for the probe ROM codes
+
+// Probe registry, enumerated once so every read is addressed instead of a bus search
+static WaterProbe probes[MAX_WATER_PROBES];
+static uint8_t probeCount = 0;
+static bool rescanRequested = false;
+static const char* probeNames[MAX_WATER_PROBES] = {"reservoir", "towerTop", "rootZone"};
+
+// Split-phase acquisition state
+static bool conversionPending = false;      // A conversion was started and not collected yet
+static unsigned long conversionStart = 0;   // millis() when the pending conversion was requested
+static uint8_t resolution = WATER_TEMP_RESOLUTION_DEFAULT;
+static uint8_t requestedResolution = WATER_TEMP_RESOLUTION_DEFAULT;
+
+static WaterTempTiming timing = {
+  .resolution = WATER_TEMP_RESOLUTION_DEFAULT,
+  .conversionTimeMs = 750,
+  .requestUs = 0,
+  .readUs = 0,
+  .maxRequestUs = 0,
+  .maxReadUs = 0,
+  .conversionMs = 0,
+  .readCount = 0
+};
+
+static void loadProbeAddresses(uint8_t stored[MAX_WATER_PROBES][8]) {
+  memset(stored, 0, MAX_WATER_PROBES * 8);
+  probePrefs.begin("watertemp", true);
+  probePrefs.getBytes("rom", stored, MAX_WATER_PROBES * 8);
+  probePrefs.end();
+}
+
+static void saveProbeAddresses() {
+  uint8_t stored[MAX_WATER_PROBES][8];
+  memset(stored, 0, sizeof(stored));
+  for (int i = 0; i < MAX_WATER_PROBES; i++) {
+    if (probes[i].assigned) {
+      memcpy(stored[i], probes[i].address, 8);
+    }
+  }
+  probePrefs.begin("watertemp", false);
+  probePrefs.putBytes("rom", stored, sizeof(stored));
+  probePrefs.end();
+}
+
+static int findProbeSlot(const uint8_t *address) {
+  for (int i = 0; i < MAX_WATER_PROBES; i++) {
+    if (probes[i].assigned && memcmp(probes[i].address, address, 8) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Enumerate the bus and match the found ROM codes to their stored slots
+static void scanProbes(bool forgetStored) {
+  uint8_t stored[MAX_WATER_PROBES][8];
+  if (forgetStored) {
+    memset(stored, 0, sizeof(stored));
+  } else {
+    loadProbeAddresses(stored);
+  }
+
+  static const uint8_t emptyAddress[8] = {0};
+  for (int i = 0; i < MAX_WATER_PROBES; i++) {
+    memcpy(probes[i].address, stored[i], 8);
+    probes[i].assigned = memcmp(stored[i], emptyAddress, 8) != 0;
+    probes[i].present = false;
+  }
+
+  sensors.begin(); // Full bus search, only done here
+  sensors.setWaitForConversion(false);
+  bool changed = forgetStored;
+  probeCount = 0;
+
+  DeviceAddress address;
+  for (uint8_t i = 0; i < sensors.getDeviceCount(); i++) {
+    if (!sensors.getAddress(address, i)) {
+      continue;
+    }
+    int slot = findProbeSlot(address);
+    if (slot < 0) {
+      // New probe - give it the first free slot
+      for (int j = 0; j < MAX_WATER_PROBES; j++) {
+        if (!probes[j].assigned) {
+          memcpy(probes[j].address, address, 8);
+          probes[j].assigned = true;
+          slot = j;
+          changed = true;
+          break;
+        }
+      }
+    }
+    if (slot < 0) {
+      Serial.println("Water temp: no free probe slot, extra probe ignored");
+      continue;
+    }
+    probes[slot].present = true;
+    probeCount++;
+  }
+
+  if (changed) {
+    saveProbeAddresses();
+  }
+  Serial.printf("Water temp: %d probe(s) registered\n", probeCount);
+}
+
+// Start a conversion without waiting for it to finish
+static void startConversion() {
+  unsigned long startUs = micros();
+
+  if (rescanRequested) {
+    rescanRequested = false;
+    scanProbes(true);
+    sensors.setResolution(resolution);
+  }
+
+  // Resolution changes are only written to the sensor between conversions
+  if (requestedResolution != resolution) {
+    sensors.setResolution(requestedResolution);
+    resolution = requestedResolution;
+    timing.resolution = resolution;
+    timing.conversionTimeMs = sensors.millisToWaitForConversion(resolution);
+  }
+
+  sensors.requestTemperatures(); // One broadcast conversion for every probe, returns immediately
+  conversionStart = millis();
+  conversionPending = true;
+
+  timing.requestUs = micros() - startUs;
+  if (timing.requestUs > timing.maxRequestUs) {
+    timing.maxRequestUs = timing.requestUs;
+  }
+}
+
+void initWaterTemp() {
+  scanProbes(false); // Enumerate the bus once and restore the stored probe slots
+  sensors.setResolution(resolution);
+  sensors.setWaitForConversion(false); // requestTemperatures() must not block the control loop
+  timing.conversionTimeMs = sensors.millisToWaitForConversion(resolution);
+
+  startConversion(); // First result is collected on the next tick
+}
+
+bool updateWaterTemp(float temperatures[MAX_WATER_PROBES]) {
+  if (!conversionPending) {
+    startConversion();
+    return false;
+  }
+
+  // Wait for the datasheet conversion time unless the sensor already signals completion
+  unsigned long elapsed = millis() - conversionStart;
+  if (elapsed < timing.conversionTimeMs && !sensors.isConversionComplete()) {
+    return false;
+  }
+
+  unsigned long startUs = micros();
+  for (int i = 0; i < MAX_WATER_PROBES; i++) {
+    // Addressed scratchpad read, no bus search per probe
+    temperatures[i] = probes[i].present ? sensors.getTempC(probes[i].address) : WATER_TEMP_DISCONNECTED;
+  }
+  conversionPending = false;
+
+  timing.readUs = micros() - startUs;
+  if (timing.readUs > timing.maxReadUs) {
+    timing.maxReadUs = timing.readUs;
+  }
+  timing.conversionMs = elapsed;
+  timing.readCount++;
+
+  startConversion(); // Next result is ready by the following tick
+  return true;
+}
+
+bool setWaterTempResolution(int bits) {
+  if (bits < 9 || bits > 12) {
+    return false;
+  }
+  requestedResolution = bits;
+  Serial.printf("Water temp resolution set to %d bit\n", bits);
+  return true;
+}
+
+uint8_t getWaterTempResolution() {
+  return requestedResolution;
+}
+
+void rescanWaterProbes() {
+  rescanRequested = true; // Done between conversions by startConversion()
+  Serial.println("Water temp probe rescan requested");
+}
+
+WaterTempTiming getWaterTempTiming() {
+  return timing;
+}
+
+WaterProbe getWaterProbe(uint8_t slot) {
+  return probes[slot < MAX_WATER_PROBES ? slot : 0];
+}
+
+const char* getWaterProbeName(uint8_t slot) {
+  return slot < MAX_WATER_PROBES ? probeNames[slot] : "unknown";
+}
+
+uint8_t getWaterProbeCount() {
+  return probeCount;
+}
@@ -3,6 +3,23 @@
 #include "web_page.h"
 #include "pump_control.h"
 #include "data_logger.h"
+#include "http_client.h"
+#include "water_temp.h"
+#include "co2_sensor.h"
+#include "dht_sensor.h"
+#include "adc_sampler.h"
+#include "sensor_health.h"
+#include "sensor_scheduler.h"
+#include "water_level.h"
+#include "calibration.h"
+#include "self_bench.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
+#include "span_trace.h"
+#include "metrics.h"
+#include "hal.h"
+#include <memory>
+#include <new>
 
 // WiFi credentials - UPDATE THESE FOR DIFFERENT NETWORKS!
 const char* ssid = "WLAN-NAME";
@@ -18,23 +35,249 @@ IPAddress secondaryDNS(160, 40, 50, 1);   // Secondary DNS (optional)
 // Create AsyncWebServer object on port 80
 AsyncWebServer server(80);
 
-String getSensorDataJSON() {
-  StaticJsonDocument<350> doc;
-
-  // Add sensor data to JSON with rounded values
-  doc["lightLevel"] = round(currentSensors.lightLevel * 1);            // 0 decimal places
-  doc["envTemp"] = round(currentSensors.envTemp * 100) / 100.0;        // 2 decimal place
-  doc["envHum"] = round(currentSensors.envHumidity * 1);               // 0 decimal place
-  doc["CO2"] = currentSensors.co2Level;                                // Keep as integer
-  doc["waterTemp"] = round(currentSensors.waterTemp * 10) / 10.0;      // 1 decimal place
-  doc["phLevel"] = round(currentSensors.waterPH * 100) / 100.0;        // 2 decimal places
-  doc["ecLevel"] = round(currentSensors.waterEC * 100) / 100.0;        // 2 decimal places
-  doc["waterLevel"] = currentSensors.waterLevel;                       // Keep as boolean
-  doc["pumpStatus"] = currentSensors.pumpStatus;                       // Add pump status
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  return jsonString;
+// Trace span, request count and latency for /metrics and heap attribution, first line of every handler
+#define ROUTE_SPAN(route) TRACE_SPAN(route); RouteTimer routeTimer(route); HEAP_SCOPE(HEAP_WEB)
+
+// Push channel for dashboards: the combined state once per control tick when it changed,
+// control commands the other way (see handleLiveCommand)
+AsyncWebSocket ws("/ws");
+
+// /state ETags: the version counts control ticks in which anything in the combined state
+// changed, and each field keeps the version and content hash of its own last change. A
+// projection stays 304 while only fields outside it move (the pump and pH status texts
+// count down every second). The hash keeps an ETag from before a reboot from matching a
+// different state under the same version.
+struct StateFieldTag {
+  uint32_t version;
+  uint32_t hash;
+};
+
+// The tags and serialized value of every field as of the last tick that changed anything.
+// /state builds both its ETag and its body from this copy, so a 200 carries the tag of
+// the content it sends and a 304 is only served while that content is still current.
+#define STATE_TEXT_SIZE 1024          // Values of the full state take about 500 bytes
+struct LiveStateSnapshot {
+  uint32_t version;
+  StateFieldTag tags[STATE_FIELD_COUNT];
+  uint16_t offset[STATE_FIELD_COUNT]; // Into text, each value null-terminated
+  char text[STATE_TEXT_SIZE];
+};
+static LiveStateSnapshot stagedState;       // Control task only, built by updateLiveState()
+static LiveStateSnapshot liveState;         // Published copy read by the web server task
+static volatile uint32_t liveStateSeq = 0;  // Odd while updateLiveState() writes liveState
+
+static uint32_t fnv1a(const char* data, size_t len, uint32_t hash = 2166136261u) {
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// {"section":{"key":value,...},...} for the fields in mask, from the snapshot's text
+static void appendStateBody(const LiveStateSnapshot &state, StateFieldMask mask, String &body) {
+  const char* section = NULL;
+  body = "{";
+  for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+    if (!(mask & ((StateFieldMask)1 << i))) {
+      continue;
+    }
+    if (section == NULL || strcmp(section, stateFields[i].section) != 0) {
+      if (section != NULL) {
+        body += "},";
+      }
+      section = stateFields[i].section;
+      body += "\"";
+      body += section;
+      body += "\":{";
+    } else {
+      body += ",";
+    }
+    body += "\"";
+    body += stateFields[i].key;
+    body += "\":";
+    body += state.text + state.offset[i];
+  }
+  if (section != NULL) {
+    body += "}";
+  }
+  body += "}";
+}
+
+// Read from the web server task, same retry-on-torn-copy scheme as getSensorSnapshot().
+// The body is only built when asked for (not for a 304). False before the first tick.
+static bool readLiveState(StateFieldMask mask, String &etag, String *body) {
+  uint32_t seq;
+  uint32_t version;
+  uint32_t hash;
+  do {
+    seq = liveStateSeq;
+    __sync_synchronize();
+    version = 0;
+    hash = 2166136261u;
+    for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+      if (mask & ((StateFieldMask)1 << i)) {
+        version = max(version, liveState.tags[i].version);
+        hash = fnv1a((const char*)&liveState.tags[i].hash, sizeof(liveState.tags[i].hash), hash);
+      }
+    }
+    if (body != NULL && liveState.version > 0) {
+      appendStateBody(liveState, mask, *body);
+    }
+    __sync_synchronize();
+  } while ((seq & 1) || seq != liveStateSeq);
+
+  if (version == 0) {
+    return false;
+  }
+  char tag[24];
+  snprintf(tag, sizeof(tag), "\"%lx-%08lx\"", (unsigned long)version, (unsigned long)hash);
+  etag = tag;
+  return true;
+}
+
+// A filler's 0 ends a chunked response, and maxLen is the TCP send space (can be a few
+// bytes after a small ACK). While the export has more but nothing fit, ask to be called again.
+static size_t chunkOrRetry(size_t length, bool done) {
+  return length > 0 || done ? length : RESPONSE_TRY_AGAIN;
+}
+
+static void sendCommandResult(AsyncWebSocketClient *client, const char* cmd, long id, bool ok, const String &message) {
+  StaticJsonDocument<256> doc;
+  doc["type"] = "result";
+  doc["cmd"] = cmd;
+  if (id >= 0) {
+    doc["id"] = id;
+  }
+  doc["ok"] = ok;
+  doc["message"] = message;
+  String json;
+  serializeJson(doc, json);
+  client->text(json);
+}
+
+// {"cmd":"...", "id":n} with the same parameters as the HTTP routes, answered with
+// {"type":"result"} to the sender and a fresh state to every client
+static void handleLiveCommand(AsyncWebSocketClient *client, const char* data, size_t len) {
+  ROUTE_SPAN("WS /ws");
+  StaticJsonDocument<WS_COMMAND_MAX> doc;
+  if (deserializeJson(doc, data, len) || !doc["cmd"].is<const char*>()) {
+    sendCommandResult(client, "", -1, false, "Expected {\"cmd\":...}");
+    return;
+  }
+  String cmd = doc["cmd"].as<const char*>();
+  long id = doc["id"].is<long>() ? doc["id"].as<long>() : -1;
+  bool ok = true;
+  String message;
+
+  if (cmd == "pumpToggle") {
+    togglePump();
+    message = String("Pump toggled: ") + (getPumpState() ? "ON" : "OFF");
+  } else if (cmd == "pumpState") {
+    setPumpState(doc["state"].as<bool>());
+    message = String("Pump ") + (getPumpState() ? "ON" : "OFF");
+  } else if (cmd == "pumpConfig") {
+    if (doc["autoMode"].is<bool>()) {
+      enableAutoMode(doc["autoMode"].as<bool>());
+    }
+    if (doc["onTime"].is<int>() && doc["offTime"].is<int>()) {
+      setPumpTiming(doc["onTime"].as<int>(), doc["offTime"].as<int>());
+    }
+    message = "Configuration updated";
+  } else if (cmd == "phUp") {
+    togglePHUp();
+    message = "pH UP pump toggled";
+  } else if (cmd == "phDown") {
+    togglePHDown();
+    message = "pH DOWN pump toggled";
+  } else if (cmd == "phStop") {
+    stopPHPumps();
+    message = "pH pumps stopped";
+  } else if (cmd == "phConfig") {
+    if (doc["autoMode"].is<bool>()) {
+      enablePHAutoMode(doc["autoMode"].as<bool>());
+    }
+    if (!doc["target"].isNull() && !doc["tolerance"].isNull()) {
+      setPHTarget(doc["target"].as<float>(), doc["tolerance"].as<float>());
+      enablePHAutoMode(true);  // Enable auto mode when updating configuration, as PUT /ph/config
+    }
+    message = "pH configuration updated";
+  } else if (cmd == "logEnable") {
+    enableDataLogger(doc["enabled"].as<bool>());
+    message = String("Data logging ") + (isDataLoggerEnabled() ? "enabled" : "disabled");
+  } else if (cmd == "logTrigger") {
+    triggerManualLog();
+    message = "Manual upload triggered";
+  } else {
+    ok = false;
+    message = "Unknown command";
+  }
+
+  sendCommandResult(client, cmd.c_str(), id, ok, message);
+  if (ok) {
+    ws.textAll(getLiveStateJSON());
+  }
+}
+
+static void onLiveEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                        void *arg, uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    HEAP_SCOPE(HEAP_WEB);
+    client->text(getLiveStateJSON()); // Current state right away, not at the next change
+  } else if (type == WS_EVT_DATA) {
+    // Only whole single-frame text messages, commands are short
+    AwsFrameInfo *info = (AwsFrameInfo*)arg;
+    if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT && len <= WS_COMMAND_MAX) {
+      handleLiveCommand(client, (const char*)data, len);
+    }
+  }
+}
+
+void updateLiveState() {
+  HEAP_SCOPE(HEAP_WEB);
+  DynamicJsonDocument doc(STATE_JSON_CAPACITY);
+  doc["type"] = "state";
+  buildLiveState(doc);
+
+  uint32_t hashes[STATE_FIELD_COUNT];
+  size_t used = 0;
+  bool changed = false;
+  for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+    JsonVariant value = doc[stateFields[i].section][stateFields[i].key];
+    if (used + measureJson(value) >= STATE_TEXT_SIZE) {
+      Serial.println("Live state exceeds STATE_TEXT_SIZE, /state keeps the previous tick");
+      return;
+    }
+    char* text = stagedState.text + used;
+    size_t len = serializeJson(value, text, STATE_TEXT_SIZE - used);
+    stagedState.offset[i] = used;
+    used += len + 1;
+    hashes[i] = fnv1a(text, len);
+    changed = changed || hashes[i] != stagedState.tags[i].hash;
+  }
+  if (!changed) {
+    return;
+  }
+
+  stagedState.version++;
+  for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+    if (hashes[i] != stagedState.tags[i].hash) {
+      stagedState.tags[i].version = stagedState.version;
+      stagedState.tags[i].hash = hashes[i];
+    }
+  }
+  halEnterCritical(); // Same as publishSensorSnapshot(): a preempting reader would spin on the odd sequence
+  liveStateSeq++;
+  __sync_synchronize();
+  memcpy(&liveState, &stagedState, sizeof(liveState));
+  __sync_synchronize();
+  liveStateSeq++;
+  halExitCritical();
+
+  if (ws.count() > 0) {
+    String state;
+    serializeJson(doc, state);
+    ws.textAll(state);
+  }
 }
 
 void initWiFi() {
@@ -47,6 +290,7 @@ void initWiFi() {
     Serial.println(WiFi.localIP());
   }//*/
 
+  initNetworkMonitor();
   WiFi.begin(ssid, password);
   Serial.print("Connecting to WiFi");
   
@@ -74,11 +318,103 @@ void initWiFi() {
 
   
   // Setup web server routes
+  ws.onEvent(onLiveEvent);
+  server.addHandler(&ws);
+
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /");
     request->send_P(200, "text/html", index_html);
   });
   
+  // WATER TEMPERATURE ROUTES (registered before "/sensors", which also matches its sub-paths)
+  // GET DS18B20 acquisition timing
+  server.on("/sensors/watertemp", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /sensors/watertemp");
+    String json = getWaterTempTimingJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PUT for changing the DS18B20 resolution (9-12 bit) or re-enumerating the probes
+  server.on("/sensors/watertemp", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /sensors/watertemp");
+    // Validate before acting, a rejected request must not have re-enumerated the bus
+    if (request->hasParam("resolution")) {
+      int bits = request->getParam("resolution")->value().toInt();
+      if (!setWaterTempResolution(bits)) {
+        AsyncWebServerResponse *response = request->beginResponse(400, "application/json", "{\"message\":\"Resolution must be 9-12 bit\"}");
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        request->send(response);
+        return;
+      }
+    }
+    if (request->hasParam("rescan") && request->getParam("rescan")->value() == "true") {
+      rescanWaterProbes();
+    }
+    String json = getWaterTempTimingJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET MH-Z19 driver counters
+  server.on("/sensors/co2", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /sensors/co2");
+    String json = getCO2StatsJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET DHT22 driver counters
+  server.on("/sensors/dht", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /sensors/dht");
+    String json = getDHTStatsJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PUT for switching the DHT22 backend (rmt or adafruit)
+  server.on("/sensors/dht", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /sensors/dht");
+    if (request->hasParam("backend")) {
+      String backendParam = request->getParam("backend")->value();
+      uint8_t backend = (backendParam == "adafruit") ? DHT_BACKEND_ADAFRUIT : DHT_BACKEND_RMT;
+      if ((backendParam != "rmt" && backendParam != "adafruit") || !setDHTBackend(backend)) {
+        AsyncWebServerResponse *response = request->beginResponse(400, "application/json", "{\"message\":\"Backend must be rmt or adafruit\"}");
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        request->send(response);
+        return;
+      }
+    }
+    String json = getDHTStatsJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET pH/EC sampler rate and per-window statistics
+  server.on("/sensors/adc", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /sensors/adc");
+    String json = getAdcSamplerJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET per-sensor health (validity, last error, back-off state)
+  server.on("/sensors/health", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /sensors/health");
+    String json = getSensorHealthJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
   server.on("/sensors", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /sensors");
     String json = getSensorDataJSON();
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
     response->addHeader("Access-Control-Allow-Origin", "*");
@@ -87,15 +423,318 @@ void initWiFi() {
     request->send(response);
   });
 
+  // Combined state in one request: /sensors (without seq), /pump/status, /ph/status and
+  // /api/log/status as of the last control tick. ?fields=sensors,pump.autoMode projects it;
+  // If-None-Match with the ETag of the same projection is answered with 304 and no body.
+  server.on("/state", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /state");
+    String fields = request->hasParam("fields") ? request->getParam("fields")->value() : String();
+    StateFieldMask mask = STATE_FIELDS_ALL;
+    if (fields.length() && !parseStateFields(fields, mask)) {
+      AsyncWebServerResponse *response = request->beginResponse(400, "application/json", "{\"message\":\"Unknown field, expected sensors, pump, ph, logger or section.key\"}");
+      response->addHeader("Access-Control-Allow-Origin", "*");
+      request->send(response);
+      return;
+    }
+    String etag;
+    if (!readLiveState(mask, etag, NULL)) {
+      AsyncWebServerResponse *response = request->beginResponse(503, "application/json", "{\"message\":\"State not ready, retry after the first control tick\"}");
+      response->addHeader("Retry-After", "1");
+      response->addHeader("Access-Control-Allow-Origin", "*");
+      request->send(response);
+      return;
+    }
+
+    if (request->hasHeader("If-None-Match")) {
+      String match = request->getHeader("If-None-Match")->value();
+      if (match == "*" || match.indexOf(etag) >= 0) {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", etag);
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        response->addHeader("Access-Control-Expose-Headers", "ETag");
+        request->send(response);
+        return;
+      }
+    }
+
+    String body;
+    readLiveState(mask, etag, &body);  // Tag and body from the same tick, may be newer than above
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", body);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache"); // Browsers revalidate with If-None-Match
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    response->addHeader("Access-Control-Expose-Headers", "ETag");
+    request->send(response);
+  });
+
+  // SENSOR SCHEDULER ROUTES
+  // GET per-sensor periods, measured read cost and worst-case tick duration
+  server.on("/scheduler", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /scheduler");
+    String json = getSchedulerJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PUT for changing a sensor's read period (?task=co2&period=10000) or clearing the worst-case stats
+  server.on("/scheduler", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /scheduler");
+    if (request->hasParam("resetStats") && request->getParam("resetStats")->value() == "true") {
+      resetSchedulerStats();
+    }
+    if (request->hasParam("task") && request->hasParam("period")) {
+      String task = request->getParam("task")->value();
+      long period = request->getParam("period")->value().toInt();
+      if (period <= 0 || !setSensorTaskPeriod(task.c_str(), period)) {
+        AsyncWebServerResponse *response = request->beginResponse(400, "application/json", "{\"message\":\"Unknown task or invalid period\"}");
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        request->send(response);
+        return;
+      }
+    }
+    String json = getSchedulerJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // SELF BENCHMARK ROUTES
+  // GET the state and min/mean/p99/max per item of the last (or running) benchmark
+  server.on("/bench", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /bench");
+    String json = getSelfBenchJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // POST to start a benchmark (?upload=true adds Supabase round trips), poll GET /bench for the result
+  server.on("/bench", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /bench");
+    bool upload = request->hasParam("upload") && request->getParam("upload")->value() == "true";
+    if (!startSelfBench(upload)) {
+      AsyncWebServerResponse *response = request->beginResponse(409, "application/json", "{\"message\":\"Benchmark already running\"}");
+      response->addHeader("Access-Control-Allow-Origin", "*");
+      request->send(response);
+      return;
+    }
+    String json = getSelfBenchJSON();
+    AsyncWebServerResponse *response = request->beginResponse(202, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // CONTROL LOOP PROFILE ROUTES
+  // GET control tick lateness, stage durations, loop section worst cases and the stall log
+  server.on("/profile", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /profile");
+    String json = getLoopProfileJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PUT ?resetStats=true to start a new measurement (e.g. before and after a scheduling change)
+  server.on("/profile", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /profile");
+    if (request->hasParam("resetStats") && request->getParam("resetStats")->value() == "true") {
+      resetLoopProfile();
+    }
+    String json = getLoopProfileJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // HEAP DIAGNOSTICS ROUTES
+  // GET the heap history as CSV (one row every 5 minutes, with the request count), streamed in chunks
+  server.on("/diagnostics/samples", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /diagnostics/samples");
+    std::shared_ptr<HeapSamplesExport> exp(new HeapSamplesExport);
+    beginHeapSamplesExport(*exp);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+      [exp](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t length = readHeapSamplesExport(*exp, (char*)buffer, maxLen);
+        return chunkOrRetry(length, exp->done);
+      });
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET reset reason, free/minimum/largest block heap, fragmentation, task stack high-water marks
+  // and allocations per subsystem (with HEAP_TRACKING)
+  server.on("/diagnostics", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /diagnostics");
+    String json = getHeapDiagnosticsJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PROMETHEUS METRICS
+  // GET every firmware metric in text exposition format, streamed in chunks
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /metrics");
+    std::shared_ptr<MetricsExport> exp(new MetricsExport);
+    beginMetricsExport(*exp);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain; version=0.0.4",
+      [exp](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t length = readMetricsExport(*exp, (char*)buffer, maxLen);
+        return chunkOrRetry(length, exp->done);
+      });
+    request->send(response);
+  });
+
+  // SPAN TRACE ROUTES
+  // GET the ring buffer as Chrome trace_event JSON (load into ui.perfetto.dev), streamed in chunks
+  server.on("/trace", HTTP_GET, [](AsyncWebServerRequest *request){
+    // About 10 KB in one block, a fragmented heap gets a 503 instead of an abort
+    std::shared_ptr<TraceExport> exp(new (std::nothrow) TraceExport);
+    if (!exp) {
+      AsyncWebServerResponse *response = request->beginResponse(503, "application/json", "{\"message\":\"Not enough contiguous heap for the trace export\"}");
+      response->addHeader("Access-Control-Allow-Origin", "*");
+      request->send(response);
+      return;
+    }
+    beginTraceExport(*exp);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [exp](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t length = readTraceExport(*exp, (char*)buffer, maxLen);
+        return chunkOrRetry(length, exp->done);
+      });
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PUT to pause or resume recording (?enabled=false), DELETE to drop the recorded events
+  server.on("/trace", HTTP_PUT, [](AsyncWebServerRequest *request){
+    if (request->hasParam("enabled")) {
+      setTraceActive(request->getParam("enabled")->value() == "true");
+    }
+    String json = "{\"enabled\":" + String(traceActive ? "true" : "false") +
+                  ",\"events\":" + String(getTraceEventCount()) +
+                  ",\"capacity\":" + String(TRACE_BUFFER_EVENTS) + "}";
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  server.on("/trace", HTTP_DELETE, [](AsyncWebServerRequest *request){
+    clearTrace();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", "{\"message\":\"Trace cleared\"}");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // CALIBRATION ROUTES (sub-paths registered before "/calibration")
+  // POST to capture a pH buffer point from the current averaged reading (?buffer=4.00)
+  server.on("/calibration/ph", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /calibration/ph");
+    float buffer = request->hasParam("buffer") ? request->getParam("buffer")->value().toFloat() : 0;
+    if (!calibratePH(buffer, readCalibrationCode(ADC_CHANNEL_PH))) {
+      AsyncWebServerResponse *response = request->beginResponse(400, "application/json", "{\"message\":\"Invalid buffer or probe reading\"}");
+      response->addHeader("Access-Control-Allow-Origin", "*");
+      request->send(response);
+      return;
+    }
+    String json = getCalibrationJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // DELETE to forget the pH buffer points
+  server.on("/calibration/ph", HTTP_DELETE, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("DELETE /calibration/ph");
+    resetPHCalibration();
+    String json = getCalibrationJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // POST to capture an EC standard (?standard=1.413 mS/cm), compensated with the reservoir temperature
+  server.on("/calibration/ec", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /calibration/ec");
+    float standard = request->hasParam("standard") ? request->getParam("standard")->value().toFloat() : 0;
+    SensorData sensors;
+    getSensorSnapshot(sensors);
+    float temperature = isSensorValid(sensors, SENSOR_VALID_WATER_TEMP) ? sensors.waterTemp : 25;
+    if (!calibrateEC(standard, readCalibrationCode(ADC_CHANNEL_EC), temperature)) {
+      AsyncWebServerResponse *response = request->beginResponse(400, "application/json", "{\"message\":\"Invalid standard or probe reading\"}");
+      response->addHeader("Access-Control-Allow-Origin", "*");
+      request->send(response);
+      return;
+    }
+    String json = getCalibrationJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // DELETE to reset the EC k-values
+  server.on("/calibration/ec", HTTP_DELETE, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("DELETE /calibration/ec");
+    resetECCalibration();
+    String json = getCalibrationJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET ADC characterization, pH buffer points and EC k-values
+  server.on("/calibration", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /calibration");
+    String json = getCalibrationJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
   // PUMP CONTROL ROUTES
   // GET for reading pump status
   server.on("/pump/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /pump/status");
     PumpConfig config = getPumpConfig();
     String json = "{\"pumpStatus\":" + String(getPumpState() ? "true" : "false") + 
                   ",\"statusText\":\"" + getPumpStatusString() + "\"" +
                   ",\"autoMode\":" + String(config.autoMode ? "true" : "false") +
                   ",\"onTime\":" + String(config.onTime/60000) +
-                  ",\"offTime\":" + String(config.offTime/60000) + "}";
+                  ",\"offTime\":" + String(config.offTime/60000) +
+                  ",\"waterLevelFault\":" + String(isWaterLevelFault() ? "true" : "false") +
+                  ",\"interlocked\":" + String(isPumpInterlocked() ? "true" : "false") + "}";
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // POST to clear a latched water level fault (refused while the reservoir is still low)
+  server.on("/pump/interlock/clear", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /pump/interlock/clear");
+    bool cleared = clearWaterLevelFault();
+    String json = getWaterLevelJSON();
+    AsyncWebServerResponse *response = request->beginResponse(cleared ? 200 : 409, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // GET water level interlock state and edge-to-actuation timing
+  server.on("/pump/interlock", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /pump/interlock");
+    String json = getWaterLevelJSON();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // PUT for choosing whether the interlock also cuts the pH pumps (?lockPH=true|false)
+  server.on("/pump/interlock", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /pump/interlock");
+    if (request->hasParam("lockPH")) {
+      setWaterLevelPHLock(request->getParam("lockPH")->value() == "true");
+    }
+    String json = getWaterLevelJSON();
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
     response->addHeader("Access-Control-Allow-Origin", "*");
     request->send(response);
@@ -103,6 +742,7 @@ void initWiFi() {
 
   // POST for changing pump state
   server.on("/pump/toggle", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /pump/toggle");
     togglePump();
     String json = "{\"pumpStatus\":" + String(getPumpState() ? "true" : "false") + 
                   ",\"statusText\":\"" + getPumpStatusString() + "\"}";
@@ -113,6 +753,7 @@ void initWiFi() {
 
   // PUT for updating pump state
   server.on("/pump/state", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /pump/state");
     if (request->hasParam("state")) {
       String stateParam = request->getParam("state")->value();
       bool newState = (stateParam == "on" || stateParam == "1" || stateParam == "true");
@@ -127,6 +768,7 @@ void initWiFi() {
 
   // PUT for updating pump configuration
   server.on("/pump/config", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /pump/config");
     // Handle auto mode
     if (request->hasParam("autoMode")) {
       bool enable = request->getParam("autoMode")->value() == "true";
@@ -153,6 +795,7 @@ void initWiFi() {
   // PH CONTROL ROUTES
   // GET pH control status and configuration
   server.on("/ph/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /ph/status");
     PHConfig config = getPHConfig();
     String json = "{\"phStatus\":" + String(getPHUpState() ? "true" : "false") + 
                   ",\"phDownStatus\":" + String(getPHDownState() ? "true" : "false") +
@@ -167,6 +810,7 @@ void initWiFi() {
 
   // POST to toggle pH UP pump (manual mode)
   server.on("/ph/up", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /ph/up");
     togglePHUp();
     String json = "{\"message\":\"pH UP pump toggled\",\"phUpStatus\":" + String(getPHUpState() ? "true" : "false") + 
                   ",\"status\":\"" + getPHControlStatus() + "\"}";
@@ -177,6 +821,7 @@ void initWiFi() {
 
   // POST to toggle pH DOWN pump (manual mode)
   server.on("/ph/down", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /ph/down");
     togglePHDown();
     String json = "{\"message\":\"pH DOWN pump toggled\",\"phDownStatus\":" + String(getPHDownState() ? "true" : "false") + 
                   ",\"status\":\"" + getPHControlStatus() + "\"}";
@@ -187,6 +832,7 @@ void initWiFi() {
 
   // POST to stop pH pumps (manual mode)
   server.on("/ph/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /ph/stop");
     stopPHPumps();
     String json = "{\"message\":\"pH pumps stopped\",\"status\":\"" + getPHControlStatus() + "\"}";
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
@@ -196,6 +842,7 @@ void initWiFi() {
 
   // PUT for updating pH configuration
   server.on("/ph/config", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /ph/config");
     // Handle auto mode
     if (request->hasParam("autoMode")) {
       bool enable = request->getParam("autoMode")->value() == "true";
@@ -224,6 +871,7 @@ void initWiFi() {
   
   // Get logging status
   server.on("/logger/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /logger/status");
     String json = "{\"enabled\":" + String(isDataLoggerEnabled() ? "true" : "false") + 
                   ",\"status\":\"" + getLoggerStatus() + "\"" +
                   ",\"failedUploads\":" + String(getFailedUploadCount()) + "}";
@@ -234,6 +882,7 @@ void initWiFi() {
 
   // Toggle logger on/off
   server.on("/logger/toggle", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /logger/toggle");
     enableDataLogger(!isDataLoggerEnabled());
     String json = "{\"enabled\":" + String(isDataLoggerEnabled() ? "true" : "false") + 
                   ",\"message\":\"Logger " + String(isDataLoggerEnabled() ? "enabled" : "disabled") + "\"}";
@@ -244,6 +893,7 @@ void initWiFi() {
 
   // Manual log trigger
   server.on("/logger/log", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /logger/log");
     triggerManualLog();
     String json = "{\"message\":\"Manual log triggered\",\"status\":\"" + getLoggerStatus() + "\"}";
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
@@ -255,6 +905,7 @@ void initWiFi() {
   
   // Get logging status - /api/log/status
   server.on("/api/log/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("GET /api/log/status");
     String json = "{\"enabled\":" + String(isDataLoggerEnabled() ? "true" : "false") + 
                   ",\"lastStatus\":\"" + getLoggerStatus() + "\"" +
                   ",\"successfulUploads\":" + String(getSuccessfulUploadCount()) +
@@ -266,6 +917,7 @@ void initWiFi() {
 
   // Enable/disable logger - /api/log/enable?enabled=true/false
   server.on("/api/log/enable", HTTP_PUT, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("PUT /api/log/enable");
     bool enable = false;
     if (request->hasParam("enabled")) {
       String enableParam = request->getParam("enabled")->value();
@@ -281,6 +933,7 @@ void initWiFi() {
 
   // Manual log trigger - /api/log/trigger
   server.on("/api/log/trigger", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /api/log/trigger");
     triggerManualLog();
     String json = "{\"message\":\"Manual upload triggered\",\"status\":\"" + getLoggerStatus() + "\"}";
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
@@ -290,6 +943,7 @@ void initWiFi() {
 
   // Connection test - /api/log/test
   server.on("/api/log/test", HTTP_POST, [](AsyncWebServerRequest *request){
+    ROUTE_SPAN("POST /api/log/test");
     // Simple connection test - just check WiFi status
     bool connected = (WiFi.status() == WL_CONNECTED);
     String json = "{\"success\":" + String(connected ? "true" : "false") + 
@@ -300,10 +954,26 @@ void initWiFi() {
   });
 
   // Handle OPTIONS for CORS
+  server.on("/sensors/watertemp", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/sensors/co2", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/sensors/dht", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/sensors/adc", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/sensors/health", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/scheduler", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/bench", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/profile", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/diagnostics/samples", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/diagnostics", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/trace", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/calibration/ph", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/calibration/ec", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/calibration", HTTP_OPTIONS, handleCORSOptions);
   server.on("/pump/toggle", HTTP_OPTIONS, handleCORSOptions);
   server.on("/pump/state", HTTP_OPTIONS, handleCORSOptions);
   server.on("/pump/config", HTTP_OPTIONS, handleCORSOptions);
   server.on("/pump/status", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/pump/interlock/clear", HTTP_OPTIONS, handleCORSOptions);
+  server.on("/pump/interlock", HTTP_OPTIONS, handleCORSOptions);
   server.on("/ph/up", HTTP_OPTIONS, handleCORSOptions);
   server.on("/ph/down", HTTP_OPTIONS, handleCORSOptions);
   server.on("/ph/stop", HTTP_OPTIONS, handleCORSOptions);
@@ -333,6 +1003,14 @@ void initWiFi() {
     request->send(response);
   });
   
+  server.on("/state", HTTP_OPTIONS, [](AsyncWebServerRequest *request){
+    AsyncWebServerResponse *response = request->beginResponse(200);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    response->addHeader("Access-Control-Allow-Methods", "GET, OPTIONS");
+    response->addHeader("Access-Control-Allow-Headers", "Content-Type, If-None-Match");
+    request->send(response);
+  });
+  
   server.begin();
   Serial.println("HTTP server started");
     Serial.print("Access a simple dashboard at: http://");
@@ -340,8 +1018,8 @@ void initWiFi() {
 }
 
 void handleWebServer() {
-  // This function can be used for any additional web server handling if needed
-  // The AsyncWebServer handles requests automatically, so this might be empty
+  // The AsyncWebServer handles requests automatically, only closed /ws clients need freeing
+  ws.cleanupClients(WS_MAX_CLIENTS);
 }
 
 // Helper function for CORS
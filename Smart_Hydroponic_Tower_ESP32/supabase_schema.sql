@@ -11,6 +11,8 @@ CREATE TABLE IF NOT EXISTS sensor_data (
     co2_level REAL,
     ph_level REAL,
     water_temp REAL,
+    water_temp_top REAL,
+    water_temp_root REAL,
     env_temp REAL,
     humidity REAL,
     light_level REAL,
@@ -18,6 +20,10 @@ CREATE TABLE IF NOT EXISTS sensor_data (
     water_level BOOLEAN
 );
 
+-- Extra water temperature probes (for tables created before multi-probe support)
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS water_temp_top REAL;
+ALTER TABLE sensor_data ADD COLUMN IF NOT EXISTS water_temp_root REAL;
+
 -- Create index for faster queries
 CREATE INDEX IF NOT EXISTS idx_sensor_data_timestamp ON sensor_data(timestamp);
 CREATE INDEX IF NOT EXISTS idx_sensor_data_created_at ON sensor_data(created_at);
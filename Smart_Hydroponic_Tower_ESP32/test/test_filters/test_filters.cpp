@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "filters.h"
+
+// Host and on-device tests for include/filters.h: pio test -e native (or -e esp32dev)
+
+void setUp() {}
+void tearDown() {}
+
+// Deterministic noise in [-1, 1), the same sequence on every platform
+static float noise(uint32_t &state) {
+  state = state * 1664525u + 1013904223u;
+  return (state >> 8) / 8388608.0f - 1.0f;
+}
+
+static void test_moving_average_partial_and_full_window() {
+  MovingAverage<4> average;
+  TEST_ASSERT_TRUE(isnan(average.value()));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, average.update(2.0f));
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, average.update(4.0f));
+  average.update(6.0f);
+  TEST_ASSERT_EQUAL_FLOAT(5.0f, average.update(8.0f));
+  TEST_ASSERT_TRUE(average.full());
+  TEST_ASSERT_EQUAL_FLOAT(7.0f, average.update(10.0f)); // 2 dropped
+}
+
+// A million add/remove pairs of noisy samples on a large offset: the compensated sum stays
+// within 1e-4 of the window's exact mean, a plain float sum ends up about 1e-3 off
+static void test_moving_average_kahan_no_drift() {
+  MovingAverage<10> average;
+  float window[10];
+  uint32_t state = 1;
+  float result = 0;
+  for (uint32_t i = 0; i < 1000000; i++) {
+    window[i % 10] = 1000.0f + noise(state);
+    result = average.update(window[i % 10]);
+  }
+  double exact = 0;
+  for (float sample : window) {
+    exact += sample;
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, exact / 10, result);
+}
+
+static void test_moving_average_integer_exact() {
+  MovingAverage<3, int32_t> average;
+  for (int32_t i = 0; i < 100000; i++) {
+    average.update(i % 2 ? 100000 : -100000);
+  }
+  average.update(1);
+  average.update(2);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, average.update(0));
+}
+
+static void test_median_and_mad_odd_window() {
+  MedianFilter<5> median;
+  const float samples[] = {5, 1, 4, 2, 3};
+  for (float sample : samples) {
+    median.update(sample);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, median.median());
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, median.mad());   // |d| = 2 2 1 1 0
+}
+
+static void test_median_and_mad_even_window() {
+  MedianFilter<4> median;
+  const float samples[] = {1, 2, 3, 10};
+  for (float sample : samples) {
+    median.update(sample);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(2.5f, median.median());
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, median.mad());   // |d| = 1.5 0.5 0.5 7.5
+}
+
+static void test_median_slides_and_keeps_duplicates() {
+  MedianFilter<3> median;
+  median.update(1);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, median.median());
+  median.update(2);
+  TEST_ASSERT_EQUAL_FLOAT(1.5f, median.median());
+  median.update(3);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, median.update(100)); // Window 2 3 100
+  median.update(3);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, median.update(3));   // Window 3 3 3
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, median.mad());
+  TEST_ASSERT_EQUAL(3, median.size());
+}
+
+static void test_exponential_filter() {
+  ExponentialFilter<1, 4> ema;
+  TEST_ASSERT_TRUE(isnan(ema.value()));
+  TEST_ASSERT_EQUAL_FLOAT(8.0f, ema.update(8.0f));   // First sample sets the state
+  TEST_ASSERT_EQUAL_FLOAT(7.0f, ema.update(4.0f));
+}
+
+static void test_hampel_replaces_outlier_with_median() {
+  HampelFilter<7> hampel;
+  const float samples[] = {6.0f, 6.1f, 5.9f, 6.0f, 6.1f, 5.9f};
+  for (float sample : samples) {
+    TEST_ASSERT_EQUAL_FLOAT(sample, hampel.update(sample));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(6.0f, hampel.update(20.0f));
+  TEST_ASSERT_EQUAL(1, hampel.outlierCount());
+  TEST_ASSERT_EQUAL_FLOAT(6.05f, hampel.update(6.05f)); // Within the band again
+  TEST_ASSERT_EQUAL(1, hampel.outlierCount());
+}
+
+static void test_nan_passes_through_unstored() {
+  MovingAverage<4> average;
+  MedianFilter<5> median;
+  ExponentialFilter<1, 2> ema;
+  HampelFilter<5> hampel;
+  KalmanFilter1D<10, 500> kalman;
+  average.update(1.0f);
+  median.update(1.0f);
+  ema.update(1.0f);
+  hampel.update(1.0f);
+  kalman.update(1.0f);
+
+  TEST_ASSERT_TRUE(isnan(average.update(NAN)));
+  TEST_ASSERT_TRUE(isnan(median.update(NAN)));
+  TEST_ASSERT_TRUE(isnan(ema.update(NAN)));
+  TEST_ASSERT_TRUE(isnan(hampel.update(NAN)));
+  TEST_ASSERT_TRUE(isnan(kalman.update(NAN)));
+
+  TEST_ASSERT_EQUAL(1, average.size());
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, average.value());
+  TEST_ASSERT_EQUAL(1, median.size());
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, median.median());
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, ema.value());
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, kalman.value());
+}
+
+static void test_kalman_converges_and_tracks_step() {
+  KalmanFilter1D<1, 250> kalman;
+  uint32_t state = 1;
+  float estimate = 0;
+  for (int i = 0; i < 500; i++) {
+    estimate = kalman.update(7.0f + 0.5f * noise(state));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 7.0f, estimate);
+
+  for (int i = 0; i < 500; i++) {
+    estimate = kalman.update(8.0f + 0.5f * noise(state));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 8.0f, estimate);
+}
+
+static void test_chain_rejects_spike_before_smoothing() {
+  FilterChain<HampelFilter<7>, ExponentialFilter<1, 2>> chain;
+  const float samples[] = {6.0f, 6.1f, 5.9f, 6.0f, 6.1f, 5.9f, 6.0f};
+  float result = 0;
+  for (float sample : samples) {
+    result = chain.update(sample);
+  }
+  float spiked = chain.update(30.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 6.0f, spiked);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, result, spiked);
+  TEST_ASSERT_EQUAL(1, chain.head().outlierCount());
+}
+
+static int runTests() {
+  UNITY_BEGIN();
+  RUN_TEST(test_moving_average_partial_and_full_window);
+  RUN_TEST(test_moving_average_kahan_no_drift);
+  RUN_TEST(test_moving_average_integer_exact);
+  RUN_TEST(test_median_and_mad_odd_window);
+  RUN_TEST(test_median_and_mad_even_window);
+  RUN_TEST(test_median_slides_and_keeps_duplicates);
+  RUN_TEST(test_exponential_filter);
+  RUN_TEST(test_hampel_replaces_outlier_with_median);
+  RUN_TEST(test_nan_passes_through_unstored);
+  RUN_TEST(test_kalman_converges_and_tracks_step);
+  RUN_TEST(test_chain_rejects_spike_before_smoothing);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+  delay(2000); // Serial monitor attaches after the reset
+  runTests();
+}
+
+void loop() {}
+#else
+int main() {
+  return runTests();
+}
+#endif